@@ -2,17 +2,32 @@
 // See LICENSE.md file for details.
 
 import 'dart:ffi' as ffi;
+import 'dart:typed_data';
 
 import '../../build/clang/example/gen/hello.dart';
 
-main() {
+main() async {
   // This must be done before using any of the generated utilities.
   AttachNativeBindings();
 
+  // The native thread pool may be configured before the first async call.
+  ConfigureNativeThreadPool(2, 64);
+
   SayHello();
 
   print(AddValues(GetIntPointer(), 99));
 
+  print(SumSamples(Float32List.fromList([1.0, 2.0, 3.0])));
+
+  final scaled = Float64List(3);
+  ScaleValueBatch(Float64List.fromList([1.0, 2.0, 3.0]),
+      Float64List.fromList([2.0, 2.0, 2.0]), scaled);
+  print(scaled);
+
+  print(Greet("Dart"));
+
+  print(await CountPrimes(100000));
+
   var hello = CreateHello(HelloType.LongWinded);
   if (hello.ref.type == HelloType.LongWinded
    && hello.ref.type == TakeHelloType()) {
@@ -20,4 +35,10 @@ main() {
   }
 
   DestroyHello(hello);
+
+  final point = ffi.Struct.create<Point>()
+    ..x = 1.0
+    ..y = 2.0;
+  final moved = MovePoint(point, 3.0, 4.0);
+  print("Moved the point to (${moved.x}, ${moved.y}).");
 }
@@ -6,6 +6,8 @@
 
 #include <cstring>
 #include <iostream>
+#include <numeric>
+#include <string>
 
 namespace hello {
 
@@ -18,10 +20,27 @@ int32_t* GetIntPointer() {
   return &value;
 }
 
-int32_t AddValues(int32_t* a, int32_t b) {
+int32_t AddValues(int32_t* a, int32_t b) noexcept {
   return *a + b;
 }
 
+double ScaleValue(double value, double factor) {
+  return value * factor;
+}
+
+double SumSamples(std::span<float> samples) noexcept {
+  return std::accumulate(samples.begin(), samples.end(), 0.0);
+}
+
+std::string_view Greet(std::string_view name) noexcept {
+  // Read by the caller after the call returns. Each thread has its own so that
+  // concurrent calls don't overwrite each other's greeting. Exceptions may not
+  // unwind into Dart. So running out of memory here terminates instead.
+  thread_local std::string greeting;
+  greeting = "Hello, " + std::string(name) + "!";
+  return greeting;
+}
+
 Hello* CreateHello(HelloType type) {
   std::cout << "Creating a hello struct." << std::endl;
   auto hello = new Hello();
@@ -30,6 +49,25 @@ Hello* CreateHello(HelloType type) {
   return hello;
 }
 
+Point MovePoint(Point point, double dx, double dy) {
+  return {point.x + dx, point.y + dy};
+}
+
+uint32_t CountPrimes(uint32_t limit) {
+  uint32_t count = 0;
+  for (uint32_t i = 2; i < limit; i++) {
+    bool is_prime = true;
+    for (uint32_t j = 2; j * j <= i; j++) {
+      if (i % j == 0) {
+        is_prime = false;
+        break;
+      }
+    }
+    count += is_prime ? 1 : 0;
+  }
+  return count;
+}
+
 void DestroyHello(Hello* hello) {
   std::cout << "Destroying a hello struct." << std::endl;
   delete hello;
@@ -0,0 +1,13 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+// This file is generated and present in the gen/ build outputs directory.
+#include "minimal.h"
+
+namespace minimal {
+
+int32_t Add(int32_t a, int32_t b) {
+  return a + b;
+}
+
+}  // namespace minimal
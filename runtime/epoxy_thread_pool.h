@@ -0,0 +1,222 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The number of threads of the pool async functions run on. Zero picks the
+// number of hardware threads.
+#ifndef EPOXY_THREAD_POOL_SIZE
+#define EPOXY_THREAD_POOL_SIZE 0u
+#endif  //  EPOXY_THREAD_POOL_SIZE
+
+// The number of calls to async functions that may wait for a thread.
+#ifndef EPOXY_THREAD_POOL_QUEUE_DEPTH
+#define EPOXY_THREAD_POOL_QUEUE_DEPTH 1024u
+#endif  //  EPOXY_THREAD_POOL_QUEUE_DEPTH
+
+namespace epoxy {
+namespace runtime {
+
+// A fixed number of threads that run the calls to async functions. Each thread
+// has a queue of its own. Threads run the tasks in their own queue in order and
+// steal the newest tasks of other threads when theirs is empty. The number of
+// tasks waiting in all queues is bounded so that callers find out when the
+// pool cannot keep up instead of queueing without limit.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  struct Options {
+    size_t threads = EPOXY_THREAD_POOL_SIZE;
+    size_t queue_depth = EPOXY_THREAD_POOL_QUEUE_DEPTH;
+  };
+
+  explicit ThreadPool(Options options)
+      : queue_depth_(std::max<size_t>(options.queue_depth, 1u)) {
+    auto threads = options.threads;
+    if (threads == 0u) {
+      threads = std::max<size_t>(std::thread::hardware_concurrency(), 1u);
+    }
+    for (size_t i = 0; i < threads; i++) {
+      workers_.emplace_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+      threads_.emplace_back([this, i]() { Run(i); });
+    }
+  }
+
+  // Runs the tasks that are still waiting before the threads are joined. Tasks
+  // may not be submitted from other threads once destruction has begun.
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t GetThreadCount() const { return threads_.size(); }
+
+  size_t GetQueueDepth() const { return queue_depth_; }
+
+  // Returns false without running the task if the queues are full. Tasks
+  // submitted from the threads of the pool go to the queue of that thread.
+  bool TrySubmit(Task task) {
+    auto queued = queued_.load(std::memory_order_relaxed);
+    do {
+      if (queued >= queue_depth_) {
+        return false;
+      }
+    } while (!queued_.compare_exchange_weak(queued, queued + 1u,
+                                            std::memory_order_relaxed));
+
+    const auto index = current_pool_ == this
+                           ? current_index_
+                           : next_.fetch_add(1u, std::memory_order_relaxed) %
+                                 workers_.size();
+    {
+      auto& worker = *workers_[index];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      worker.tasks.emplace_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      epoch_++;
+    }
+    wake_.notify_one();
+    return true;
+  }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // The pool and the index of the worker the current thread runs, if any.
+  static inline thread_local const ThreadPool* current_pool_ = nullptr;
+  static inline thread_local size_t current_index_ = 0u;
+
+  const size_t queue_depth_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> queued_ = 0u;
+  std::atomic<size_t> next_ = 0u;
+  // Guards the epoch and stopping flag. The epoch changes every time a task is
+  // queued so that threads do not sleep through tasks queued after they last
+  // looked for one.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  uint64_t epoch_ = 0u;
+  bool stopping_ = false;
+
+  std::optional<Task> Take(size_t index) {
+    {
+      auto& own = *workers_[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        auto task = std::move(own.tasks.front());
+        own.tasks.pop_front();
+        return task;
+      }
+    }
+    for (size_t i = 1; i < workers_.size(); i++) {
+      auto& other = *workers_[(index + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      if (!other.tasks.empty()) {
+        auto task = std::move(other.tasks.back());
+        other.tasks.pop_back();
+        return task;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void Run(size_t index) {
+    current_pool_ = this;
+    current_index_ = index;
+    while (true) {
+      uint64_t epoch = 0u;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        epoch = epoch_;
+      }
+      if (auto task = Take(index); task.has_value()) {
+        queued_.fetch_sub(1u, std::memory_order_relaxed);
+        (*task)();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stopping_ && epoch == epoch_) {
+        return;
+      }
+      wake_.wait(lock, [&]() { return stopping_ || epoch != epoch_; });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ThreadPool& operator=(const ThreadPool&) = delete;
+};
+
+struct SharedThreadPool {
+  // Guards the options and starting the pool. Calls to async functions don't
+  // take it once the pool has started.
+  std::mutex mutex;
+  ThreadPool::Options options;
+  // Published once the pool has started. Never deleted, like this struct.
+  std::atomic<ThreadPool*> pool{nullptr};
+};
+
+// Never destroyed so that exiting does not wait for the calls still running.
+inline SharedThreadPool& GetSharedThreadPool() {
+  static auto* shared = new SharedThreadPool();
+  return *shared;
+}
+
+// Sets the options of the pool async functions run on. Returns false if the
+// pool has already been started by a call to an async function.
+inline bool ConfigureThreadPool(ThreadPool::Options options) {
+  auto& shared = GetSharedThreadPool();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  if (shared.pool.load(std::memory_order_relaxed) != nullptr) {
+    return false;
+  }
+  shared.options = options;
+  return true;
+}
+
+// The pool async functions run on. Started on first use.
+inline ThreadPool& GetThreadPool() {
+  auto& shared = GetSharedThreadPool();
+  if (auto* pool = shared.pool.load(std::memory_order_acquire)) {
+    return *pool;
+  }
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  auto* pool = shared.pool.load(std::memory_order_relaxed);
+  if (pool == nullptr) {
+    pool = new ThreadPool(shared.options);
+    shared.pool.store(pool, std::memory_order_release);
+  }
+  return *pool;
+}
+
+}  // namespace runtime
+}  // namespace epoxy
@@ -0,0 +1,130 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "allocation_tracker.h"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif  // defined(_MSC_VER)
+
+namespace epoxy {
+
+// A trivial type so that accessing it never needs dynamic initialization
+// (which could itself allocate).
+static thread_local AllocationStats tThreadStats;
+
+AllocationStats GetThreadAllocationStats() {
+  return tThreadStats;
+}
+
+AllocationScope::AllocationScope() : start_(GetThreadAllocationStats()) {}
+
+AllocationScope::~AllocationScope() = default;
+
+AllocationStats AllocationScope::GetStats() const {
+  return GetThreadAllocationStats() - start_;
+}
+
+static void* Allocate(size_t size) {
+  tThreadStats.allocations++;
+  tThreadStats.bytes += size;
+  // malloc may return null for zero sized requests. operator new may not.
+  if (auto allocation = std::malloc(size == 0u ? 1u : size)) {
+    return allocation;
+  }
+  throw std::bad_alloc();
+}
+
+static void* AllocateAligned(size_t size, std::align_val_t align) {
+  tThreadStats.allocations++;
+  tThreadStats.bytes += size;
+  const auto alignment = static_cast<size_t>(align);
+#if defined(_MSC_VER)
+  void* allocation = _aligned_malloc(size == 0u ? 1u : size, alignment);
+#else   // defined(_MSC_VER)
+  // The size given to aligned_alloc must be a multiple of the alignment.
+  const auto rounded = ((size + alignment - 1u) / alignment) * alignment;
+  void* allocation = std::aligned_alloc(alignment, rounded == 0u ? alignment
+                                                                 : rounded);
+#endif  // defined(_MSC_VER)
+  if (allocation) {
+    return allocation;
+  }
+  throw std::bad_alloc();
+}
+
+static void Deallocate(void* allocation) {
+  if (allocation == nullptr) {
+    return;
+  }
+  tThreadStats.deallocations++;
+  std::free(allocation);
+}
+
+static void DeallocateAligned(void* allocation) {
+  if (allocation == nullptr) {
+    return;
+  }
+  tThreadStats.deallocations++;
+#if defined(_MSC_VER)
+  _aligned_free(allocation);
+#else   // defined(_MSC_VER)
+  std::free(allocation);
+#endif  // defined(_MSC_VER)
+}
+
+}  // namespace epoxy
+
+// The replaceable global allocation functions. The nothrow variants provided
+// by the standard library forward to these.
+
+void* operator new(size_t size) {
+  return epoxy::Allocate(size);
+}
+
+void* operator new[](size_t size) {
+  return epoxy::Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+  return epoxy::AllocateAligned(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+  return epoxy::AllocateAligned(size, align);
+}
+
+void operator delete(void* allocation) noexcept {
+  epoxy::Deallocate(allocation);
+}
+
+void operator delete[](void* allocation) noexcept {
+  epoxy::Deallocate(allocation);
+}
+
+void operator delete(void* allocation, size_t) noexcept {
+  epoxy::Deallocate(allocation);
+}
+
+void operator delete[](void* allocation, size_t) noexcept {
+  epoxy::Deallocate(allocation);
+}
+
+void operator delete(void* allocation, std::align_val_t) noexcept {
+  epoxy::DeallocateAligned(allocation);
+}
+
+void operator delete[](void* allocation, std::align_val_t) noexcept {
+  epoxy::DeallocateAligned(allocation);
+}
+
+void operator delete(void* allocation, size_t, std::align_val_t) noexcept {
+  epoxy::DeallocateAligned(allocation);
+}
+
+void operator delete[](void* allocation, size_t, std::align_val_t) noexcept {
+  epoxy::DeallocateAligned(allocation);
+}
@@ -0,0 +1,47 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <cstddef>
+
+#include "macros.h"
+
+namespace epoxy {
+
+// Counts of heap allocations made via the global operator new and delete. The
+// global operators are only replaced in executables that link
+// allocation_tracker.cc (the allocation tests and the benchmarks). The library
+// and the epoxy executable use the default operators.
+struct AllocationStats {
+  size_t allocations = 0u;
+  size_t deallocations = 0u;
+  size_t bytes = 0u;
+
+  AllocationStats operator-(const AllocationStats& other) const {
+    return {allocations - other.allocations,
+            deallocations - other.deallocations, bytes - other.bytes};
+  }
+};
+
+// The allocations made on the calling thread since it was started. Counts are
+// per thread so that allocations on other threads (in the test runner for
+// example) don't affect measurements.
+AllocationStats GetThreadAllocationStats();
+
+// Measures the allocations made on the calling thread during its lifetime.
+class AllocationScope {
+ public:
+  AllocationScope();
+
+  ~AllocationScope();
+
+  AllocationStats GetStats() const;
+
+ private:
+  const AllocationStats start_;
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(AllocationScope);
+};
+
+}  // namespace epoxy
@@ -0,0 +1,255 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include "allocation_tracker.h"
+#include "code_gen.h"
+#include "driver.h"
+#include "file.h"
+#include "fixture.h"
+#include "scanner.h"
+#include "sema.h"
+#include "synthetic_idl.h"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace epoxy {
+namespace testing {
+
+// The most allocations and bytes a phase may make per item it processes.
+// Budgets are upper bounds with some headroom over the current usage so that
+// regressions are caught while the numbers remain stable across standard
+// library implementations.
+struct Budget {
+  double allocations_per_item = 0.0;
+  double bytes_per_item = 0.0;
+};
+
+// Lexing and parsing are budgeted per token. Sema, JSON building and rendering
+// are budgeted per AST node.
+struct PhaseBudgets {
+  Budget lexing;
+  Budget parsing;
+  Budget sema;
+  Budget json;
+  Budget rendering;
+};
+
+struct Phase {
+  std::string name;
+  AllocationStats stats;
+  size_t items = 0u;
+  Budget budget;
+};
+
+static size_t CountNodes(const std::vector<Namespace>& namespaces) {
+  size_t nodes = 0u;
+  for (const auto& ns : namespaces) {
+    nodes++;
+    for (const auto& function : ns.GetFunctions()) {
+      nodes += 1u + function.GetArguments().size();
+    }
+    for (const auto& strut : ns.GetStructs()) {
+      nodes += 1u + strut.GetVariables().size();
+    }
+    for (const auto& enumm : ns.GetEnums()) {
+      nodes += 1u + enumm.GetMembers().size();
+    }
+  }
+  return nodes;
+}
+
+static std::vector<Phase> MeasurePhases(const std::string& text,
+                                        const std::string& template_data,
+                                        Driver::LexerType lexer_type,
+                                        Driver::ParserType parser_type,
+                                        const PhaseBudgets& budgets) {
+  std::vector<Phase> phases;
+
+  // Lexing.
+  size_t tokens = 0u;
+  AllocationStats lexing;
+  {
+    const auto end_kind = Parser::make_END(location()).type_get();
+    Driver driver;
+    AllocationScope scope;
+    Scanner scanner(text, lexer_type, driver.GetCurrentLocation());
+    while (scanner.Lex(driver).type_get() != end_kind) {
+      tokens++;
+    }
+    lexing = scope.GetStats();
+  }
+  phases.push_back({"Lexing", lexing, tokens, budgets.lexing});
+
+  // Parsing. The parser pulls tokens from the lexer as it goes. Those
+  // allocations have already been accounted for.
+  Driver driver;
+  driver.SetLexerType(lexer_type);
+  driver.SetParserType(parser_type);
+  AllocationStats parsing;
+  {
+    AllocationScope scope;
+    EXPECT_EQ(driver.Parse(text), Driver::ParserResult::kSuccess);
+    parsing = scope.GetStats() - lexing;
+  }
+  phases.push_back({"Parsing", parsing, tokens, budgets.parsing});
+
+  // Sema. Namespaces are passed by value to Sema. That copy is accounted for
+  // here.
+  Sema sema;
+  AllocationStats sema_stats;
+  {
+    AllocationScope scope;
+    EXPECT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    sema_stats = scope.GetStats();
+  }
+  const auto nodes = CountNodes(sema.GetNamespaces());
+  phases.push_back({"Sema", sema_stats, nodes, budgets.sema});
+
+  // JSON building.
+  AllocationStats json;
+  {
+    AllocationScope scope;
+    for (const auto& ns : sema.GetNamespaces()) {
+      ns.GetJSONObject();
+    }
+    json = scope.GetStats();
+  }
+  phases.push_back({"JSON", json, nodes, budgets.json});
+
+  // Rendering. The template is parsed up front. Rendering includes building
+  // the template data.
+  auto parsed_template = CodeGen::ParseTemplate(template_data);
+  EXPECT_NE(parsed_template.result, nullptr);
+  AllocationStats rendering;
+  {
+    AllocationScope scope;
+    auto render =
+        CodeGen::RenderTemplate(*parsed_template.result, sema.GetNamespaces());
+    EXPECT_TRUE(render.result.has_value());
+    rendering = scope.GetStats();
+  }
+  phases.push_back({"Rendering", rendering, nodes, budgets.rendering});
+
+  return phases;
+}
+
+static void ExpectPhasesWithinBudget(const std::string& name,
+                                     const std::vector<Phase>& phases) {
+  std::cout << name << std::endl;
+  for (const auto& phase : phases) {
+    ASSERT_GT(phase.items, 0u);
+    const auto allocations_per_item =
+        static_cast<double>(phase.stats.allocations) / phase.items;
+    const auto bytes_per_item =
+        static_cast<double>(phase.stats.bytes) / phase.items;
+    std::cout << "  " << std::left << std::setw(12) << phase.name
+              << std::right << std::setw(10) << phase.stats.allocations
+              << " allocs" << std::setw(12) << phase.stats.bytes << " bytes"
+              << std::setw(8) << phase.items << " items" << std::fixed
+              << std::setprecision(2) << std::setw(10) << allocations_per_item
+              << " allocs/item" << std::setw(10) << bytes_per_item
+              << " bytes/item" << std::endl;
+    EXPECT_LE(allocations_per_item, phase.budget.allocations_per_item)
+        << name << ": " << phase.name;
+    EXPECT_LE(bytes_per_item, phase.budget.bytes_per_item)
+        << name << ": " << phase.name;
+  }
+}
+
+static void ExpectWithinBudget(const std::string& name,
+                               const std::string& text,
+                               Driver::LexerType lexer_type,
+                               Driver::ParserType parser_type,
+                               const PhaseBudgets& budgets) {
+  auto template_data =
+      ReadFileAsString(EPOXY_EXAMPLES_LOCATION "cxx_interface.template.epoxy");
+  ASSERT_TRUE(template_data.has_value());
+  ExpectPhasesWithinBudget(name, MeasurePhases(text, template_data.value(),
+                                               lexer_type, parser_type,
+                                               budgets));
+}
+
+static std::string GetSyntheticIDL() {
+  SyntheticIDLOptions options;
+  options.namespaces = 4u;
+  options.enums_per_namespace = 10u;
+  options.structs_per_namespace = 20u;
+  options.functions_per_namespace = 40u;
+  options.fields_per_struct = 8u;
+  options.arguments_per_function = 4u;
+  return GenerateSyntheticIDL(options);
+}
+
+TEST(AllocationTest, TrackerCountsAllocations) {
+  AllocationScope scope;
+  auto allocation = std::make_unique<std::vector<char>>(100u);
+  const auto stats = scope.GetStats();
+  ASSERT_EQ(stats.allocations, 2u);
+  ASSERT_EQ(stats.deallocations, 0u);
+  ASSERT_EQ(stats.bytes, sizeof(std::vector<char>) + 100u);
+  allocation.reset();
+  ASSERT_EQ(scope.GetStats().deallocations, 2u);
+}
+
+TEST(AllocationTest, HelloWithinBudget) {
+  auto source = ReadFileAsString(EPOXY_EXAMPLES_LOCATION "hello.epoxy");
+  ASSERT_TRUE(source.has_value());
+
+  PhaseBudgets budgets;
+  budgets.lexing = {2.0, 160.0};
+  budgets.parsing = {2.5, 1500.0};
+  // Constants are looked up by name when evaluating expressions.
+  budgets.sema = {5.0, 768.0};
+  // Values of enum types carry the traits of the underlying type. Templates
+  // look those up when rendering. Every variable and function also says
+  // whether it is or takes a slice or string. Batch functions carry the Dart
+  // typed data lists of their arguments and result. Functions say whether
+  // they are async. Enum members carry their value for Dart too.
+  budgets.json = {22.5, 1472.0};
+  // Functions called as leaf functions, including those that take slices or
+  // strings, render their contract above the declaration. Headers are only
+  // included if the namespaces use them.
+  budgets.rendering = {169.5, 11520.0};
+  ExpectWithinBudget("hello (flex, bison)", source.value(),
+                     Driver::LexerType::kFlex, Driver::ParserType::kBison,
+                     budgets);
+
+  budgets.lexing = {0.1, 64.0};
+  // The struct of values in the example adds fields but few tokens.
+  budgets.parsing = {1.5, 320.0};
+  ExpectWithinBudget("hello (fast, descent)", source.value(),
+                     Driver::LexerType::kFast, Driver::ParserType::kDescent,
+                     budgets);
+}
+
+TEST(AllocationTest, SyntheticIDLWithinBudget) {
+  const auto source = GetSyntheticIDL();
+
+  PhaseBudgets budgets;
+  budgets.lexing = {2.0, 160.0};
+  // Every variable has room for the expression of an array length.
+  budgets.parsing = {1.5, 832.0};
+  budgets.sema = {2.5, 1024.0};
+  // Every variable says whether it is an array, a slice or a string and the
+  // templates check it.
+  budgets.json = {19.5, 1280.0};
+  budgets.rendering = {160.0, 11264.0};
+  ExpectWithinBudget("synthetic (flex, bison)", source,
+                     Driver::LexerType::kFlex, Driver::ParserType::kBison,
+                     budgets);
+
+  budgets.lexing = {0.01, 10.0};
+  budgets.parsing = {1.0, 512.0};
+  ExpectWithinBudget("synthetic (fast, descent)", source,
+                     Driver::LexerType::kFast, Driver::ParserType::kDescent,
+                     budgets);
+}
+
+}  // namespace testing
+}  // namespace epoxy
@@ -4,6 +4,7 @@
 #include "code_gen.h"
 #include "version.h"
 
+#include <chrono>
 #include <inja.hpp>
 #include <sstream>
 
@@ -26,103 +27,101 @@ static nlohmann::json CreateJSONTemplateData(
   nlohmann::json ns_data;
   ns_data["epoxy_version"] = GetEpoxyVersion();
 
+  bool has_slices = false;
+  bool has_strings = false;
   for (const auto& ns : namespaces) {
-    ns_data["namespaces"].push_back(ns.GetJSONObject());
-  }
+    auto ns_json = ns.GetJSONObject();
+    has_slices = has_slices || ns_json["has_slices"].get<bool>();
+    has_strings = has_strings || ns_json["has_strings"].get<bool>();
+    ns_data["namespaces"].push_back(std::move(ns_json));
+  }
+  // Includes are emitted once for all namespaces.
+  ns_data["has_slices"] = has_slices;
+  ns_data["has_strings"] = has_strings;
 
   return ns_data;
 }
 
+// The callbacks predate the primitive attributes in the template data and are
+// kept for existing templates.
 static std::string TypeToDartFFIType(const std::string& type) {
-  if (type == "void") {
-    return "Void";
-  }
-  if (type == "int8_t") {
-    return "Int8";
-  }
-  if (type == "int16_t") {
-    return "Int16";
-  }
-  if (type == "int32_t") {
-    return "Int32";
-  }
-  if (type == "int64_t") {
-    return "Int64";
-  }
-  if (type == "uint8_t") {
-    return "Uint8";
-  }
-  if (type == "uint16_t") {
-    return "Uint16";
-  }
-  if (type == "uint32_t") {
-    return "Uint32";
-  }
-  if (type == "uint64_t") {
-    return "Uint64";
-  }
-  if (type == "double") {
-    return "Double";
-  }
-  if (type == "float") {
-    return "Float";
+  if (auto primitive = GetPrimitiveNamed(type); primitive.has_value()) {
+    return GetPrimitiveTraits(primitive.value()).dart_ffi_type;
   }
   return "unknown";
 }
 
 static std::string TypeToDartType(const std::string& type) {
-  if (type == "void") {
-    return "void";
+  if (auto primitive = GetPrimitiveNamed(type); primitive.has_value()) {
+    return GetPrimitiveTraits(primitive.value()).dart_type;
   }
-  if (type == "int8_t") {
-    return "int";
-  }
-  if (type == "int16_t") {
-    return "int";
-  }
-  if (type == "int32_t") {
-    return "int";
-  }
-  if (type == "int64_t") {
-    return "int";
-  }
-  if (type == "uint8_t") {
-    return "int";
-  }
-  if (type == "uint16_t") {
-    return "int";
-  }
-  if (type == "uint32_t") {
-    return "int";
-  }
-  if (type == "uint64_t") {
-    return "int";
+  return "unknown";
+}
+
+static void AddTypeCallback(inja::Environment& env,
+                            const std::string& name,
+                            std::string (*convert)(const std::string&),
+                            TemplateProfiler* profiler) {
+  env.add_callback(name, 1u, [name, convert, profiler](inja::Arguments& args) {
+    if (profiler == nullptr) {
+      return convert(args.at(0u)->get<std::string>());
+    }
+    const auto start = std::chrono::steady_clock::now();
+    auto result = convert(args.at(0u)->get<std::string>());
+    profiler->OnCallback(name, std::chrono::steady_clock::now() - start);
+    return result;
+  });
+}
+
+static void ConfigureEnvironment(inja::Environment& env,
+                                 TemplateProfiler* profiler = nullptr) {
+  env.set_trim_blocks(true);
+  env.set_lstrip_blocks(true);
+  AddTypeCallback(env, "dart_ffi_type", &TypeToDartFFIType, profiler);
+  AddTypeCallback(env, "dart_type", &TypeToDartType, profiler);
+  if (profiler != nullptr) {
+    env.set_instruction_observer(
+        [profiler](size_t index, uint32_t line, size_t loop_depth) {
+          profiler->OnInstruction(index, line, loop_depth);
+        });
   }
-  if (type == "double") {
-    return "double";
+}
+
+CodeGen::ParseResult CodeGen::ParseTemplate(const std::string& template_data) {
+  inja::Environment env;
+  ConfigureEnvironment(env);
+  try {
+    return {std::make_shared<inja::Template>(env.parse(template_data)),
+            std::nullopt};
+  } catch (const std::exception& e) {
+    return {nullptr, e.what()};
   }
-  if (type == "float") {
-    return "double";
+}
+
+CodeGen::RenderResult CodeGen::RenderTemplate(
+    const inja::Template& parsed_template,
+    const std::vector<Namespace>& namespaces,
+    TemplateProfiler* profiler) {
+  inja::Environment env;
+  ConfigureEnvironment(env, profiler);
+  try {
+    auto render =
+        env.render(parsed_template, CreateJSONTemplateData(namespaces));
+    return {render, std::nullopt};
+  } catch (const std::exception& e) {
+    return {std::nullopt, e.what()};
   }
-  return "unknown";
 }
 
-CodeGen::RenderResult CodeGen::Render(
-    const std::vector<Namespace>& namespaces) const {
+CodeGen::RenderResult CodeGen::Render(const std::vector<Namespace>& namespaces,
+                                      TemplateProfiler* profiler) const {
   inja::Environment env;
-  env.set_trim_blocks(true);
-  env.set_lstrip_blocks(true);
-  env.add_callback("dart_ffi_type", 1u, [](inja::Arguments& args) {
-    return TypeToDartFFIType(args.at(0u)->get<std::string>());
-  });
-  env.add_callback("dart_type", 1u, [](inja::Arguments& args) {
-    return TypeToDartType(args.at(0u)->get<std::string>());
-  });
+  ConfigureEnvironment(env, profiler);
   try {
     auto render =
         env.render(template_data_.data(), CreateJSONTemplateData(namespaces));
     return {render, std::nullopt};
-  } catch (std::exception e) {
+  } catch (const std::exception& e) {
     return {std::nullopt, e.what()};
   }
 }
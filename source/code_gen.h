@@ -3,13 +3,19 @@
 
 #pragma once
 
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
 #include "macros.h"
+#include "template_profiler.h"
 #include "types.h"
 
+namespace inja {
+struct Template;
+}  // namespace inja
+
 namespace epoxy {
 
 class CodeGen {
@@ -23,10 +29,26 @@ class CodeGen {
     std::optional<std::string> error;
   };
 
+  struct ParseResult {
+    std::shared_ptr<const inja::Template> result;
+    std::optional<std::string> error;
+  };
+
+  // Parsed templates are immutable and may be rendered by multiple code
+  // generators on different threads concurrently.
+  static ParseResult ParseTemplate(const std::string& template_data);
+
+  // If a profiler is specified, the time spent on each line of the template
+  // and in each callback is recorded in it.
+  static RenderResult RenderTemplate(const inja::Template& parsed_template,
+                                     const std::vector<Namespace>& namespaces,
+                                     TemplateProfiler* profiler = nullptr);
+
   std::string GenerateTemplateDataJSON(
       const std::vector<Namespace>& namespaces) const;
 
-  RenderResult Render(const std::vector<Namespace>& namespaces) const;
+  RenderResult Render(const std::vector<Namespace>& namespaces,
+                      TemplateProfiler* profiler = nullptr) const;
 
  private:
   std::string template_data_;
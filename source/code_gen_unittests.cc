@@ -3,11 +3,15 @@
 
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "code_gen.h"
 #include "driver.h"
+#include "file.h"
+#include "fixture.h"
 #include "sema.h"
 
 namespace epoxy {
@@ -55,5 +59,369 @@ TEST(CodeGenTest, CanCreateJSONDump) {
   ASSERT_NE(json_dump.find("epoxy_version"), std::string::npos);
 }
 
+TEST(CodeGenTest, TemplateDataHasPrimitiveAttributes) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      struct Foo {
+        uint16_t a1;
+      }
+      function world(int64_t* a) -> float
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}"
+      "{% for struct in ns.structs %}{% for var in struct.variables %}"
+      "{{ var.primitive.c_type }} {{ var.primitive.dart_ffi_type }} "
+      "{{ var.primitive.dart_type }} {{ var.primitive.size }} "
+      "{{ var.primitive.alignment }}|"
+      "{% endfor %}{% endfor %}"
+      "{% for func in ns.functions %}"
+      "{{ func.return_primitive.dart_ffi_type }} "
+      "{{ func.return_primitive.dart_type }} {{ func.return_primitive.size }}|"
+      "{% for arg in func.arguments %}"
+      "{{ arg.primitive.c_type }} {{ dart_ffi_type(arg.type) }} "
+      "{{ dart_type(arg.type) }} {{ dart_type(\"Foo\") }}"
+      "{% endfor %}{% endfor %}"
+      "{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "uint16_t Uint16 int 2 2|Float double 4|int64_t Int64 int unknown");
+}
+
+TEST(CodeGenTest, SlicesHaveTypedDataInDart) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      function Sum(float[] a, double* b) -> double
+      function Count(uint8_t[] a) -> uint64_t
+      function Clear(int32_t* a)
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}{% for func in ns.functions %}"
+      "{{ func.takes_slices }}"
+      "{% for arg in func.arguments %}"
+      " {{ arg.is_slice }}"
+      "{% if arg.is_slice %} {{ arg.dart_typed_data }}{% endif %}"
+      "{% endfor %}|"
+      "{% endfor %}{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "true true Float32List false|true true Uint8List|false false|");
+}
+
+TEST(CodeGenTest, StringsAreFlaggedInTheTemplateData) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      function Greet(string a, double b) -> string
+      function Count(string a) -> uint64_t
+      function Clear()
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}{% for func in ns.functions %}"
+      "{{ func.returns_string }} {{ func.takes_strings }}"
+      "{% for arg in func.arguments %}"
+      " {{ arg.is_string }} {{ arg.primitive.dart_type }}"
+      "{% endfor %}|"
+      "{% endfor %}{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "true true true String false double|false true true String|"
+            "false false|");
+}
+
+TEST(CodeGenTest, LargeEnumValuesAreSignedInDart) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      [[flags]]
+      enum Bits : uint64_t {
+        Low = 1,
+        High = 1 << 63,
+      }
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}{% for enum in ns.enums %}"
+      "{% for member in enum.members %}"
+      "{{ member.value }} {{ member.dart_value }}|"
+      "{% endfor %}{% endfor %}{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "1 1|9223372036854775808 -9223372036854775808|");
+}
+
+TEST(CodeGenTest, LargeConstantsAreSignedInDart) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      const uint64_t kHigh = 1 << 63;
+      const uint64_t kAll = kHigh | (kHigh - 1);
+      const int64_t kMax = kHigh - 1;
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}{% for constant in ns.constants %}"
+      "{{ constant.value }} {{ constant.dart_value }}|"
+      "{% endfor %}{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "9223372036854775808 -9223372036854775808|"
+            "18446744073709551615 -1|"
+            "9223372036854775807 9223372036854775807|");
+}
+
+TEST(CodeGenTest, LeafFunctionsAreFlaggedInTheTemplateData) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      [[leaf]]
+      function Add(int32_t a, int32_t b) -> int32_t
+      function Sum(float[] a) -> double
+      function Count(string a) -> uint64_t
+      function Clear()
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}{% for func in ns.functions %}"
+      "{{ func.is_leaf }} {{ func.is_leaf_call }}|"
+      "{% endfor %}{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "true true|false true|false true|false false|");
+}
+
+TEST(CodeGenTest, BatchFunctionsHaveTypedDataInDart) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      [[batch]]
+      function Scale(double value, uint16_t shift) -> float
+      function Add(int32_t a) -> int32_t
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto code_gen = CodeGen(
+      "{% for ns in namespaces %}{% for func in ns.functions %}"
+      "{{ func.is_batch }} {{ func.is_leaf }}"
+      "{% if func.is_batch %} {{ func.return_dart_typed_data }}"
+      "{% for arg in func.arguments %} {{ arg.dart_typed_data }}{% endfor %}"
+      "{% endif %}|"
+      "{% endfor %}{% endfor %}");
+  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  ASSERT_EQ(code_gen_result.result.value(),
+            "true false Float32List Float64List Uint16List|false false|");
+}
+
+TEST(CodeGenTest, BatchFunctionsAreNotLeafFunctions) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      [[batch]]
+      function Scale(double value, double factor) -> double
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto template_data =
+      ReadFileAsString(EPOXY_EXAMPLES_LOCATION "cxx_interface.template.epoxy");
+  ASSERT_TRUE(template_data.has_value());
+  auto code_gen_result =
+      CodeGen(template_data.value()).Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  const auto& header = code_gen_result.result.value();
+  // Only the batch entry point is a leaf call. The function it loops over may
+  // be called from Dart like any other.
+  const auto declaration = header.find("Scale(");
+  ASSERT_NE(declaration, std::string::npos);
+  ASSERT_EQ(header.find("noexcept", declaration), std::string::npos);
+  ASSERT_EQ(header.find("leaf function"), std::string::npos);
+}
+
+TEST(CodeGenTest, LeafCallsAreDeclaredNoexcept) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      [[leaf]]
+      function Add(int32_t a, int32_t b) -> int32_t
+      function Sum(float[] a) -> double
+      function Count(string a) -> uint64_t
+      function Clear()
+    }
+  )~");
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  auto template_data =
+      ReadFileAsString(EPOXY_EXAMPLES_LOCATION "cxx_interface.template.epoxy");
+  ASSERT_TRUE(template_data.has_value());
+  auto code_gen_result =
+      CodeGen(template_data.value()).Render(sema.GetNamespaces());
+  ASSERT_TRUE(code_gen_result.result.has_value())
+      << code_gen_result.error.value_or("");
+  const auto& header = code_gen_result.result.value();
+  // Functions that take slices or strings are called from Dart as leaf
+  // functions whether or not they are marked as such.
+  for (const auto& [name, is_leaf_call] :
+       std::vector<std::pair<std::string, bool>>{{"Add(", true},
+                                                 {"Sum(", true},
+                                                 {"Count(", true},
+                                                 {"Clear(", false}}) {
+    const auto declaration = header.find(name);
+    ASSERT_NE(declaration, std::string::npos) << name;
+    const auto end = header.find(";", declaration);
+    const auto is_noexcept =
+        header.substr(declaration, end - declaration).find("noexcept") !=
+        std::string::npos;
+    ASSERT_EQ(is_noexcept, is_leaf_call) << name;
+  }
+}
+
+TEST(CodeGenTest, HeadersAreOnlyIncludedForSlicesAndStringsInUse) {
+  auto template_data =
+      ReadFileAsString(EPOXY_EXAMPLES_LOCATION "cxx_interface.template.epoxy");
+  ASSERT_TRUE(template_data.has_value());
+  const std::pair<const char*, const char*> cases[] = {
+      {"function Add(int32_t a, int32_t b) -> int32_t", ""},
+      {"function Sum(float[] a) -> double", "<span>"},
+      {"function Count(string a) -> uint64_t", "<string_view>"},
+      {"function Greet() -> string", "<string_view>"},
+  };
+  for (const auto& [function, include] : cases) {
+    Driver driver;
+    // Only one of the namespaces uses the type. The header is included once.
+    ASSERT_EQ(driver.Parse(std::string{"namespace foo { "} + function +
+                           " } namespace bar { function Clear() }"),
+              Driver::ParserResult::kSuccess)
+        << function;
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    auto code_gen_result =
+        CodeGen(template_data.value()).Render(sema.GetNamespaces());
+    ASSERT_TRUE(code_gen_result.result.has_value())
+        << code_gen_result.error.value_or("");
+    const auto& header = code_gen_result.result.value();
+    for (const auto* header_name : {"<span>", "<string_view>"}) {
+      const auto count = std::string{include} == header_name ? 1u : 0u;
+      size_t found = 0u;
+      for (auto pos = header.find(header_name); pos != std::string::npos;
+           pos = header.find(header_name, pos + 1u)) {
+        found++;
+      }
+      ASSERT_EQ(found, count) << function << " " << header_name;
+    }
+  }
+}
+
+TEST(CodeGenTest, StringHelpersAreOnlyGeneratedForStringsInUse) {
+  auto template_data =
+      ReadFileAsString(EPOXY_EXAMPLES_LOCATION "cxx_impl.template.epoxy");
+  ASSERT_TRUE(template_data.has_value());
+  // The example minimal.epoxy is also built with warnings as errors.
+  const std::pair<const char*, bool> cases[] = {
+      {"function Add(int32_t a, int32_t b) -> int32_t", false},
+      {"function Greet(string name) -> string", true},
+  };
+  for (const auto& [function, has_strings] : cases) {
+    Driver driver;
+    ASSERT_EQ(driver.Parse(std::string{"namespace foo { "} + function + " }"),
+              Driver::ParserResult::kSuccess)
+        << function;
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    auto code_gen_result =
+        CodeGen(template_data.value()).Render(sema.GetNamespaces());
+    ASSERT_TRUE(code_gen_result.result.has_value())
+        << code_gen_result.error.value_or("");
+    const auto& impl = code_gen_result.result.value();
+    ASSERT_EQ(impl.find("string_view") != std::string::npos, has_strings)
+        << function;
+    ASSERT_EQ(impl.find("EpoxyStringFromView") != std::string::npos,
+              has_strings)
+        << function;
+  }
+}
+
+TEST(CodeGenTest, AsyncFunctionsAreFlaggedInTheTemplateData) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    auto driver_result = driver.Parse(R"~(
+      namespace foo {
+        async function Count(uint32_t limit) -> uint32_t
+        [[leaf]]
+        async function Wait()
+        function Add(int32_t a) -> int32_t
+      }
+      namespace bar {
+        function Clear()
+      }
+    )~");
+    ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    auto code_gen = CodeGen(
+        "{% for ns in namespaces %}{{ ns.has_async_functions }}:"
+        "{% for func in ns.functions %}"
+        " {{ func.is_async }} {{ func.is_leaf }}"
+        "{% endfor %}|{% endfor %}");
+    auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+    ASSERT_TRUE(code_gen_result.result.has_value())
+        << code_gen_result.error.value_or("");
+    ASSERT_EQ(code_gen_result.result.value(),
+              "false: false false|true: true false true true false false|");
+  }
+}
+
+TEST(CodeGenTest, CanLookUpPrimitivesByName) {
+  ASSERT_EQ(GetPrimitiveNamed("uint32_t"), Primitive::kUnsignedInt32);
+  ASSERT_EQ(GetPrimitiveNamed("void"), Primitive::kVoid);
+  ASSERT_FALSE(GetPrimitiveNamed("Foo").has_value());
+  for (size_t i = 0; i <= static_cast<size_t>(Primitive::kString); i++) {
+    const auto primitive = static_cast<Primitive>(i);
+    ASSERT_EQ(GetPrimitiveNamed(GetPrimitiveTraits(primitive).type),
+              primitive);
+  }
+}
+
 }  // namespace testing
 }  // namespace epoxy
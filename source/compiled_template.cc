@@ -0,0 +1,467 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "compiled_template.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <inja.hpp>
+#include <limits>
+#include <vector>
+
+#include "version.h"
+
+namespace epoxy {
+
+// The layout of a compiled template. All integers are unsigned LEB128
+// varints.
+//
+//   magic      "EPOXYT\0" followed by the format version byte
+//   version    The Epoxy major, minor and patch versions
+//   source     The size followed by the bytes of the template source
+//   bytecodes  The count followed by each bytecode
+//
+// Each bytecode is its op and flags as bytes, its args and line, its string
+// and its value as a size followed by the value in CBOR. Null values have a
+// size of zero. Strings are mostly text or names from the source. So strings
+// start with their size shifted left by one. If the lowest bit is set, the
+// offset of the string in the source follows. Otherwise, the bytes of the
+// string follow.
+static constexpr char kMagic[] = {'E', 'P', 'O', 'X', 'Y', 'T', '\0', '\2'};
+
+// The op, flags, args, line and the sizes of the string and value take at
+// least a byte each.
+static constexpr size_t kMinBytecodeSize = 6u;
+static constexpr uint32_t kVersion[] = {EPOXY_VERSION_MAJOR,
+                                        EPOXY_VERSION_MINOR,
+                                        EPOXY_VERSION_PATCH};
+
+bool IsCompiledTemplate(std::string_view data) {
+  return data.substr(0u, sizeof(kMagic)) ==
+         std::string_view(kMagic, sizeof(kMagic));
+}
+
+static void WriteUint32(std::string& out, uint32_t value) {
+  while (value >= 0x80u) {
+    out.push_back(static_cast<char>((value & 0x7Fu) | 0x80u));
+    value >>= 7u;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+static void WriteBytes(std::string& out, std::string_view bytes) {
+  WriteUint32(out, static_cast<uint32_t>(bytes.size()));
+  out.append(bytes.data(), bytes.size());
+}
+
+// Bytecodes are generated in the order of the source. So the strings they
+// reference are searched for starting from where the last one was found.
+static void WriteString(std::string& out,
+                        std::string_view source,
+                        std::string_view string,
+                        size_t& hint) {
+  auto offset = std::string_view::npos;
+  if (!string.empty()) {
+    offset = source.find(string, hint);
+    if (offset == std::string_view::npos) {
+      offset = source.substr(0u, hint + string.size()).find(string);
+    }
+  }
+  if (offset == std::string_view::npos) {
+    WriteUint32(out, static_cast<uint32_t>(string.size()) << 1u);
+    out.append(string.data(), string.size());
+    return;
+  }
+  WriteUint32(out, (static_cast<uint32_t>(string.size()) << 1u) | 1u);
+  WriteUint32(out, static_cast<uint32_t>(offset));
+  hint = offset;
+}
+
+CompileTemplateResult CompileTemplate(const inja::Template& parsed_template) {
+  // Leaves room to tag the sizes of strings.
+  constexpr auto kMaxSize = std::numeric_limits<uint32_t>::max() >> 1u;
+  if (parsed_template.content.size() > kMaxSize ||
+      parsed_template.bytecodes.size() > kMaxSize) {
+    return {std::nullopt, "The template is too large to compile."};
+  }
+
+  std::string out(kMagic, sizeof(kMagic));
+  for (const auto version : kVersion) {
+    WriteUint32(out, version);
+  }
+  WriteBytes(out, parsed_template.content);
+  WriteUint32(out, static_cast<uint32_t>(parsed_template.bytecodes.size()));
+  size_t hint = 0u;
+  for (const auto& bytecode : parsed_template.bytecodes) {
+    if (bytecode.op == inja::Bytecode::Op::Include) {
+      return {std::nullopt,
+              "Templates that include other templates cannot be compiled."};
+    }
+    out.push_back(static_cast<char>(bytecode.op));
+    out.push_back(static_cast<char>(bytecode.flags));
+    WriteUint32(out, bytecode.args);
+    WriteUint32(out, bytecode.line);
+    WriteString(out, parsed_template.content, bytecode.str, hint);
+    if (bytecode.value.is_null()) {
+      WriteUint32(out, 0u);
+    } else {
+      const auto value = nlohmann::json::to_cbor(bytecode.value);
+      WriteBytes(out, {reinterpret_cast<const char*>(value.data()),
+                       value.size()});
+    }
+  }
+  return {std::move(out), std::nullopt};
+}
+
+namespace {
+
+// Reads the fields of a compiled template in order. Reads past the end of the
+// data fail and leave the reader at the end.
+class Reader {
+ public:
+  explicit Reader(std::string_view data) : data_(data) {}
+
+  bool ReadUint8(uint8_t& value) {
+    if (data_.size() < 1u) {
+      return Fail();
+    }
+    value = static_cast<uint8_t>(data_[0]);
+    data_.remove_prefix(1u);
+    return true;
+  }
+
+  bool ReadUint32(uint32_t& value) {
+    value = 0u;
+    // A uint32 takes at most five bytes.
+    for (size_t i = 0; i < 5u && i < data_.size(); i++) {
+      const auto byte = static_cast<uint8_t>(data_[i]);
+      value |= static_cast<uint32_t>(byte & 0x7Fu) << (i * 7u);
+      if ((byte & 0x80u) == 0u) {
+        if (i == 4u && byte > 0x0Fu) {
+          break;
+        }
+        data_.remove_prefix(i + 1u);
+        return true;
+      }
+    }
+    return Fail();
+  }
+
+  bool ReadBytes(std::string_view& bytes) {
+    uint32_t size = 0u;
+    return ReadUint32(size) && ReadBytes(size, bytes);
+  }
+
+  bool ReadBytes(size_t size, std::string_view& bytes) {
+    if (data_.size() < size) {
+      return Fail();
+    }
+    bytes = data_.substr(0u, size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  bool IsAtEnd() const { return data_.empty(); }
+
+ private:
+  std::string_view data_;
+
+  bool Fail() {
+    data_ = {};
+    return false;
+  }
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(Reader);
+};
+
+}  // namespace
+
+static bool ReadString(Reader& reader,
+                       std::string_view source,
+                       std::string_view& string) {
+  uint32_t tagged_size = 0u;
+  if (!reader.ReadUint32(tagged_size)) {
+    return false;
+  }
+  const auto size = tagged_size >> 1u;
+  if ((tagged_size & 1u) == 0u) {
+    return reader.ReadBytes(size, string);
+  }
+  uint32_t offset = 0u;
+  if (!reader.ReadUint32(offset) || offset > source.size() ||
+      size > source.size() - offset) {
+    return false;
+  }
+  string = source.substr(offset, size);
+  return true;
+}
+
+static bool ReadBytecode(Reader& reader,
+                         std::string_view source,
+                         inja::Bytecode& bytecode) {
+  uint8_t op = 0u;
+  uint8_t flags = 0u;
+  uint32_t args = 0u;
+  std::string_view str;
+  std::string_view value;
+  if (!reader.ReadUint8(op) || !reader.ReadUint8(flags) ||
+      !reader.ReadUint32(args) || !reader.ReadUint32(bytecode.line) ||
+      !ReadString(reader, source, str) || !reader.ReadBytes(value)) {
+    return false;
+  }
+  if (op > static_cast<uint8_t>(inja::Bytecode::Op::EndLoop) ||
+      op == static_cast<uint8_t>(inja::Bytecode::Op::Include) ||
+      flags > inja::Bytecode::Flag::ValueMask || args >= (1u << 30u)) {
+    return false;
+  }
+  bytecode.op = static_cast<inja::Bytecode::Op>(op);
+  bytecode.flags = flags;
+  bytecode.args = args;
+  bytecode.str = std::string(str);
+  if (!value.empty()) {
+    bytecode.value = nlohmann::json::from_cbor(
+        reinterpret_cast<const uint8_t*>(value.data()),
+        reinterpret_cast<const uint8_t*>(value.data() + value.size()));
+  }
+  return true;
+}
+
+// The number of arguments of the ops of builtin functions. Zero for other ops.
+static uint32_t GetFunctionArity(inja::Bytecode::Op op) {
+  using Op = inja::Bytecode::Op;
+  switch (op) {
+    case Op::PrintValue:
+    case Op::Not:
+    case Op::Even:
+    case Op::First:
+    case Op::Float:
+    case Op::Int:
+    case Op::Last:
+    case Op::Length:
+    case Op::Lower:
+    case Op::Max:
+    case Op::Min:
+    case Op::Odd:
+    case Op::Range:
+    case Op::Sort:
+    case Op::Upper:
+    case Op::Exists:
+    case Op::IsBoolean:
+    case Op::IsNumber:
+    case Op::IsInteger:
+    case Op::IsFloat:
+    case Op::IsObject:
+    case Op::IsArray:
+    case Op::IsString:
+      return 1u;
+    case Op::And:
+    case Op::Or:
+    case Op::In:
+    case Op::Equal:
+    case Op::Greater:
+    case Op::GreaterEqual:
+    case Op::Less:
+    case Op::LessEqual:
+    case Op::At:
+    case Op::Different:
+    case Op::DivisibleBy:
+    case Op::Round:
+    case Op::ExistsInObject:
+    case Op::Default:
+      return 2u;
+    default:
+      return 0u;
+  }
+}
+
+// The renderer trusts the bytecodes to be generated by the parser. It does not
+// check the operand stack before popping values off it, that loops are paired
+// or that jumps stay within the bytecodes. So those are checked here. Each
+// bytecode must be reached with the same stack depth on every path and jumps
+// may not enter or leave loops.
+static bool AreBytecodesWellFormed(
+    const std::vector<inja::Bytecode>& bytecodes) {
+  using Op = inja::Bytecode::Op;
+  const auto count = bytecodes.size();
+
+  // The index of the StartLoop of the innermost loop each bytecode is in. The
+  // count if it is in none. The StartLoop itself is outside of its loop.
+  std::vector<size_t> loops(count + 1u, count);
+  std::vector<size_t> open_loops;
+  for (size_t i = 0; i < count; i++) {
+    loops[i] = open_loops.empty() ? count : open_loops.back();
+    if (bytecodes[i].op == Op::StartLoop) {
+      open_loops.push_back(i);
+    } else if (bytecodes[i].op == Op::EndLoop) {
+      // Empty loops jump to their EndLoop which jumps back to the first
+      // bytecode of the body otherwise.
+      if (open_loops.empty() || bytecodes[open_loops.back()].args != i ||
+          bytecodes[i].args != open_loops.back() + 1u) {
+        return false;
+      }
+      loops[i] = open_loops.back();
+      open_loops.pop_back();
+    }
+  }
+  if (!open_loops.empty()) {
+    return false;
+  }
+
+  constexpr auto kUnvisited = std::numeric_limits<size_t>::max();
+  std::vector<size_t> depths(count + 1u, kUnvisited);
+  std::vector<size_t> pending;
+  auto visit = [&](size_t index, size_t depth) {
+    if (depths[index] == kUnvisited) {
+      depths[index] = depth;
+      pending.push_back(index);
+      return true;
+    }
+    return depths[index] == depth;
+  };
+  auto visit_jump = [&](size_t from, size_t target, size_t depth) {
+    return target <= count && loops[target] == loops[from] &&
+           visit(target, depth);
+  };
+
+  visit(0u, 0u);
+  while (!pending.empty()) {
+    const auto index = pending.back();
+    pending.pop_back();
+    if (index == count) {
+      continue;
+    }
+    const auto& bytecode = bytecodes[index];
+    const uint32_t immediate =
+        (bytecode.flags & inja::Bytecode::Flag::ValueMask) !=
+                inja::Bytecode::Flag::ValuePop
+            ? 1u
+            : 0u;
+    size_t pops = 0u;
+    size_t pushes = 0u;
+    switch (bytecode.op) {
+      case Op::Nop:
+      case Op::PrintText:
+      case Op::EndLoop:
+        break;
+      case Op::Push:
+        if (immediate == 0u) {
+          return false;
+        }
+        pushes = 1u;
+        break;
+      case Op::Jump:
+      case Op::ConditionalJump:
+      case Op::StartLoop:
+        pops = bytecode.op == Op::Jump ? 0u : 1u;
+        break;
+      case Op::Callback:
+        if (bytecode.args < immediate) {
+          return false;
+        }
+        pops = bytecode.args - immediate;
+        pushes = 1u;
+        break;
+      case Op::Default:
+        // Replaces the value on the stack with the immediate if it exists.
+        if (immediate == 0u || bytecode.args != 2u) {
+          return false;
+        }
+        pops = 1u;
+        pushes = 1u;
+        break;
+      default: {
+        const auto arity = GetFunctionArity(bytecode.op);
+        if (arity == 0u || bytecode.args != arity) {
+          return false;
+        }
+        pops = arity - immediate;
+        pushes = bytecode.op == Op::PrintValue ? 0u : 1u;
+        break;
+      }
+    }
+    const auto depth = depths[index];
+    if (depth < pops) {
+      return false;
+    }
+    const auto next_depth = depth - pops + pushes;
+    switch (bytecode.op) {
+      case Op::Jump:
+        if (!visit_jump(index, bytecode.args, next_depth)) {
+          return false;
+        }
+        continue;
+      case Op::ConditionalJump:
+      case Op::EndLoop:
+        if (!visit_jump(index, bytecode.args, next_depth)) {
+          return false;
+        }
+        break;
+      case Op::StartLoop:
+        // Empty loops skip past their EndLoop.
+        if (!visit_jump(index, bytecode.args + 1u, next_depth)) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+    if (!visit(index + 1u, next_depth)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+CodeGen::ParseResult LoadCompiledTemplate(std::string_view data) {
+  if (!IsCompiledTemplate(data)) {
+    return {nullptr, "The data is not a compiled template."};
+  }
+  Reader reader(data.substr(sizeof(kMagic)));
+  for (const auto expected : kVersion) {
+    uint32_t version = 0u;
+    if (!reader.ReadUint32(version)) {
+      return {nullptr, "The compiled template is truncated."};
+    }
+    if (version != expected) {
+      return {nullptr,
+              "The template was compiled by a different version of Epoxy. "
+              "Compile the template again."};
+    }
+  }
+
+  auto parsed_template = std::make_shared<inja::Template>();
+  std::string_view source;
+  uint32_t count = 0u;
+  if (!reader.ReadBytes(source) || !reader.ReadUint32(count)) {
+    return {nullptr, "The compiled template is truncated."};
+  }
+  parsed_template->content = std::string(source);
+  // Bound the reservation by the size of the data in case the count is
+  // corrupt.
+  parsed_template->bytecodes.reserve(
+      std::min<size_t>(count, data.size() / kMinBytecodeSize));
+  try {
+    for (uint32_t i = 0; i < count; i++) {
+      inja::Bytecode bytecode;
+      if (!ReadBytecode(reader, source, bytecode)) {
+        return {nullptr, "The compiled template is malformed."};
+      }
+      parsed_template->bytecodes.emplace_back(std::move(bytecode));
+    }
+  } catch (const std::exception& e) {
+    return {nullptr, e.what()};
+  }
+  if (!reader.IsAtEnd()) {
+    return {nullptr, "The compiled template has trailing data."};
+  }
+  if (!AreBytecodesWellFormed(parsed_template->bytecodes)) {
+    return {nullptr, "The compiled template is malformed."};
+  }
+  return {std::move(parsed_template), std::nullopt};
+}
+
+const std::string& GetTemplateSource(const inja::Template& parsed_template) {
+  return parsed_template.content;
+}
+
+}  // namespace epoxy
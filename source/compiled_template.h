@@ -0,0 +1,35 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "code_gen.h"
+
+namespace epoxy {
+
+// Compiled templates are parsed templates serialized in a compact binary form.
+// Loading a compiled template skips parsing the template source. The source is
+// kept in the compiled template for diagnostics and profiling.
+
+// Whether the data is a compiled template instead of template source.
+bool IsCompiledTemplate(std::string_view data);
+
+struct CompileTemplateResult {
+  std::optional<std::string> result;
+  std::optional<std::string> error;
+};
+
+// Templates that include other templates cannot be compiled.
+CompileTemplateResult CompileTemplate(const inja::Template& parsed_template);
+
+// Compiled templates may only be loaded by the version of Epoxy that compiled
+// them.
+CodeGen::ParseResult LoadCompiledTemplate(std::string_view data);
+
+const std::string& GetTemplateSource(const inja::Template& parsed_template);
+
+}  // namespace epoxy
@@ -0,0 +1,158 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <inja.hpp>
+#include <string>
+
+#include "code_gen.h"
+#include "compiled_template.h"
+#include "compiler.h"
+#include "driver.h"
+#include "file.h"
+#include "fixture.h"
+#include "sema.h"
+
+namespace epoxy {
+namespace testing {
+
+static std::vector<Namespace> GetHelloNamespaces() {
+  auto idl = ReadFileAsString(EPOXY_EXAMPLES_LOCATION "hello.epoxy");
+  EXPECT_TRUE(idl.has_value());
+  Driver driver;
+  EXPECT_EQ(driver.Parse(idl.value_or("")), Driver::ParserResult::kSuccess);
+  Sema sema;
+  EXPECT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  return sema.GetNamespaces();
+}
+
+static std::string CompileTemplateSource(const std::string& source) {
+  auto parsed = CodeGen::ParseTemplate(source);
+  EXPECT_TRUE(parsed.result);
+  if (!parsed.result) {
+    return "";
+  }
+  auto compiled = CompileTemplate(*parsed.result);
+  EXPECT_TRUE(compiled.result.has_value());
+  return compiled.result.value_or("");
+}
+
+TEST(CompiledTemplateTest, RendersLikeTemplateSource) {
+  const auto namespaces = GetHelloNamespaces();
+  for (const auto& name : {"cxx_interface.template.epoxy",
+                           "cxx_impl.template.epoxy", "dart.template.epoxy"}) {
+    auto source =
+        ReadFileAsString(std::string{EPOXY_EXAMPLES_LOCATION} + name);
+    ASSERT_TRUE(source.has_value());
+
+    const auto compiled = CompileTemplateSource(source.value());
+    ASSERT_TRUE(IsCompiledTemplate(compiled));
+    ASSERT_FALSE(IsCompiledTemplate(source.value()));
+
+    auto loaded = LoadCompiledTemplate(compiled);
+    ASSERT_TRUE(loaded.result) << loaded.error.value_or("");
+    ASSERT_EQ(GetTemplateSource(*loaded.result), source.value());
+
+    auto expected = CodeGen(source.value()).Render(namespaces);
+    auto rendered = CodeGen::RenderTemplate(*loaded.result, namespaces);
+    ASSERT_TRUE(expected.result.has_value());
+    ASSERT_EQ(rendered.result, expected.result) << name;
+  }
+}
+
+TEST(CompiledTemplateTest, KeepsImmediateValues) {
+  const auto compiled = CompileTemplateSource(
+      R"~({% for x in [1, 2.5, "three", true] %}{{ x }},{% endfor %})~"
+      R"~({{ length("four") }}{{ default(missing, "five") }})~");
+  auto loaded = LoadCompiledTemplate(compiled);
+  ASSERT_TRUE(loaded.result);
+  auto rendered = CodeGen::RenderTemplate(*loaded.result, {});
+  ASSERT_EQ(rendered.result.value_or(""), "1,2.5,three,true,4five");
+}
+
+TEST(CompiledTemplateTest, RejectsTruncatedTemplates) {
+  const auto compiled = CompileTemplateSource(
+      "{% for ns in namespaces %}{{ ns.name }}{% endfor %}");
+  for (size_t size = 0; size < compiled.size(); size++) {
+    auto loaded = LoadCompiledTemplate(compiled.substr(0u, size));
+    ASSERT_FALSE(loaded.result) << size;
+    ASSERT_TRUE(loaded.error.has_value());
+  }
+  ASSERT_FALSE(LoadCompiledTemplate(compiled + "x").result);
+}
+
+TEST(CompiledTemplateTest, RejectsMalformedBytecodes) {
+  using Op = inja::Bytecode::Op;
+  auto parsed = CodeGen::ParseTemplate(
+      "{% for x in xs %}{% if x %}{{ x }}{% endif %}{% endfor %}");
+  ASSERT_TRUE(parsed.result);
+  auto find = [](std::vector<inja::Bytecode>& bytecodes, Op op) -> auto& {
+    return *std::find_if(
+        bytecodes.begin(), bytecodes.end(),
+        [&](const auto& bytecode) { return bytecode.op == op; });
+  };
+  const std::vector<std::function<void(std::vector<inja::Bytecode>&)>>
+      corruptions = {
+          // The loop is not closed.
+          [](auto& bytecodes) { bytecodes.pop_back(); },
+          // The iterable is not pushed.
+          [](auto& bytecodes) { bytecodes[0].op = Op::Nop; },
+          // The value to print is not pushed.
+          [&](auto& bytecodes) {
+            find(bytecodes, Op::PrintValue).flags =
+                inja::Bytecode::Flag::ValuePop;
+          },
+          // The function is given too many arguments.
+          [&](auto& bytecodes) { find(bytecodes, Op::PrintValue).args = 2u; },
+          // The jump is past the end.
+          [&](auto& bytecodes) {
+            find(bytecodes, Op::ConditionalJump).args = bytecodes.size() + 1u;
+          },
+          // The jump leaves the loop.
+          [&](auto& bytecodes) {
+            find(bytecodes, Op::ConditionalJump).args = bytecodes.size();
+          },
+          // The loop ends where it starts.
+          [&](auto& bytecodes) { find(bytecodes, Op::EndLoop).args = 0u; },
+      };
+  ASSERT_TRUE(LoadCompiledTemplate(
+                  CompileTemplate(*parsed.result).result.value_or(""))
+                  .result);
+  for (size_t i = 0; i < corruptions.size(); i++) {
+    auto corrupted = *parsed.result;
+    corruptions[i](corrupted.bytecodes);
+    auto compiled = CompileTemplate(corrupted);
+    ASSERT_TRUE(compiled.result.has_value()) << i;
+    auto loaded = LoadCompiledTemplate(compiled.result.value());
+    ASSERT_FALSE(loaded.result) << i;
+    ASSERT_EQ(loaded.error.value_or(""), "The compiled template is malformed.")
+        << i;
+  }
+}
+
+TEST(CompiledTemplateTest, RejectsOtherVersions) {
+  auto compiled = CompileTemplateSource("{{ epoxy_version }}");
+  // The major version follows the magic.
+  compiled[8]++;
+  auto loaded = LoadCompiledTemplate(compiled);
+  ASSERT_FALSE(loaded.result);
+  ASSERT_NE(loaded.error.value_or("").find("version"), std::string::npos);
+}
+
+TEST(CompiledTemplateTest, CompilerAcceptsCompiledTemplates) {
+  const std::string source =
+      "{% for ns in namespaces %}{{ ns.name }};{% endfor %}";
+  Compiler compiler;
+  auto result = compiler.Compile(
+      "foo.epoxy", "namespace foo {} namespace bar {}",
+      {source, CompileTemplateSource(source)});
+  ASSERT_TRUE(result.success);
+  ASSERT_EQ(result.outputs.size(), 2u);
+  ASSERT_EQ(result.outputs[0], result.outputs[1]);
+}
+
+}  // namespace testing
+}  // namespace epoxy
@@ -0,0 +1,160 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "compiler.h"
+
+#include <inja.hpp>
+#include <optional>
+
+#include "code_gen.h"
+#include "compiled_template.h"
+#include "driver.h"
+#include "module.h"
+#include "sema.h"
+
+namespace epoxy {
+
+Compiler::Compiler() : module_cache_(std::make_unique<ModuleCache>()) {}
+
+Compiler::~Compiler() = default;
+
+static std::optional<std::vector<Namespace>> ParseAndPerformSema(
+    const std::string& idl_file_name,
+    const std::string& idl,
+    ModuleCache& module_cache,
+    std::vector<Compiler::Diagnostic>& diagnostics) {
+  Driver driver(idl_file_name);
+  driver.SetModuleCache(&module_cache);
+  if (driver.Parse(idl) != Driver::ParserResult::kSuccess) {
+    for (const auto& error : driver.GetErrors()) {
+      Compiler::Diagnostic diagnostic;
+      diagnostic.phase = Compiler::Diagnostic::Phase::kParser;
+      diagnostic.file_name = idl_file_name;
+      diagnostic.line = error.location.begin.line;
+      diagnostic.column = error.location.begin.column;
+      diagnostic.message = error.message;
+      diagnostics.emplace_back(std::move(diagnostic));
+    }
+    if (driver.GetErrors().empty()) {
+      Compiler::Diagnostic diagnostic;
+      diagnostic.phase = Compiler::Diagnostic::Phase::kParser;
+      diagnostic.file_name = idl_file_name;
+      diagnostic.message = "Could not parse the IDL.";
+      diagnostics.emplace_back(std::move(diagnostic));
+    }
+    return std::nullopt;
+  }
+
+  Sema sema;
+  if (sema.Perform(driver.TakeNamespaces(), driver.GetImportedNamespaces()) !=
+      Sema::Result::kSuccess) {
+    for (const auto& error : sema.GetDiagnostics()) {
+      Compiler::Diagnostic diagnostic;
+      diagnostic.phase = Compiler::Diagnostic::Phase::kSema;
+      diagnostic.file_name = idl_file_name;
+      diagnostic.line = error.location.begin.line;
+      diagnostic.column = error.location.begin.column;
+      diagnostic.message = error.message;
+      diagnostics.emplace_back(std::move(diagnostic));
+    }
+    return std::nullopt;
+  }
+
+  return sema.GetNamespaces();
+}
+
+std::shared_ptr<const inja::Template> Compiler::GetTemplate(
+    const std::string& template_data,
+    std::vector<Diagnostic>& diagnostics) {
+  {
+    std::scoped_lock lock(templates_mutex_);
+    auto found = templates_.find(template_data);
+    if (found != templates_.end()) {
+      return found->second;
+    }
+  }
+
+  // Parse outside the lock so that compilations of unrelated templates don't
+  // serialize on each other.
+  auto parsed = IsCompiledTemplate(template_data)
+                    ? LoadCompiledTemplate(template_data)
+                    : CodeGen::ParseTemplate(template_data);
+  if (parsed.error.has_value() || !parsed.result) {
+    Diagnostic diagnostic;
+    diagnostic.phase = Diagnostic::Phase::kTemplate;
+    diagnostic.message = parsed.error.value_or("Could not parse template.");
+    diagnostics.emplace_back(std::move(diagnostic));
+    return nullptr;
+  }
+
+  std::scoped_lock lock(templates_mutex_);
+  return templates_.emplace(template_data, std::move(parsed.result))
+      .first->second;
+}
+
+Compiler::Result Compiler::Compile(const std::string& idl_file_name,
+                                   const std::string& idl,
+                                   const std::vector<std::string>& templates) {
+  Result result;
+
+  std::vector<std::shared_ptr<const inja::Template>> parsed_templates;
+  for (const auto& template_data : templates) {
+    parsed_templates.emplace_back(
+        GetTemplate(template_data, result.diagnostics));
+  }
+
+  auto namespaces = ParseAndPerformSema(idl_file_name, idl, *module_cache_,
+                                        result.diagnostics);
+
+  if (!namespaces.has_value() || !result.diagnostics.empty()) {
+    return result;
+  }
+
+  for (const auto& parsed_template : parsed_templates) {
+    auto render =
+        CodeGen::RenderTemplate(*parsed_template, namespaces.value());
+    if (render.error.has_value() || !render.result.has_value()) {
+      Diagnostic diagnostic;
+      diagnostic.phase = Diagnostic::Phase::kCodeGen;
+      diagnostic.file_name = idl_file_name;
+      diagnostic.message = render.error.value_or("Code generation failed.");
+      result.diagnostics.emplace_back(std::move(diagnostic));
+      result.outputs.clear();
+      return result;
+    }
+    result.outputs.emplace_back(std::move(render.result.value()));
+  }
+
+  result.success = true;
+  return result;
+}
+
+Compiler::Result Compiler::GenerateTemplateData(
+    const std::string& idl_file_name,
+    const std::string& idl) {
+  Result result;
+
+  auto namespaces = ParseAndPerformSema(idl_file_name, idl, *module_cache_,
+                                        result.diagnostics);
+  if (!namespaces.has_value()) {
+    return result;
+  }
+
+  CodeGen code_gen(std::string{});
+  result.outputs.emplace_back(
+      code_gen.GenerateTemplateDataJSON(namespaces.value()));
+  result.success = true;
+  return result;
+}
+
+size_t Compiler::GetCachedTemplateCount() const {
+  std::scoped_lock lock(templates_mutex_);
+  return templates_.size();
+}
+
+void Compiler::ClearTemplateCache() {
+  std::scoped_lock lock(templates_mutex_);
+  templates_.clear();
+}
+
+}  // namespace epoxy
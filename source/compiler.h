@@ -0,0 +1,80 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "macros.h"
+
+namespace inja {
+struct Template;
+}  // namespace inja
+
+namespace epoxy {
+
+class ModuleCache;
+
+// An in-process equivalent of the epoxy command line tool. All inputs and
+// outputs are buffers and nothing is written to the standard streams. The only
+// files read are the ones imported by the IDL, relative to the IDL file name.
+// A single compiler may be used from multiple threads concurrently. Templates
+// and imported files are parsed once per compiler and reused across
+// compilations. Imported files are parsed again once they are modified.
+class Compiler {
+ public:
+  struct Diagnostic {
+    enum class Phase {
+      kParser,
+      kSema,
+      kTemplate,
+      kCodeGen,
+    };
+    Phase phase = Phase::kParser;
+    std::string file_name;
+    size_t line = 0;
+    size_t column = 0;
+    std::string message;
+  };
+
+  struct Result {
+    bool success = false;
+    // One entry per template in the order in which the templates were
+    // specified. Empty if the compilation was not successful.
+    std::vector<std::string> outputs;
+    std::vector<Diagnostic> diagnostics;
+  };
+
+  Compiler();
+
+  ~Compiler();
+
+  // Templates may be template source or compiled templates.
+  Result Compile(const std::string& idl_file_name,
+                 const std::string& idl,
+                 const std::vector<std::string>& templates);
+
+  Result GenerateTemplateData(const std::string& idl_file_name,
+                              const std::string& idl);
+
+  size_t GetCachedTemplateCount() const;
+
+  void ClearTemplateCache();
+
+ private:
+  mutable std::mutex templates_mutex_;
+  std::map<std::string, std::shared_ptr<const inja::Template>> templates_;
+  std::unique_ptr<ModuleCache> module_cache_;
+
+  std::shared_ptr<const inja::Template> GetTemplate(
+      const std::string& template_data,
+      std::vector<Diagnostic>& diagnostics);
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(Compiler);
+};
+
+}  // namespace epoxy
@@ -0,0 +1,189 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compiler.h"
+#include "file.h"
+#include "fixture.h"
+
+namespace epoxy {
+namespace testing {
+
+static constexpr const char* kSimpleIDL = R"~(
+    namespace foo {
+      enum Color {
+        Red,
+        Green,
+      }
+      struct Foo {
+        int32_t a;
+        Color color;
+      }
+      function CreateFoo(Color color) -> Foo*
+    }
+  )~";
+
+static constexpr const char* kSimpleTemplate =
+    R"~({% for ns in namespaces %}{% for func in ns.functions %}{{func.name}};{% endfor %}{% endfor %})~";
+
+TEST(CompilerTest, CanCompileFromBuffers) {
+  Compiler compiler;
+  auto result = compiler.Compile("foo.epoxy", kSimpleIDL, {kSimpleTemplate});
+  ASSERT_TRUE(result.success);
+  ASSERT_TRUE(result.diagnostics.empty());
+  ASSERT_EQ(result.outputs.size(), 1u);
+  ASSERT_EQ(result.outputs[0], "CreateFoo;");
+}
+
+TEST(CompilerTest, CanRenderMultipleTemplates) {
+  Compiler compiler;
+  auto result = compiler.Compile(
+      "foo.epoxy", kSimpleIDL,
+      {kSimpleTemplate, "{% for ns in namespaces %}{{ns.name}}{% endfor %}"});
+  ASSERT_TRUE(result.success);
+  ASSERT_EQ(result.outputs.size(), 2u);
+  ASSERT_EQ(result.outputs[0], "CreateFoo;");
+  ASSERT_EQ(result.outputs[1], "foo");
+}
+
+TEST(CompilerTest, ParserErrorsHaveLocations) {
+  Compiler compiler;
+  auto result = compiler.Compile("bar.epoxy", R"~(namespace foo {
+  ;
+})~",
+                                 {kSimpleTemplate});
+  ASSERT_FALSE(result.success);
+  ASSERT_TRUE(result.outputs.empty());
+  ASSERT_EQ(result.diagnostics.size(), 1u);
+  const auto& diagnostic = result.diagnostics[0];
+  ASSERT_EQ(diagnostic.phase, Compiler::Diagnostic::Phase::kParser);
+  ASSERT_EQ(diagnostic.file_name, "bar.epoxy");
+  ASSERT_EQ(diagnostic.line, 2u);
+  ASSERT_EQ(diagnostic.column, 3u);
+  ASSERT_FALSE(diagnostic.message.empty());
+}
+
+TEST(CompilerTest, SemaErrorsAreReported) {
+  Compiler compiler;
+  auto result = compiler.Compile("foo.epoxy", R"~(
+    namespace foo {
+      function foo() -> Bar*
+    }
+  )~",
+                                 {kSimpleTemplate});
+  ASSERT_FALSE(result.success);
+  ASSERT_EQ(result.diagnostics.size(), 1u);
+  ASSERT_EQ(result.diagnostics[0].phase, Compiler::Diagnostic::Phase::kSema);
+  ASSERT_NE(result.diagnostics[0].message.find("Bar"), std::string::npos);
+}
+
+TEST(CompilerTest, TemplateErrorsAreReported) {
+  Compiler compiler;
+  auto result =
+      compiler.Compile("foo.epoxy", kSimpleIDL, {"{% for ns in namespaces %}"});
+  ASSERT_FALSE(result.success);
+  ASSERT_EQ(result.diagnostics.size(), 1u);
+  ASSERT_EQ(result.diagnostics[0].phase,
+            Compiler::Diagnostic::Phase::kTemplate);
+  ASSERT_EQ(compiler.GetCachedTemplateCount(), 0u);
+}
+
+TEST(CompilerTest, RenderErrorsAreReported) {
+  Compiler compiler;
+  auto result =
+      compiler.Compile("foo.epoxy", kSimpleIDL, {"{{ no_such_variable }}"});
+  ASSERT_FALSE(result.success);
+  ASSERT_TRUE(result.outputs.empty());
+  ASSERT_EQ(result.diagnostics.size(), 1u);
+  ASSERT_EQ(result.diagnostics[0].phase, Compiler::Diagnostic::Phase::kCodeGen);
+}
+
+TEST(CompilerTest, CanGenerateTemplateData) {
+  Compiler compiler;
+  auto result = compiler.GenerateTemplateData("foo.epoxy", kSimpleIDL);
+  ASSERT_TRUE(result.success);
+  ASSERT_EQ(result.outputs.size(), 1u);
+  ASSERT_NE(result.outputs[0].find("epoxy_version"), std::string::npos);
+  ASSERT_NE(result.outputs[0].find("CreateFoo"), std::string::npos);
+}
+
+TEST(CompilerTest, TemplatesAreParsedOnce) {
+  Compiler compiler;
+  ASSERT_EQ(compiler.GetCachedTemplateCount(), 0u);
+  ASSERT_TRUE(
+      compiler.Compile("foo.epoxy", kSimpleIDL, {kSimpleTemplate}).success);
+  ASSERT_EQ(compiler.GetCachedTemplateCount(), 1u);
+  ASSERT_TRUE(
+      compiler.Compile("foo.epoxy", kSimpleIDL, {kSimpleTemplate}).success);
+  ASSERT_EQ(compiler.GetCachedTemplateCount(), 1u);
+  compiler.ClearTemplateCache();
+  ASSERT_EQ(compiler.GetCachedTemplateCount(), 0u);
+}
+
+TEST(CompilerTest, CanCompileConcurrently) {
+  Compiler compiler;
+  std::vector<std::thread> threads;
+  std::vector<Compiler::Result> results(8u);
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back([&compiler, &results, i]() {
+      for (size_t j = 0; j < 16u; j++) {
+        results[i] =
+            compiler.Compile("foo.epoxy", kSimpleIDL, {kSimpleTemplate});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& result : results) {
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.outputs.size(), 1u);
+    ASSERT_EQ(result.outputs[0], "CreateFoo;");
+  }
+  ASSERT_EQ(compiler.GetCachedTemplateCount(), 1u);
+}
+
+TEST(CompilerTest, CanCompileFilesWithImportsConcurrently) {
+  const std::string file_name = EPOXY_FIXTURES_LOCATION "imports/main.epoxy";
+  const auto idl = ReadFileAsString(file_name);
+  ASSERT_TRUE(idl.has_value());
+  Compiler compiler;
+  std::vector<std::thread> threads;
+  std::vector<Compiler::Result> results(8u);
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back([&, i]() {
+      results[i] = compiler.Compile(file_name, idl.value(), {kSimpleTemplate});
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& result : results) {
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.outputs.size(), 1u);
+    ASSERT_EQ(result.outputs[0], "GetLength;GetOrigin;");
+  }
+}
+
+TEST(CompilerTest, AllSemaErrorsHaveLocations) {
+  Compiler compiler;
+  auto result = compiler.Compile("foo.epoxy", R"~(namespace foo {
+  function foo() -> Bar*
+  function bar(Baz* a) -> void
+})~",
+                                 {kSimpleTemplate});
+  ASSERT_FALSE(result.success);
+  ASSERT_EQ(result.diagnostics.size(), 2u);
+  ASSERT_EQ(result.diagnostics[0].line, 2u);
+  ASSERT_EQ(result.diagnostics[0].column, 12u);
+  ASSERT_EQ(result.diagnostics[1].line, 3u);
+  ASSERT_EQ(result.diagnostics[1].column, 16u);
+}
+
+}  // namespace testing
+}  // namespace epoxy
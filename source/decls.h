@@ -6,7 +6,12 @@
 #include "driver.h"
 #include "parser.h"
 
-#define YY_DECL \
-  epoxy::Parser::symbol_type epoxy_lex(epoxy::Driver& driver, void* yyscanner)
+#define YY_DECL                                                    \
+  epoxy::Parser::symbol_type epoxy_flex_lex(epoxy::Driver& driver, \
+                                            void* yyscanner)
 
 YY_DECL;
+
+// Called by the parser with the |epoxy::Scanner| that dispatches to the lexer
+// selected on the driver.
+epoxy::Parser::symbol_type epoxy_lex(epoxy::Driver& driver, void* scanner);
@@ -0,0 +1,807 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "descent_parser.h"
+
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace epoxy {
+
+using TokenKind = DescentParser::TokenKind;
+
+// The names bison uses for tokens in syntax error messages. These are the
+// aliases in epoxy.y with the quotes stripped, except for "," which bison
+// quotes because it contains a comma.
+static const char* GetTokenName(TokenKind kind) {
+  switch (kind) {
+    case TokenKind::kEnd:
+      return "<end of contents>";
+    case TokenKind::kNamespace:
+      return "namespace";
+    case TokenKind::kClass:
+      return "class";
+    case TokenKind::kStruct:
+      return "struct";
+    case TokenKind::kFunction:
+      return "function";
+    case TokenKind::kEnum:
+      return "enum";
+    case TokenKind::kImport:
+      return "import";
+    case TokenKind::kConst:
+      return "const";
+    case TokenKind::kAsync:
+      return "async";
+    case TokenKind::kInvalidToken:
+      return "<invalid token>";
+    case TokenKind::kSemiColon:
+      return ";";
+    case TokenKind::kCurlyLeft:
+      return "{";
+    case TokenKind::kCurlyRight:
+      return "}";
+    case TokenKind::kParenLeft:
+      return "(";
+    case TokenKind::kParenRight:
+      return ")";
+    case TokenKind::kComma:
+      return "\",\"";
+    case TokenKind::kBracketLeft:
+      return "[";
+    case TokenKind::kBracketRight:
+      return "]";
+    case TokenKind::kColon:
+      return ":";
+    case TokenKind::kEqual:
+      return "=";
+    case TokenKind::kVoid:
+      return "void";
+    case TokenKind::kInt8:
+      return "int8_t";
+    case TokenKind::kInt16:
+      return "int16_t";
+    case TokenKind::kInt32:
+      return "int32_t";
+    case TokenKind::kInt64:
+      return "int64_t";
+    case TokenKind::kUnsignedInt8:
+      return "uint8_t";
+    case TokenKind::kUnsignedInt16:
+      return "uint16_t";
+    case TokenKind::kUnsignedInt32:
+      return "uint32_t";
+    case TokenKind::kUnsignedInt64:
+      return "uint64_t";
+    case TokenKind::kDouble:
+      return "double";
+    case TokenKind::kFloat:
+      return "float";
+    case TokenKind::kStringType:
+      return "string";
+    case TokenKind::kArrow:
+      return "->";
+    case TokenKind::kStar:
+      return "*";
+    case TokenKind::kPlus:
+      return "+";
+    case TokenKind::kMinus:
+      return "-";
+    case TokenKind::kSlash:
+      return "/";
+    case TokenKind::kPercent:
+      return "%";
+    case TokenKind::kShiftLeft:
+      return "<<";
+    case TokenKind::kShiftRight:
+      return ">>";
+    case TokenKind::kAmpersand:
+      return "&";
+    case TokenKind::kPipe:
+      return "|";
+    case TokenKind::kIdentifier:
+      return "<identifier>";
+    case TokenKind::kString:
+      return "<string>";
+    case TokenKind::kNumber:
+      return "<number>";
+  }
+  return "<invalid token>";
+}
+
+// The symbol numbers of the generated parser are an implementation detail of
+// the bison version in use. Map them to token kinds by constructing each
+// token once.
+static std::vector<TokenKind> CreateTokenKindTable() {
+  const location l;
+  const std::pair<Parser::symbol_type, TokenKind> symbols[] = {
+      {Parser::make_END(l), TokenKind::kEnd},
+      {Parser::make_NAMESPACE(l), TokenKind::kNamespace},
+      {Parser::make_CLASS(l), TokenKind::kClass},
+      {Parser::make_STRUCT(l), TokenKind::kStruct},
+      {Parser::make_FUNCTION(l), TokenKind::kFunction},
+      {Parser::make_ENUM(l), TokenKind::kEnum},
+      {Parser::make_IMPORT(l), TokenKind::kImport},
+      {Parser::make_CONST(l), TokenKind::kConst},
+      {Parser::make_ASYNC(l), TokenKind::kAsync},
+      {Parser::make_INVALID_TOKEN(l), TokenKind::kInvalidToken},
+      {Parser::make_SEMI_COLON(l), TokenKind::kSemiColon},
+      {Parser::make_CURLY_LEFT(l), TokenKind::kCurlyLeft},
+      {Parser::make_CURLY_RIGHT(l), TokenKind::kCurlyRight},
+      {Parser::make_PAREN_LEFT(l), TokenKind::kParenLeft},
+      {Parser::make_PAREN_RIGHT(l), TokenKind::kParenRight},
+      {Parser::make_COMMA(l), TokenKind::kComma},
+      {Parser::make_BRACKET_LEFT(l), TokenKind::kBracketLeft},
+      {Parser::make_BRACKET_RIGHT(l), TokenKind::kBracketRight},
+      {Parser::make_COLON(l), TokenKind::kColon},
+      {Parser::make_EQUAL(l), TokenKind::kEqual},
+      {Parser::make_VOID_T(l), TokenKind::kVoid},
+      {Parser::make_INT_8_T(l), TokenKind::kInt8},
+      {Parser::make_INT_16_T(l), TokenKind::kInt16},
+      {Parser::make_INT_32_T(l), TokenKind::kInt32},
+      {Parser::make_INT_64_T(l), TokenKind::kInt64},
+      {Parser::make_UINT_8_T(l), TokenKind::kUnsignedInt8},
+      {Parser::make_UINT_16_T(l), TokenKind::kUnsignedInt16},
+      {Parser::make_UINT_32_T(l), TokenKind::kUnsignedInt32},
+      {Parser::make_UINT_64_T(l), TokenKind::kUnsignedInt64},
+      {Parser::make_DOUBLE(l), TokenKind::kDouble},
+      {Parser::make_FLOAT(l), TokenKind::kFloat},
+      {Parser::make_STRING_T(l), TokenKind::kStringType},
+      {Parser::make_ARROW(l), TokenKind::kArrow},
+      {Parser::make_STAR(l), TokenKind::kStar},
+      {Parser::make_PLUS(l), TokenKind::kPlus},
+      {Parser::make_MINUS(l), TokenKind::kMinus},
+      {Parser::make_SLASH(l), TokenKind::kSlash},
+      {Parser::make_PERCENT(l), TokenKind::kPercent},
+      {Parser::make_SHIFT_LEFT(l), TokenKind::kShiftLeft},
+      {Parser::make_SHIFT_RIGHT(l), TokenKind::kShiftRight},
+      {Parser::make_AMPERSAND(l), TokenKind::kAmpersand},
+      {Parser::make_PIPE(l), TokenKind::kPipe},
+      {Parser::make_IDENTIFIER({}, l), TokenKind::kIdentifier},
+      {Parser::make_STRING({}, l), TokenKind::kString},
+      {Parser::make_NUMBER(0u, l), TokenKind::kNumber},
+  };
+  std::vector<TokenKind> table;
+  for (const auto& symbol : symbols) {
+    const auto index = static_cast<size_t>(symbol.first.type_get());
+    if (table.size() <= index) {
+      table.resize(index + 1u, TokenKind::kInvalidToken);
+    }
+    table[index] = symbol.second;
+  }
+  return table;
+}
+
+static TokenKind GetTokenKind(const Parser::symbol_type& symbol) {
+  static const std::vector<TokenKind> kTable = CreateTokenKindTable();
+  const auto index = static_cast<size_t>(symbol.type_get());
+  return index < kTable.size() ? kTable[index] : TokenKind::kInvalidToken;
+}
+
+static std::optional<Primitive> GetPrimitive(TokenKind kind) {
+  switch (kind) {
+    case TokenKind::kVoid:
+      return Primitive::kVoid;
+    case TokenKind::kInt8:
+      return Primitive::kInt8;
+    case TokenKind::kInt16:
+      return Primitive::kInt16;
+    case TokenKind::kInt32:
+      return Primitive::kInt32;
+    case TokenKind::kInt64:
+      return Primitive::kInt64;
+    case TokenKind::kUnsignedInt8:
+      return Primitive::kUnsignedInt8;
+    case TokenKind::kUnsignedInt16:
+      return Primitive::kUnsignedInt16;
+    case TokenKind::kUnsignedInt32:
+      return Primitive::kUnsignedInt32;
+    case TokenKind::kUnsignedInt64:
+      return Primitive::kUnsignedInt64;
+    case TokenKind::kDouble:
+      return Primitive::kDouble;
+    case TokenKind::kFloat:
+      return Primitive::kFloat;
+    case TokenKind::kStringType:
+      return Primitive::kString;
+    default:
+      return std::nullopt;
+  }
+}
+
+static bool StartsVariable(TokenKind kind) {
+  return kind == TokenKind::kIdentifier || GetPrimitive(kind).has_value();
+}
+
+struct BinaryOperator {
+  Expression::Operator op;
+  int precedence;
+};
+
+// The precedences follow the order of the operator declarations in epoxy.y.
+// All operators are left associative.
+static std::optional<BinaryOperator> GetBinaryOperator(TokenKind kind) {
+  switch (kind) {
+    case TokenKind::kPipe:
+      return BinaryOperator{Expression::Operator::kBitwiseOr, 0};
+    case TokenKind::kAmpersand:
+      return BinaryOperator{Expression::Operator::kBitwiseAnd, 1};
+    case TokenKind::kShiftLeft:
+      return BinaryOperator{Expression::Operator::kShiftLeft, 2};
+    case TokenKind::kShiftRight:
+      return BinaryOperator{Expression::Operator::kShiftRight, 2};
+    case TokenKind::kPlus:
+      return BinaryOperator{Expression::Operator::kAdd, 3};
+    case TokenKind::kMinus:
+      return BinaryOperator{Expression::Operator::kSubtract, 3};
+    case TokenKind::kStar:
+      return BinaryOperator{Expression::Operator::kMultiply, 4};
+    case TokenKind::kSlash:
+      return BinaryOperator{Expression::Operator::kDivide, 4};
+    case TokenKind::kPercent:
+      return BinaryOperator{Expression::Operator::kRemainder, 4};
+    default:
+      return std::nullopt;
+  }
+}
+
+DescentParser::DescentParser(Driver& driver, Scanner& scanner)
+    : driver_(driver), scanner_(scanner) {}
+
+DescentParser::~DescentParser() = default;
+
+const DescentParser::Token& DescentParser::Peek() {
+  if (!has_lookahead_) {
+    auto symbol = scanner_.Lex(driver_);
+    lookahead_.kind = GetTokenKind(symbol);
+    if (lookahead_.kind == TokenKind::kIdentifier ||
+        lookahead_.kind == TokenKind::kString) {
+      lookahead_.identifier = std::move(symbol.value.as<std::string>());
+    } else if (lookahead_.kind == TokenKind::kNumber) {
+      lookahead_.number = symbol.value.as<uint64_t>();
+    }
+    lookahead_.location = symbol.location;
+    has_lookahead_ = true;
+  }
+  return lookahead_;
+}
+
+DescentParser::Token DescentParser::Take() {
+  Peek();
+  has_lookahead_ = false;
+  if (error_status_ > 0) {
+    error_status_--;
+  }
+  return std::move(lookahead_);
+}
+
+bool DescentParser::Accept(TokenKind kind) {
+  if (Peek().kind != kind) {
+    return false;
+  }
+  Take();
+  return true;
+}
+
+bool DescentParser::Expect(TokenKind kind) {
+  if (Accept(kind)) {
+    return true;
+  }
+  SyntaxError({kind});
+  return false;
+}
+
+std::optional<DescentParser::Token> DescentParser::ExpectIdentifier() {
+  if (Peek().kind != TokenKind::kIdentifier) {
+    SyntaxError({TokenKind::kIdentifier});
+    return std::nullopt;
+  }
+  return Take();
+}
+
+// Mirrors the verbose syntax errors of the bison generated parser. Bison only
+// lists up to four expected tokens. Sites that expect more pass no tokens.
+//
+// Error recovery also follows bison. Errors are not reported again till three
+// tokens have been consumed after the last one. Till then, the token that
+// caused the error is discarded instead.
+void DescentParser::SyntaxError(std::initializer_list<TokenKind> expected) {
+  const auto& token = Peek();
+  if (error_status_ == 0) {
+    std::stringstream stream;
+    stream << "syntax error, unexpected " << GetTokenName(token.kind);
+    const char* separator = ", expecting ";
+    for (const auto& kind : expected) {
+      stream << separator << GetTokenName(kind);
+      separator = " or ";
+    }
+    driver_.ReportParsingError(token.location, stream.str());
+  }
+  if (error_status_ == 3) {
+    if (token.kind == TokenKind::kEnd) {
+      aborted_ = true;
+      return;
+    }
+    has_lookahead_ = false;
+  }
+  error_status_ = 3;
+}
+
+// Skips tokens till the one that ends the malformed item. This is bison
+// shifting the error token in a "... error TOKEN" recovery rule.
+void DescentParser::RecoverAt(TokenKind kind) {
+  while (!aborted_ && !Accept(kind)) {
+    SyntaxError({});
+  }
+}
+
+bool DescentParser::Parse() {
+  while (true) {
+    if (Peek().kind == TokenKind::kImport) {
+      if (!ParseImport()) {
+        return false;
+      }
+      continue;
+    }
+    if (Peek().kind != TokenKind::kNamespace) {
+      break;
+    }
+    auto ns = ParseNamespace();
+    if (!ns.has_value()) {
+      return false;
+    }
+    driver_.AddNamespace(std::move(ns.value()));
+  }
+
+  if (Peek().kind != TokenKind::kEnd) {
+    SyntaxError({TokenKind::kEnd});
+    return false;
+  }
+
+  return true;
+}
+
+// Returns false if parsing had to be aborted. Errors outside namespaces cannot
+// be recovered from.
+bool DescentParser::ParseImport() {
+  Take();
+
+  if (Peek().kind != TokenKind::kString) {
+    SyntaxError({TokenKind::kString});
+    aborted_ = true;
+    return false;
+  }
+  auto path = Take();
+  if (!Expect(TokenKind::kSemiColon)) {
+    aborted_ = true;
+    return false;
+  }
+  driver_.AddImport(std::move(path.identifier), path.location);
+  return true;
+}
+
+// Returns nothing if parsing had to be aborted. Errors in items are recovered
+// from by skipping tokens till the next item.
+std::optional<Namespace> DescentParser::ParseNamespace() {
+  Take();
+
+  auto name = ExpectIdentifier();
+  if (!name.has_value() || !Expect(TokenKind::kCurlyLeft)) {
+    aborted_ = true;
+    return std::nullopt;
+  }
+
+  Namespace ns;
+  ns.SetName(name->identifier);
+
+  while (!aborted_) {
+    std::vector<std::string> attributes;
+    if (Peek().kind == TokenKind::kBracketLeft) {
+      auto parsed = ParseAttributes();
+      if (!parsed.has_value()) {
+        continue;
+      }
+      attributes = std::move(parsed.value());
+      const auto kind = Peek().kind;
+      if (kind != TokenKind::kStruct && kind != TokenKind::kFunction &&
+          kind != TokenKind::kEnum && kind != TokenKind::kAsync) {
+        SyntaxError({TokenKind::kStruct, TokenKind::kFunction,
+                     TokenKind::kEnum, TokenKind::kAsync});
+        continue;
+      }
+    }
+    const auto kind = Peek().kind;
+    switch (kind) {
+      case TokenKind::kStruct:
+        if (auto item = ParseStruct(); item.has_value()) {
+          item->SetAttributes(std::move(attributes));
+          ns.AddStruct(std::move(item.value()));
+        }
+        break;
+      case TokenKind::kAsync:
+        Take();
+        if (Peek().kind != TokenKind::kFunction) {
+          SyntaxError({TokenKind::kFunction});
+          break;
+        }
+        [[fallthrough]];
+      case TokenKind::kFunction:
+        if (auto item = ParseFunction(kind == TokenKind::kAsync);
+            item.has_value()) {
+          item->SetAttributes(std::move(attributes));
+          ns.AddFunction(std::move(item.value()));
+        }
+        break;
+      case TokenKind::kEnum:
+        if (auto item = ParseEnum(); item.has_value()) {
+          item->SetAttributes(std::move(attributes));
+          ns.AddEnum(std::move(item.value()));
+        }
+        break;
+      case TokenKind::kConst:
+        if (auto item = ParseConstant(); item.has_value()) {
+          ns.AddConstant(std::move(item.value()));
+        }
+        break;
+      case TokenKind::kCurlyRight:
+        Take();
+        return ns;
+      default:
+        // Items may also start with attributes. So bison expects too many
+        // tokens to list them.
+        SyntaxError({});
+        break;
+    }
+  }
+  return std::nullopt;
+}
+
+// Returns nothing after a syntax error. The caller recovers like it does from
+// errors in the item the attributes are applied to.
+std::optional<std::vector<std::string>> DescentParser::ParseAttributes() {
+  Take();
+
+  if (!Expect(TokenKind::kBracketLeft)) {
+    return std::nullopt;
+  }
+  std::vector<std::string> attributes;
+  while (true) {
+    auto name = ExpectIdentifier();
+    if (!name.has_value()) {
+      return std::nullopt;
+    }
+    attributes.emplace_back(std::move(name->identifier));
+    if (Accept(TokenKind::kBracketRight)) {
+      break;
+    }
+    if (!Accept(TokenKind::kComma)) {
+      SyntaxError({TokenKind::kComma, TokenKind::kBracketRight});
+      return std::nullopt;
+    }
+  }
+  if (!Expect(TokenKind::kBracketRight)) {
+    return std::nullopt;
+  }
+  return attributes;
+}
+
+std::optional<Enum> DescentParser::ParseEnum() {
+  Take();
+
+  auto name = ExpectIdentifier();
+  if (!name.has_value()) {
+    return std::nullopt;
+  }
+
+  std::optional<Primitive> underlying_type;
+  if (Accept(TokenKind::kColon)) {
+    underlying_type = GetPrimitive(Peek().kind);
+    if (!underlying_type.has_value()) {
+      SyntaxError({});
+      return std::nullopt;
+    }
+    Take();
+    if (!Expect(TokenKind::kCurlyLeft)) {
+      return std::nullopt;
+    }
+  } else if (!Accept(TokenKind::kCurlyLeft)) {
+    SyntaxError({TokenKind::kCurlyLeft, TokenKind::kColon});
+    return std::nullopt;
+  }
+
+  std::vector<EnumMember> members;
+  while (true) {
+    const auto& token = Peek();
+    if (token.kind == TokenKind::kCurlyRight) {
+      Take();
+      break;
+    }
+    if (token.kind != TokenKind::kIdentifier) {
+      SyntaxError({TokenKind::kCurlyRight, TokenKind::kIdentifier});
+      RecoverAt(TokenKind::kCurlyRight);
+      return std::nullopt;
+    }
+    auto identifier = Take();
+    EnumMember member{std::move(identifier.identifier), std::nullopt,
+                      identifier.location};
+    if (Accept(TokenKind::kEqual)) {
+      auto value = ParseExpression();
+      if (!value.has_value()) {
+        RecoverAt(TokenKind::kCurlyRight);
+        return std::nullopt;
+      }
+      member.value = std::move(value->expression);
+    }
+    members.emplace_back(std::move(member));
+    Accept(TokenKind::kComma);
+  }
+
+  Enum enumm{std::move(name->identifier), std::move(members)};
+  if (underlying_type.has_value()) {
+    enumm.SetUnderlyingType(underlying_type.value());
+  }
+  enumm.SetLocation(name->location);
+  return enumm;
+}
+
+std::optional<Function> DescentParser::ParseFunction(bool is_async) {
+  Take();
+
+  auto name = ExpectIdentifier();
+  if (!name.has_value() || !Expect(TokenKind::kParenLeft)) {
+    return std::nullopt;
+  }
+
+  auto function = ParseFunctionSignature(std::move(name.value()));
+  if (!function.has_value()) {
+    RecoverAt(TokenKind::kParenRight);
+    return std::nullopt;
+  }
+  function->SetAsync(is_async);
+  return function;
+}
+
+// Parses the function after the opening parenthesis of the argument list.
+std::optional<Function> DescentParser::ParseFunctionSignature(Token name) {
+  std::vector<Variable> arguments;
+  if (!Accept(TokenKind::kParenRight)) {
+    while (true) {
+      if (!StartsVariable(Peek().kind)) {
+        SyntaxError({});
+        return std::nullopt;
+      }
+      auto argument = ParseVariable(true);
+      if (!argument.has_value()) {
+        return std::nullopt;
+      }
+      arguments.emplace_back(std::move(argument.value()));
+      if (Accept(TokenKind::kParenRight)) {
+        break;
+      }
+      if (!Accept(TokenKind::kComma)) {
+        SyntaxError({TokenKind::kParenRight, TokenKind::kComma});
+        return std::nullopt;
+      }
+    }
+  }
+
+  Function::ReturnType return_type = Primitive::kVoid;
+  bool pointer_return = false;
+  if (Accept(TokenKind::kArrow)) {
+    if (auto primitive = AcceptPrimitive(); primitive.has_value()) {
+      return_type = primitive.value();
+    } else if (Peek().kind == TokenKind::kIdentifier) {
+      return_type = Take().identifier;
+    } else {
+      SyntaxError({});
+      return std::nullopt;
+    }
+    pointer_return = Accept(TokenKind::kStar);
+  }
+
+  Function function{std::move(name.identifier), std::move(arguments),
+                    std::move(return_type), pointer_return};
+  function.SetLocation(name.location);
+  return function;
+}
+
+std::optional<Struct> DescentParser::ParseStruct() {
+  Take();
+
+  auto name = ExpectIdentifier();
+  if (!name.has_value() || !Expect(TokenKind::kCurlyLeft)) {
+    return std::nullopt;
+  }
+
+  std::vector<Variable> variables;
+  while (!Accept(TokenKind::kCurlyRight)) {
+    std::vector<std::string> attributes;
+    if (Peek().kind == TokenKind::kBracketLeft) {
+      auto parsed = ParseAttributes();
+      if (!parsed.has_value()) {
+        RecoverAt(TokenKind::kCurlyRight);
+        return std::nullopt;
+      }
+      attributes = std::move(parsed.value());
+    }
+    if (!StartsVariable(Peek().kind)) {
+      SyntaxError({});
+      RecoverAt(TokenKind::kCurlyRight);
+      return std::nullopt;
+    }
+    auto variable = ParseVariable();
+    if (!variable.has_value()) {
+      RecoverAt(TokenKind::kCurlyRight);
+      return std::nullopt;
+    }
+    if (Accept(TokenKind::kBracketLeft)) {
+      auto length = ParseExpression();
+      if (!length.has_value()) {
+        RecoverAt(TokenKind::kCurlyRight);
+        return std::nullopt;
+      }
+      // Operators may also follow the length. So bison expects too many
+      // tokens to list them.
+      if (!Accept(TokenKind::kBracketRight)) {
+        SyntaxError({});
+        RecoverAt(TokenKind::kCurlyRight);
+        return std::nullopt;
+      }
+      variable->SetArrayLength(std::move(length->expression));
+    }
+    if (!Expect(TokenKind::kSemiColon)) {
+      RecoverAt(TokenKind::kCurlyRight);
+      return std::nullopt;
+    }
+    variable->SetAttributes(std::move(attributes));
+    variables.emplace_back(std::move(variable.value()));
+  }
+
+  Struct strut{std::move(name->identifier), std::move(variables)};
+  strut.SetLocation(name->location);
+  return strut;
+}
+
+// Errors in constants are recovered from like errors before the body of other
+// items. There are no recovery rules for constants in epoxy.y.
+std::optional<Constant> DescentParser::ParseConstant() {
+  Take();
+
+  auto type = AcceptPrimitive();
+  if (!type.has_value()) {
+    SyntaxError({});
+    return std::nullopt;
+  }
+  auto name = ExpectIdentifier();
+  if (!name.has_value() || !Expect(TokenKind::kEqual)) {
+    return std::nullopt;
+  }
+  auto expression = ParseExpression();
+  if (!expression.has_value()) {
+    return std::nullopt;
+  }
+  if (!Accept(TokenKind::kSemiColon)) {
+    SyntaxError({});
+    return std::nullopt;
+  }
+
+  Constant constant{type.value(), std::move(name->identifier),
+                    std::move(expression->expression)};
+  constant.SetLocation(name->location);
+  return constant;
+}
+
+// Parses operators with at least the minimum precedence by precedence
+// climbing. Like the reductions of bison, the location of a binary expression
+// spans both operands.
+std::optional<DescentParser::ParsedExpression> DescentParser::ParseExpression(
+    int min_precedence) {
+  auto lhs = ParsePrimaryExpression();
+  if (!lhs.has_value()) {
+    return std::nullopt;
+  }
+  while (true) {
+    const auto op = GetBinaryOperator(Peek().kind);
+    if (!op.has_value() || op->precedence < min_precedence) {
+      return lhs;
+    }
+    Take();
+    auto rhs = ParseExpression(op->precedence + 1);
+    if (!rhs.has_value()) {
+      return std::nullopt;
+    }
+    lhs->location.end = rhs->location.end;
+    lhs->expression =
+        Expression{op->op, std::move(lhs->expression),
+                   std::move(rhs->expression), lhs->location};
+  }
+}
+
+std::optional<DescentParser::ParsedExpression>
+DescentParser::ParsePrimaryExpression() {
+  switch (Peek().kind) {
+    case TokenKind::kNumber: {
+      auto token = Take();
+      return ParsedExpression{Expression{token.number}, token.location};
+    }
+    case TokenKind::kIdentifier: {
+      auto token = Take();
+      return ParsedExpression{
+          Expression{std::move(token.identifier), token.location},
+          token.location};
+    }
+    case TokenKind::kParenLeft: {
+      auto location = Take().location;
+      auto expression = ParseExpression();
+      if (!expression.has_value()) {
+        return std::nullopt;
+      }
+      if (Peek().kind != TokenKind::kParenRight) {
+        SyntaxError({});
+        return std::nullopt;
+      }
+      location.end = Take().location.end;
+      expression->location = location;
+      return expression;
+    }
+    default:
+      SyntaxError({TokenKind::kParenLeft, TokenKind::kIdentifier,
+                   TokenKind::kNumber});
+      return std::nullopt;
+  }
+}
+
+std::optional<Variable> DescentParser::ParseVariable(bool allows_slices) {
+  auto location = Peek().location;
+  auto primitive = AcceptPrimitive();
+  std::string user_type;
+  if (!primitive.has_value()) {
+    user_type = Take().identifier;
+  }
+
+  const auto takes_slice = allows_slices && primitive.has_value();
+  const auto is_slice = takes_slice && Accept(TokenKind::kBracketLeft);
+  if (is_slice && !Expect(TokenKind::kBracketRight)) {
+    return std::nullopt;
+  }
+
+  const auto is_pointer = !is_slice && Accept(TokenKind::kStar);
+  if (!is_slice && !is_pointer && Peek().kind != TokenKind::kIdentifier) {
+    if (takes_slice) {
+      SyntaxError({TokenKind::kBracketLeft, TokenKind::kStar,
+                   TokenKind::kIdentifier});
+    } else {
+      SyntaxError({TokenKind::kStar, TokenKind::kIdentifier});
+    }
+    return std::nullopt;
+  }
+
+  auto identifier = ExpectIdentifier();
+  if (!identifier.has_value()) {
+    return std::nullopt;
+  }
+  location.end = identifier->location.end;
+
+  std::optional<Variable> variable;
+  if (primitive.has_value()) {
+    variable = Variable{primitive.value(), std::move(identifier->identifier),
+                        is_pointer};
+  } else {
+    variable = Variable{std::move(user_type), std::move(identifier->identifier),
+                        is_pointer};
+  }
+  variable->SetSlice(is_slice);
+  variable->SetLocation(location);
+  return variable;
+}
+
+std::optional<Primitive> DescentParser::AcceptPrimitive() {
+  auto primitive = GetPrimitive(Peek().kind);
+  if (primitive.has_value()) {
+    Take();
+  }
+  return primitive;
+}
+
+}  // namespace epoxy
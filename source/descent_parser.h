@@ -0,0 +1,155 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "driver.h"
+#include "location.hh"
+#include "macros.h"
+#include "scanner.h"
+#include "types.h"
+
+namespace epoxy {
+
+// A hand-written recursive-descent parser for the grammar in epoxy.y. Items
+// are built in place instead of being copied through the semantic value stack
+// of the bison generated parser. Namespaces are added to the driver and syntax
+// errors reported to it at the same points, with the same locations and
+// messages, as the bison generated parser. It also recovers from syntax errors
+// the same way.
+class DescentParser {
+ public:
+  DescentParser(Driver& driver, Scanner& scanner);
+
+  ~DescentParser();
+
+  // Returns false if parsing had to be aborted because of a syntax error that
+  // could not be recovered from.
+  bool Parse();
+
+  // The kinds of tokens in the order they are declared in epoxy.y. Bison
+  // lists expected tokens in this order in syntax error messages.
+  enum class TokenKind {
+    kEnd,
+    kNamespace,
+    kClass,
+    kStruct,
+    kFunction,
+    kEnum,
+    kImport,
+    kConst,
+    kAsync,
+    kInvalidToken,
+    kSemiColon,
+    kCurlyLeft,
+    kCurlyRight,
+    kParenLeft,
+    kParenRight,
+    kComma,
+    kBracketLeft,
+    kBracketRight,
+    kColon,
+    kEqual,
+    kVoid,
+    kInt8,
+    kInt16,
+    kInt32,
+    kInt64,
+    kUnsignedInt8,
+    kUnsignedInt16,
+    kUnsignedInt32,
+    kUnsignedInt64,
+    kDouble,
+    kFloat,
+    kStringType,
+    kArrow,
+    kStar,
+    kPlus,
+    kMinus,
+    kSlash,
+    kPercent,
+    kShiftLeft,
+    kShiftRight,
+    kAmpersand,
+    kPipe,
+    kIdentifier,
+    kString,
+    kNumber,
+  };
+
+ private:
+  struct Token {
+    TokenKind kind = TokenKind::kEnd;
+    // The name of identifiers or the contents of strings.
+    std::string identifier;
+    uint64_t number = 0u;
+    class location location;
+  };
+
+  Driver& driver_;
+  Scanner& scanner_;
+  Token lookahead_;
+  bool has_lookahead_ = false;
+  // The number of tokens that must still be consumed after a syntax error
+  // before further syntax errors are reported. Like |yyerrstatus_| in bison.
+  int error_status_ = 0;
+  bool aborted_ = false;
+
+  const Token& Peek();
+
+  Token Take();
+
+  bool Accept(TokenKind kind);
+
+  std::optional<Token> ExpectIdentifier();
+
+  bool Expect(TokenKind kind);
+
+  void SyntaxError(std::initializer_list<TokenKind> expected);
+
+  void RecoverAt(TokenKind kind);
+
+  bool ParseImport();
+
+  std::optional<Namespace> ParseNamespace();
+
+  std::optional<std::vector<std::string>> ParseAttributes();
+
+  std::optional<Enum> ParseEnum();
+
+  // Async functions are preceded by the async keyword.
+  std::optional<Function> ParseFunction(bool is_async = false);
+
+  std::optional<Function> ParseFunctionSignature(Token name);
+
+  std::optional<Struct> ParseStruct();
+
+  std::optional<Constant> ParseConstant();
+
+  // Expressions do not keep the location of numbers and parentheses. So the
+  // location of the whole expression is tracked while parsing to give binary
+  // expressions the same locations as bison.
+  struct ParsedExpression {
+    Expression expression;
+    class location location;
+  };
+
+  std::optional<ParsedExpression> ParseExpression(int min_precedence = 0);
+
+  std::optional<ParsedExpression> ParsePrimaryExpression();
+
+  // Function arguments may also be slices of primitives.
+  std::optional<Variable> ParseVariable(bool allows_slices = false);
+
+  std::optional<Primitive> AcceptPrimitive();
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(DescentParser);
+};
+
+}  // namespace epoxy
@@ -0,0 +1,342 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include "driver.h"
+#include "file.h"
+#include "fixture.h"
+#include "synthetic_idl.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace epoxy {
+namespace testing {
+
+struct ParseOutcome {
+  Driver::ParserResult result = Driver::ParserResult::kParserError;
+  std::vector<std::string> errors;
+  nlohmann::json namespaces = nlohmann::json::array();
+  std::vector<std::string> locations;
+};
+
+template <class T>
+static std::string GetLocationString(const T& item) {
+  std::stringstream stream;
+  stream << item.GetLocation();
+  return stream.str();
+}
+
+static ParseOutcome ParseWith(const std::string& text,
+                              Driver::ParserType type) {
+  Driver driver;
+  driver.SetParserType(type);
+  ParseOutcome outcome;
+  outcome.result = driver.Parse(text);
+  for (const auto& error : driver.GetErrors()) {
+    std::stringstream stream;
+    stream << error.location << ": " << error.message;
+    outcome.errors.push_back(stream.str());
+  }
+  for (const auto& ns : driver.GetNamespaces()) {
+    outcome.namespaces.push_back(ns.GetJSONObject());
+    for (const auto& function : ns.GetFunctions()) {
+      outcome.locations.push_back(GetLocationString(function));
+      for (const auto& argument : function.GetArguments()) {
+        outcome.locations.push_back(GetLocationString(argument));
+      }
+    }
+    for (const auto& strut : ns.GetStructs()) {
+      outcome.locations.push_back(GetLocationString(strut));
+      for (const auto& variable : strut.GetVariables()) {
+        outcome.locations.push_back(GetLocationString(variable));
+      }
+    }
+    for (const auto& enumm : ns.GetEnums()) {
+      outcome.locations.push_back(GetLocationString(enumm));
+    }
+  }
+  return outcome;
+}
+
+static void ExpectSameOutcome(const std::string& text) {
+  const auto bison = ParseWith(text, Driver::ParserType::kBison);
+  const auto descent = ParseWith(text, Driver::ParserType::kDescent);
+  ASSERT_EQ(bison.result, descent.result) << "Text: " << text;
+  ASSERT_EQ(bison.errors, descent.errors) << "Text: " << text;
+  ASSERT_EQ(bison.namespaces, descent.namespaces) << "Text: " << text;
+  ASSERT_EQ(bison.locations, descent.locations) << "Text: " << text;
+}
+
+static std::string GetDescentError(const std::string& text) {
+  const auto outcome = ParseWith(text, Driver::ParserType::kDescent);
+  EXPECT_EQ(outcome.result, Driver::ParserResult::kSyntaxError);
+  return outcome.errors.empty() ? "" : outcome.errors.front();
+}
+
+TEST(DescentParserTest, CanParseExample) {
+  auto source = ReadFileAsString(EPOXY_EXAMPLES_LOCATION "hello.epoxy");
+  ASSERT_TRUE(source.has_value());
+  Driver driver;
+  driver.SetParserType(Driver::ParserType::kDescent);
+  ASSERT_EQ(driver.GetParserType(), Driver::ParserType::kDescent);
+  auto result = driver.Parse(source.value());
+  driver.PrettyPrintErrors(std::cerr, source.value());
+  ASSERT_EQ(result, Driver::ParserResult::kSuccess);
+  ASSERT_EQ(driver.GetNamespaces().size(), 1u);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetFunctions().size(), 12u);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetStructs().size(), 3u);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums().size(), 2u);
+}
+
+TEST(DescentParserTest, ReportsBisonMessages) {
+  ASSERT_EQ(GetDescentError("struct"),
+            "main.epoxy:1.1-6: syntax error, unexpected struct, expecting "
+            "<end of contents>");
+  ASSERT_EQ(GetDescentError("namespace foo { int8_t }"),
+            "main.epoxy:1.17-22: syntax error, unexpected int8_t");
+  ASSERT_EQ(GetDescentError("namespace foo { [[a]] int8_t }"),
+            "main.epoxy:1.23-28: syntax error, unexpected int8_t, expecting "
+            "struct or function or enum or async");
+  ASSERT_EQ(GetDescentError("namespace foo { async struct A {} }"),
+            "main.epoxy:1.23-28: syntax error, unexpected struct, expecting "
+            "function");
+  ASSERT_EQ(GetDescentError("namespace foo { [[a b]] }"),
+            "main.epoxy:1.21: syntax error, unexpected <identifier>, "
+            "expecting \",\" or ]");
+  ASSERT_EQ(GetDescentError("namespace foo { enum A { B, , } }"),
+            "main.epoxy:1.29: syntax error, unexpected \",\", expecting } or "
+            "<identifier>");
+  ASSERT_EQ(GetDescentError("namespace foo { struct A { ; } }"),
+            "main.epoxy:1.28: syntax error, unexpected ;");
+  ASSERT_EQ(GetDescentError("namespace foo { function A(int8_t a;"),
+            "main.epoxy:1.36: syntax error, unexpected ;, expecting ) or "
+            "\",\"");
+  ASSERT_EQ(GetDescentError("namespace foo { enum A B }"),
+            "main.epoxy:1.24: syntax error, unexpected <identifier>, "
+            "expecting { or :");
+  ASSERT_EQ(GetDescentError("namespace foo { struct A { float m[16] } }"),
+            "main.epoxy:1.40: syntax error, unexpected }, expecting ;");
+  ASSERT_EQ(GetDescentError("namespace foo { enum A { B = } }"),
+            "main.epoxy:1.30: syntax error, unexpected }, expecting ( or "
+            "<identifier> or <number>");
+  ASSERT_EQ(GetDescentError("namespace foo { const uint8_t A = 1 }"),
+            "main.epoxy:1.37: syntax error, unexpected }");
+  ASSERT_EQ(GetDescentError("namespace foo { const A = 1; }"),
+            "main.epoxy:1.23: syntax error, unexpected <identifier>");
+  ASSERT_EQ(GetDescentError("namespace foo { function A(float ) }"),
+            "main.epoxy:1.34: syntax error, unexpected ), expecting [ or * or "
+            "<identifier>");
+  ASSERT_EQ(GetDescentError("namespace foo { function A(float[ a) }"),
+            "main.epoxy:1.35: syntax error, unexpected <identifier>, "
+            "expecting ]");
+}
+
+TEST(DescentParserTest, MatchesBisonOnFixtures) {
+  const std::vector<std::string> fixtures = {
+      EPOXY_FIXTURES_LOCATION "error1_1.epoxy",
+      EPOXY_FIXTURES_LOCATION "error3_1.epoxy",
+      EPOXY_FIXTURES_LOCATION "error3_3.epoxy",
+      EPOXY_FIXTURES_LOCATION "error51_12.epoxy",
+      EPOXY_FIXTURES_LOCATION "error84_24.epoxy",
+      EPOXY_FIXTURES_LOCATION "error_pretty.epoxy",
+      EPOXY_FIXTURES_LOCATION "hello.txt",
+      EPOXY_EXAMPLES_LOCATION "hello.epoxy",
+  };
+  for (const auto& fixture : fixtures) {
+    auto text = ReadFileAsString(fixture);
+    ASSERT_TRUE(text.has_value()) << fixture;
+    ExpectSameOutcome(text.value());
+  }
+}
+
+TEST(DescentParserTest, MatchesBisonOnSyntheticIDL) {
+  SyntheticIDLOptions options;
+  options.namespaces = 3u;
+  options.enums_per_namespace = 5u;
+  options.structs_per_namespace = 5u;
+  options.functions_per_namespace = 10u;
+  ExpectSameOutcome(GenerateSyntheticIDL(options));
+}
+
+TEST(DescentParserTest, MatchesBisonOnEdgeCases) {
+  const std::vector<std::string> cases = {
+      "",
+      "namespace",
+      "namespace foo",
+      "namespace foo {",
+      "namespace foo {} namespace bar {} class",
+      "namespace foo { struct }",
+      "namespace foo { struct A }",
+      "namespace foo { struct A { }",
+      "namespace foo { struct A { int8_t } }",
+      "namespace foo { struct A { int8_t * } }",
+      "namespace foo { struct A { int8_t a } }",
+      "namespace foo { struct A { B b; C * c; } }",
+      "namespace foo { struct A { B b; -> } }",
+      "namespace foo { enum }",
+      "namespace foo { enum A }",
+      "namespace foo { enum A { } }",
+      "namespace foo { enum A { B } }",
+      "namespace foo { enum A { B, } }",
+      "namespace foo { enum A { B C D, E, } }",
+      "namespace foo { enum A { B ; } }",
+      "namespace foo { enum A { B, ; } }",
+      "namespace foo { function }",
+      "namespace foo { function A }",
+      "namespace foo { function A( }",
+      "namespace foo { function A() }",
+      "namespace foo { function A() -> }",
+      "namespace foo { function A() -> ; }",
+      "namespace foo { function A() -> B* }",
+      "namespace foo { function A() -> void * * }",
+      "namespace foo { function A(int8_t) }",
+      "namespace foo { function A(int8_t a }",
+      "namespace foo { function A(int8_t a, ) }",
+      "namespace foo { function A(int8_t a, B* b) -> uint64_t }",
+      "namespace foo { function A() ; }",
+      "namespace foo { function A() -> int8_t ; }",
+      "namespace foo { function A() -> int8_t * ; }",
+      "namespace foo { $ }",
+      "namespace foo { struct A { int8_t $; } }",
+      "namespace foo { function A() -> B } }",
+      "import",
+      "import a;",
+      "import \"a.epoxy\"",
+      "import \"a.epoxy\" namespace foo {}",
+      "namespace foo {} import ;",
+      "namespace foo { import \"a.epoxy\"; }",
+      "import \"missing.epoxy\"; namespace foo {}",
+      "namespace foo { [[a]] struct A {} }",
+      "namespace foo { [[a, b]] function A() [[c]] enum B {} }",
+      "namespace foo { [[a]] }",
+      "namespace foo { [ }",
+      "namespace foo { [[ }",
+      "namespace foo { [[]] struct A {} }",
+      "namespace foo { [[a,]] struct A {} }",
+      "namespace foo { [[a] struct A {} }",
+      "namespace foo { [[a]] struct A { ; } struct B {} }",
+      "namespace foo { [[a]] struct { } struct B {} }",
+      "namespace foo { [[a]] function A(; ) function B() }",
+      "namespace foo { [[a]] enum A { ; } enum B {} }",
+      "namespace foo { struct A { [[a]] int8_t a; [[b, c]] B* b; } }",
+      "namespace foo { struct A { [[a]] ; } struct B {} }",
+      "namespace foo { struct A { [[a int8_t a; } struct B {} }",
+      "namespace foo { struct A { int8_t a [[b]]; } }",
+      "namespace foo { function A([[a]] int8_t a) }",
+      "namespace foo { enum A : uint8_t { B, C } }",
+      "namespace foo { enum A : double {} }",
+      "namespace foo { enum A : B { C } enum D {} }",
+      "namespace foo { enum A : { B } }",
+      "namespace foo { enum A uint8_t { B } }",
+      "namespace foo { enum A : uint8_t B } enum C {} }",
+      "namespace foo { [[a]] enum A : int16_t { ; } enum B {} }",
+      "namespace foo { enum A : uint8_t : uint8_t {} }",
+      "namespace foo { enum A { B = 1, C = 0x2f D = 010, E } }",
+      "namespace foo { enum A { B = } enum C {} }",
+      "namespace foo { enum A { B = C } enum D {} }",
+      "namespace foo { enum A { B 1 } enum C {} }",
+      "namespace foo { enum A { = 1 } enum B {} }",
+      "namespace foo { enum A { B = 1 = 2 } enum C {} }",
+      "namespace foo { enum A { B = 0x } enum C {} }",
+      "namespace foo { enum A { B = 99999999999999999999 } enum C {} }",
+      "namespace foo { [[flags]] enum A : uint32_t { B = 0xFFFFFFFF } }",
+      "namespace foo { struct A { int8_t a = 1; } }",
+      "namespace foo { struct A { float m[16]; [[a]] B* b[0x2]; } }",
+      "namespace foo { struct A { float m[]; } struct B {} }",
+      "namespace foo { struct A { float m[16]  } struct B {} }",
+      "namespace foo { struct A { float m[16; } struct B {} }",
+      "namespace foo { struct A { float m 16]; } struct B {} }",
+      "namespace foo { struct A { float m[a]; } struct B {} }",
+      "namespace foo { struct A { float m[1][2]; } struct B {} }",
+      "namespace foo { function A(float m[16]) function B() }",
+      "namespace foo { const uint32_t A = 16; const int8_t B = A * 2 + 1; }",
+      "namespace foo { const uint32_t A = (1 + 2) * 3 << 4 | 5 & 6 % 7; }",
+      "namespace foo { const uint32_t A = 1 - 2 - 3 / 4 >> 5; }",
+      "namespace foo { const uint32_t A = ((B)); struct C { float m[A]; } }",
+      "namespace foo { const uint32_t A = 1; enum B { C = A, D = A + 1 } }",
+      "namespace foo { const uint32_t A = ; struct B {} }",
+      "namespace foo { const uint32_t A 1; struct B {} }",
+      "namespace foo { const uint32_t = 1; struct B {} }",
+      "namespace foo { const A = 1; struct B {} }",
+      "namespace foo { const uint32_t A = 1 struct B {} }",
+      "namespace foo { const uint32_t A = 1 2; struct B {} }",
+      "namespace foo { const uint32_t A = (1 + 2; struct B {} }",
+      "namespace foo { const uint32_t A = 1 +; struct B {} }",
+      "namespace foo { const uint32_t A = 1 + * 2; struct B {} }",
+      "namespace foo { [[a]] const uint32_t A = 1; struct B {} }",
+      "namespace foo { const void* A = 1; struct B {} }",
+      "namespace foo { struct A { float m[2 * B]; float n[(1]; } }",
+      "namespace foo { struct A { float m[1 +]; } struct B {} }",
+      "namespace foo { enum A { B = 1 + , C } enum D {} }",
+      "namespace foo { enum A { B = (1 } enum D {} }",
+      "namespace foo { enum A { B = 1 << 2 C = 3 } }",
+      "namespace foo { const uint32_t A = 1; } namespace bar { }",
+      "namespace foo { function A(float[] a, int8_t* b, uint64_t[] c) }",
+      "namespace foo { function A(void[] a) -> double }",
+      "namespace foo { function A(float[]) function B() }",
+      "namespace foo { function A(float[] * a) function B() }",
+      "namespace foo { function A(float[16] a) function B() }",
+      "namespace foo { function A(float [ ] a, B[] b) function C() }",
+      "namespace foo { function A(float*[] a) function B() }",
+      "namespace foo { function A([[a]] float[] a) function B() }",
+      "namespace foo { struct A { float[] a; } struct B {} }",
+      "namespace foo { function A() -> float[] }",
+      "namespace foo { function A(string a, string[] b) -> string }",
+      "namespace foo { function A(string* a) -> string* }",
+      "namespace foo { struct A { string a; string b[2]; } }",
+      "namespace foo { const string A = 1; enum B : string { C } }",
+      "namespace foo { function A(string) function B() }",
+      "namespace foo { async function A() async function B(int8_t a) }",
+      "namespace foo { [[a]] async function A() -> int8_t }",
+      "namespace foo { async }",
+      "namespace foo { async async function A() }",
+      "namespace foo { async function A(; function B() }",
+      "namespace foo { [[a]] async function A(; async struct B {} }",
+      "namespace foo { async [[a]] function A() }",
+  };
+  for (const auto& text : cases) {
+    ExpectSameOutcome(text);
+  }
+}
+
+TEST(DescentParserTest, MatchesBisonOnRandomTokens) {
+  const std::vector<std::string> vocabulary = {
+      "namespace", "struct", "enum", "function", "class", "{", "}", "(",
+      ")",         ";",      ",",    "->",       "*",     "a", "b", "int8_t",
+      "void",      "double", "$",    "[",        "]",     "[[", "]]",
+      ":",         "uint8_t", "=",     "1",        "0x1f",  "const",
+      "+",         "-",       "<<",    "|",       "async",
+  };
+  std::mt19937 generator(1u);
+  for (size_t i = 0; i < 2000u; i++) {
+    std::string text = "namespace foo { ";
+    const auto length = generator() % 16u;
+    for (size_t j = 0; j < length; j++) {
+      text += vocabulary[generator() % vocabulary.size()] + " ";
+    }
+    ExpectSameOutcome(text);
+  }
+}
+
+TEST(DescentParserTest, MatchesBisonOnMutatedExample) {
+  auto source = ReadFileAsString(EPOXY_EXAMPLES_LOCATION "hello.epoxy");
+  ASSERT_TRUE(source.has_value());
+  const std::vector<std::string> replacements = {
+      "", ";", ",", "{", "}", "(", ")", "->", "*", "a", "int8_t", "struct",
+  };
+  std::mt19937 generator(1u);
+  for (size_t i = 0; i < 500u; i++) {
+    auto text = source.value();
+    const auto offset = generator() % text.size();
+    const auto length = generator() % 4u;
+    text.replace(offset, length,
+                 replacements[generator() % replacements.size()]);
+    ExpectSameOutcome(text);
+  }
+}
+
+}  // namespace testing
+}  // namespace epoxy
@@ -0,0 +1,56 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "diagnostic.h"
+
+#include <algorithm>
+
+#include "file.h"
+
+namespace epoxy {
+
+static void UnderscoreErrorInText(std::ostream& stream,
+                                  const location& position,
+                                  const LineIndex& index) {
+  auto line = index.GetLine(position.begin.line);
+  if (!line.has_value()) {
+    return;
+  }
+
+  std::string pad(2u, ' ');
+
+  stream << pad << line.value() << std::endl;
+
+  const auto column =
+      std::max<size_t>(static_cast<size_t>(position.begin.column), 1u);
+
+  std::string bar(column - 1, '-');
+
+  stream << pad << bar << "^" << std::endl;
+}
+
+void PrettyPrintDiagnostics(std::ostream& stream,
+                            const std::vector<Diagnostic>& diagnostics,
+                            const std::string& original_text) {
+  const LineIndex index(original_text);
+  for (const auto& diagnostic : diagnostics) {
+    const auto* severity =
+        diagnostic.severity == Diagnostic::Severity::kWarning ? "warning: "
+                                                              : "error: ";
+    const auto& begin = diagnostic.location.begin;
+    if (begin.line == 0) {
+      stream << severity << diagnostic.message << std::endl;
+      continue;
+    }
+    if (begin.filename != nullptr) {
+      stream << *begin.filename << ":";
+    }
+    stream << begin.line << ":" << begin.column << ": " << severity
+           << diagnostic.message << std::endl;
+    if (!original_text.empty()) {
+      UnderscoreErrorInText(stream, diagnostic.location, index);
+    }
+  }
+}
+
+}  // namespace epoxy
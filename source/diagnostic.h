@@ -0,0 +1,34 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "location.hh"
+
+namespace epoxy {
+
+struct Diagnostic {
+  enum class Severity {
+    kError,
+    kWarning,
+  };
+
+  class location location;
+  std::string message;
+  Severity severity = Severity::kError;
+};
+
+// Prints each diagnostic as "file:line:column: error: message" (or "warning:"
+// for warnings). If the original text is specified, the offending line is
+// printed with the column underscored. The text is indexed once for all
+// diagnostics. Diagnostics not caused by the text (like those for command line
+// options) have a line of zero and are printed as "error: message".
+void PrettyPrintDiagnostics(std::ostream& stream,
+                            const std::vector<Diagnostic>& diagnostics,
+                            const std::string& original_text = "");
+
+}  // namespace epoxy
@@ -3,19 +3,23 @@
 
 #include "driver.h"
 
-#include "file.h"
+#include "descent_parser.h"
+#include "module.h"
 #include "scanner.h"
 
 #include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 
 namespace epoxy {
 
 Driver::Driver(std::string advisory_file_name)
-    : advisory_file_name_(std::move(advisory_file_name)) {
-  location_.initialize(&advisory_file_name_);
+    : file_name_(std::make_shared<const std::string>(
+          std::move(advisory_file_name))) {
+  location_.initialize(file_name_.get());
 }
 
 Driver::~Driver() = default;
@@ -24,18 +28,62 @@ void Driver::AddNamespace(Namespace ns) {
   namespaces_.emplace_back(std::move(ns));
 }
 
+void Driver::AddImport(std::string path, const class location& location) {
+  imports_.emplace_back(Import{std::move(path), location});
+}
+
+void Driver::SetLexerType(LexerType type) {
+  lexer_type_ = type;
+}
+
+Driver::LexerType Driver::GetLexerType() const {
+  return lexer_type_;
+}
+
+void Driver::SetParserType(ParserType type) {
+  parser_type_ = type;
+}
+
+Driver::ParserType Driver::GetParserType() const {
+  return parser_type_;
+}
+
+void Driver::SetModuleCache(ModuleCache* cache) {
+  module_cache_ = cache;
+}
+
 Driver::ParserResult Driver::Parse(const std::string& text) {
-  Scanner scanner(text);
+  const auto result = ParseText(text);
+  if (result != ParserResult::kSuccess || imports_.empty()) {
+    return result;
+  }
+  return ResolveImports();
+}
+
+Driver::ParserResult Driver::ParseText(const std::string& text) {
+  Scanner scanner(text, lexer_type_, location_);
 
   if (!scanner.IsValid()) {
     return ParserResult::kParserError;
   }
 
-  Parser parser(*this, scanner.GetHandle());
+  // Both parsers recover from syntax errors to report as many as possible. The
+  // parse is only successful if none were reported.
+  const auto errors_count = errors_.size();
+
+  if (parser_type_ == ParserType::kDescent) {
+    DescentParser parser(*this, scanner);
+    return parser.Parse() && errors_.size() == errors_count
+               ? ParserResult::kSuccess
+               : ParserResult::kSyntaxError;
+  }
+
+  Parser parser(*this, &scanner);
 
   switch (parser.parse()) {
     case 0: /* parsing was successful (return is due to end-of-input) */
-      return ParserResult::kSuccess;
+      return errors_.size() == errors_count ? ParserResult::kSuccess
+                                            : ParserResult::kSyntaxError;
     case 1: /* contains a syntax error */
       return ParserResult::kSyntaxError;
     case 2: /* memory exhaustion */
@@ -45,46 +93,95 @@ Driver::ParserResult Driver::Parse(const std::string& text) {
   return ParserResult::kParserError;
 }
 
+// Modules imported by more than one file (directly or not) are only added
+// once. So their items are not duplicated.
+Driver::ParserResult Driver::ResolveImports() {
+  const auto directory =
+      std::filesystem::path(*file_name_).parent_path();
+  std::unordered_set<std::string> added;
+  auto add_module = [&](const std::shared_ptr<const Module>& module) {
+    if (added.insert(module->GetPath()).second) {
+      imported_modules_.push_back(module);
+    }
+  };
+
+  if (module_cache_ == nullptr) {
+    own_module_cache_ = std::make_unique<ModuleCache>();
+    module_cache_ = own_module_cache_.get();
+  }
+
+  const auto errors_count = errors_.size();
+  for (const auto& import : imports_) {
+    const auto path = (directory / import.path).string();
+    auto loaded = module_cache_->Load(path, lexer_type_, parser_type_);
+    if (!loaded.module) {
+      ReportParsingError(import.location, loaded.error.value_or(""));
+      continue;
+    }
+    if (!loaded.module->GetErrors().empty()) {
+      for (const auto& error : loaded.module->GetErrors()) {
+        ReportParsingError(import.location, "In imported file: " + error);
+      }
+      continue;
+    }
+    for (const auto& module : loaded.module->GetImports()) {
+      add_module(module);
+    }
+    add_module(loaded.module);
+  }
+
+  if (errors_.size() != errors_count) {
+    imported_modules_.clear();
+    return ParserResult::kImportError;
+  }
+  return ParserResult::kSuccess;
+}
+
 void Driver::ReportParsingError(const class location& location,
                                 const std::string& message) {
   errors_.emplace_back(Driver::Error{location, message});
 }
 
-static void UnderscoreErrorInText(std::ostream& stream,
-                                  const location& position,
-                                  const std::string& original_text) {
-  if (original_text.empty()) {
-    return;
-  }
-  auto line = GetLineInString(original_text, position.begin.line);
-  if (!line.has_value()) {
-    return;
-  }
-
-  std::string pad(2u, ' ');
+void Driver::PrettyPrintErrors(std::ostream& stream,
+                               const std::string& original_text) const {
+  PrettyPrintDiagnostics(stream, errors_, original_text);
+}
 
-  stream << pad << line.value() << std::endl;
+const std::string& Driver::GetFileName() const {
+  return *file_name_;
+}
 
-  const auto column =
-      std::max<size_t>(static_cast<size_t>(position.begin.column), 1u);
+std::shared_ptr<const std::string> Driver::GetSharedFileName() const {
+  return file_name_;
+}
 
-  std::string bar(column - 1, '-');
+const std::vector<Namespace>& Driver::GetNamespaces() const {
+  return namespaces_;
+}
 
-  stream << pad << bar << "^" << std::endl;
+std::vector<Namespace> Driver::TakeNamespaces() {
+  auto namespaces = std::move(namespaces_);
+  namespaces_.clear();
+  return namespaces;
 }
 
-void Driver::PrettyPrintErrors(std::ostream& stream,
-                               const std::string& original_text) const {
-  for (const auto& error : errors_) {
-    const auto& error_begin = error.location.begin;
-    stream << *error_begin.filename << ":" << error_begin.line << ":"
-           << error_begin.column << ": error: " << error.message << std::endl;
-    UnderscoreErrorInText(stream, error.location, original_text);
+std::vector<const Namespace*> Driver::GetImportedNamespaces() const {
+  std::vector<const Namespace*> namespaces;
+  for (const auto& module : imported_modules_) {
+    for (const auto& ns : module->GetNamespaces()) {
+      namespaces.push_back(&ns);
+    }
   }
+  return namespaces;
 }
 
-const std::vector<Namespace>& Driver::GetNamespaces() const {
-  return namespaces_;
+const std::vector<std::shared_ptr<const Module>>& Driver::GetImportedModules()
+    const {
+  return imported_modules_;
+}
+
+const std::vector<Driver::Error>& Driver::GetErrors() const {
+  return errors_;
 }
 
 location Driver::GetCurrentLocation() const {
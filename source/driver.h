@@ -3,13 +3,18 @@
 
 #pragma once
 
+#include "diagnostic.h"
 #include "location.hh"
 #include "types.h"
 
+#include <memory>
 #include <vector>
 
 namespace epoxy {
 
+class Module;
+class ModuleCache;
+
 class Driver {
  public:
   enum class ParserResult {
@@ -17,18 +22,71 @@ class Driver {
     kSyntaxError,
     kParserError,
     kOutOfMemory,
+    kImportError,
+  };
+
+  enum class LexerType {
+    // The table driven lexer generated by flex from epoxy.l.
+    kFlex,
+    // The hand-written lexer in fast_lexer.h.
+    kFast,
   };
 
+  enum class ParserType {
+    // The LALR parser generated by bison from epoxy.y.
+    kBison,
+    // The hand-written recursive-descent parser in descent_parser.h.
+    kDescent,
+  };
+
+  using Error = Diagnostic;
+
   Driver(std::string advisory_file_name = "main.epoxy");
 
   ~Driver();
 
+  void SetLexerType(LexerType type);
+
+  LexerType GetLexerType() const;
+
+  void SetParserType(ParserType type);
+
+  ParserType GetParserType() const;
+
+  // The cache imports are loaded from. It must outlive calls to |Parse|.
+  // Drivers without one use a cache of their own.
+  void SetModuleCache(ModuleCache* cache);
+
+  // Imports are resolved relative to the directory of the advisory file name
+  // once the text has been parsed without errors.
   ParserResult Parse(const std::string& text);
 
+  const std::string& GetFileName() const;
+
+  // The storage of the file name the locations of parsed items refer to. It
+  // may be kept alive after the driver is gone.
+  std::shared_ptr<const std::string> GetSharedFileName() const;
+
+  // The namespaces in the text. Those of imported modules are not included.
   const std::vector<Namespace>& GetNamespaces() const;
 
+  // Moves the namespaces in the text out of the driver.
+  std::vector<Namespace> TakeNamespaces();
+
+  // The namespaces of the modules in |GetImportedModules|. These are owned by
+  // the modules and have already been checked by Sema.
+  std::vector<const Namespace*> GetImportedNamespaces() const;
+
+  // The modules imported directly or indirectly. Each module is listed once
+  // and after the modules it imports.
+  const std::vector<std::shared_ptr<const Module>>& GetImportedModules() const;
+
+  const std::vector<Error>& GetErrors() const;
+
   void AddNamespace(Namespace ns);
 
+  void AddImport(std::string path, const class location& location);
+
   void PrettyPrintErrors(std::ostream& stream,
                          const std::string& original_text = "") const;
 
@@ -40,14 +98,25 @@ class Driver {
                           const std::string& message);
 
  private:
-  struct Error {
+  struct Import {
+    std::string path;
     class location location;
-    std::string message;
   };
+
   std::vector<Namespace> namespaces_;
+  std::vector<Import> imports_;
+  std::vector<std::shared_ptr<const Module>> imported_modules_;
   std::vector<Error> errors_;
-  std::string advisory_file_name_;
+  std::shared_ptr<const std::string> file_name_;
   location location_;
+  LexerType lexer_type_ = LexerType::kFlex;
+  ParserType parser_type_ = ParserType::kBison;
+  ModuleCache* module_cache_ = nullptr;
+  std::unique_ptr<ModuleCache> own_module_cache_;
+
+  ParserResult ParseText(const std::string& text);
+
+  ParserResult ResolveImports();
 
   EPOXY_DISALLOW_COPY_AND_ASSIGN(Driver);
 };
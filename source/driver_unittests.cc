@@ -6,7 +6,12 @@
 #include "driver.h"
 #include "file.h"
 #include "fixture.h"
+#include "module.h"
+#include "sema.h"
 
+#include <chrono>
+#include <filesystem>
+#include <optional>
 #include <sstream>
 #include <string>
 
@@ -583,32 +588,46 @@ TEST(DriverTest, CanParseEnums) {
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[0].GetName(), "EmptyEnum");
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[1].GetName(), "JustOneMember");
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[1].GetMembers().size(), 1u);
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[1].GetMembers()[0],
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[1].GetMembers()[0].name,
             "OneMember");
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetName(),
             "SomeMoreMembers");
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers().size(), 8u);
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[0], "Tinker");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[1], "Tailor");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[2], "Soldier");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[3], "Sailor");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[4], "RichMan");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[5], "PoorMan");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[6],
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[0].name,
+            "Tinker");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[1].name,
+            "Tailor");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[2].name,
+            "Soldier");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[3].name,
+            "Sailor");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[4].name,
+            "RichMan");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[5].name,
+            "PoorMan");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[6].name,
             "BeggarMan");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[7], "Spy");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[2].GetMembers()[7].name,
+            "Spy");
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetName(),
             "SomeMoreMembers2");
   ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers().size(), 8u);
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[0], "Tinker");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[1], "Tailor");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[2], "Soldier");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[3], "Sailor");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[4], "RichMan");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[5], "PoorMan");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[6],
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[0].name,
+            "Tinker");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[1].name,
+            "Tailor");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[2].name,
+            "Soldier");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[3].name,
+            "Sailor");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[4].name,
+            "RichMan");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[5].name,
+            "PoorMan");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[6].name,
             "BeggarMan");
-  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[7], "Spy");
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums()[3].GetMembers()[7].name,
+            "Spy");
 }
 
 TEST(DriverTest, EnumsCanBeStructMembers) {
@@ -742,6 +761,56 @@ TEST(DriverTest, StructPointersCanBeFunctionArguments) {
   ASSERT_EQ(driver.GetNamespaces()[0].GetFunctions().size(), 1u);
 }
 
+TEST(DriverTest, SlicesCanBeFunctionArguments) {
+  Driver driver;
+  auto result = driver.Parse(R"~(
+    namespace foo {
+      function Sum(float[] samples, uint8_t* out, int64_t[] offsets) -> double
+    }
+  )~");
+  driver.PrettyPrintErrors(std::cerr);
+  ASSERT_EQ(result, Driver::ParserResult::kSuccess);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetFunctions().size(), 1u);
+  const auto& args = driver.GetNamespaces()[0].GetFunctions()[0].GetArguments();
+  ASSERT_EQ(args.size(), 3u);
+  ASSERT_TRUE(args[0].IsSlice());
+  ASSERT_FALSE(args[0].IsPointer());
+  ASSERT_EQ(args[0].GetPrimitive(), Primitive::kFloat);
+  ASSERT_EQ(args[0].GetIdentifier(), "samples");
+  ASSERT_EQ(args[0].GetLocation().begin.column, 20u);
+  ASSERT_EQ(args[0].GetLocation().end.column, 35u);
+  ASSERT_FALSE(args[1].IsSlice());
+  ASSERT_TRUE(args[2].IsSlice());
+  ASSERT_EQ(args[2].GetPrimitive(), Primitive::kInt64);
+}
+
+TEST(DriverTest, StringsCanBePassedAndReturned) {
+  Driver driver;
+  auto result = driver.Parse(R"~(
+    namespace foo {
+      function Greet(string name, int32_t count) -> string
+    }
+  )~");
+  driver.PrettyPrintErrors(std::cerr);
+  ASSERT_EQ(result, Driver::ParserResult::kSuccess);
+  const auto& function = driver.GetNamespaces()[0].GetFunctions()[0];
+  ASSERT_EQ(std::get<Primitive>(function.GetReturnType()), Primitive::kString);
+  ASSERT_FALSE(function.ReturnsPointer());
+  ASSERT_EQ(function.GetArguments().size(), 2u);
+  ASSERT_EQ(function.GetArguments()[0].GetPrimitive(), Primitive::kString);
+  ASSERT_EQ(function.GetArguments()[0].GetIdentifier(), "name");
+}
+
+TEST(DriverTest, SlicesCanOnlyBeFunctionArguments) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse("namespace foo { struct A { float[] a; } }"),
+            Driver::ParserResult::kSyntaxError);
+  ASSERT_EQ(driver.Parse("namespace foo { function A(B[] b) }"),
+            Driver::ParserResult::kSyntaxError);
+  ASSERT_EQ(driver.Parse("namespace foo { function A() -> float[] }"),
+            Driver::ParserResult::kSyntaxError);
+}
+
 TEST(DriverTest, CanReturnUserDefinedType) {
   Driver driver;
   auto result = driver.Parse(R"~(
@@ -908,5 +977,172 @@ TEST(DriverTest, ErrorLocationsAreCorrectFilePretty) {
   ASSERT_NE(stream.str().find("-----------------------^"), std::string::npos);
 }
 
+TEST(DriverTest, RecoversToReportAllSyntaxErrors) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    auto result = driver.Parse(R"~(namespace foo {
+  struct Foo {
+    int32_t a
+  }
+  function Bar(int32_t a int32_t b) -> void
+  function Baz() -> void
+  enum Bang {
+    A;
+  }
+  struct Valid {
+    int32_t a;
+  }
+})~");
+    driver.PrettyPrintErrors(std::cerr);
+    ASSERT_EQ(result, Driver::ParserResult::kSyntaxError);
+    const auto& errors = driver.GetErrors();
+    ASSERT_EQ(errors.size(), 3u);
+    ASSERT_EQ(errors[0].location.begin.line, 4u);
+    ASSERT_EQ(errors[1].location.begin.line, 5u);
+    ASSERT_EQ(errors[2].location.begin.line, 8u);
+    ASSERT_EQ(driver.GetNamespaces().size(), 1u);
+    const auto& ns = driver.GetNamespaces()[0];
+    ASSERT_EQ(ns.GetFunctions().size(), 1u);
+    ASSERT_EQ(ns.GetFunctions()[0].GetName(), "Baz");
+    ASSERT_EQ(ns.GetStructs().size(), 1u);
+    ASSERT_EQ(ns.GetStructs()[0].GetName(), "Valid");
+    ASSERT_TRUE(ns.GetEnums().empty());
+  }
+}
+
+static Driver::ParserResult ParseImportFixture(Driver& driver) {
+  auto source = ReadFileAsString(driver.GetFileName());
+  EXPECT_TRUE(source.has_value());
+  return driver.Parse(source.value_or(""));
+}
+
+TEST(DriverTest, CanImportFiles) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver(EPOXY_FIXTURES_LOCATION "imports/main.epoxy");
+    driver.SetParserType(type);
+    ASSERT_EQ(ParseImportFixture(driver), Driver::ParserResult::kSuccess);
+
+    // The common module is imported directly and by the shapes module but
+    // only added once.
+    const auto& modules = driver.GetImportedModules();
+    ASSERT_EQ(modules.size(), 2u);
+    ASSERT_NE(modules[0]->GetPath().find("common.epoxy"), std::string::npos);
+    ASSERT_NE(modules[1]->GetPath().find("shapes.epoxy"), std::string::npos);
+    // The namespaces of the modules are not copied into the driver.
+    const auto imported_namespaces = driver.GetImportedNamespaces();
+    ASSERT_EQ(imported_namespaces.size(), 2u);
+    ASSERT_EQ(imported_namespaces[0], &modules[0]->GetNamespaces()[0]);
+    ASSERT_EQ(imported_namespaces[1], &modules[1]->GetNamespaces()[0]);
+    ASSERT_EQ(driver.GetNamespaces().size(), 1u);
+
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces(), imported_namespaces),
+              Sema::Result::kSuccess);
+    ASSERT_EQ(sema.GetNamespaces().size(), 1u);
+    const auto& ns = sema.GetNamespaces()[0];
+    ASSERT_EQ(ns.GetStructs().size(), 2u);
+    ASSERT_EQ(ns.GetFunctions().size(), 2u);
+    // Constants of imported files may be used in other files.
+    ASSERT_EQ(ns.GetConstants()[0].GetValue(), 2u);
+    ASSERT_EQ(ns.GetStructs()[1].GetVariables()[2].GetArrayLength(), 2u);
+  }
+}
+
+TEST(DriverTest, ImportedFilesAreLoadedOncePerCache) {
+  ModuleCache cache;
+  for (size_t i = 0; i < 3u; i++) {
+    Driver driver(EPOXY_FIXTURES_LOCATION "imports/main.epoxy");
+    driver.SetModuleCache(&cache);
+    ASSERT_EQ(ParseImportFixture(driver), Driver::ParserResult::kSuccess);
+    Driver shapes_driver(EPOXY_FIXTURES_LOCATION "imports/shapes.epoxy");
+    shapes_driver.SetModuleCache(&cache);
+    ASSERT_EQ(ParseImportFixture(shapes_driver),
+              Driver::ParserResult::kSuccess);
+  }
+  ASSERT_EQ(cache.GetLoadCount(), 2u);
+
+  // Other caches load the files again.
+  ModuleCache other_cache;
+  Driver driver(EPOXY_FIXTURES_LOCATION "imports/main.epoxy");
+  driver.SetModuleCache(&other_cache);
+  ASSERT_EQ(ParseImportFixture(driver), Driver::ParserResult::kSuccess);
+  ASSERT_EQ(other_cache.GetLoadCount(), 2u);
+  ASSERT_EQ(cache.GetLoadCount(), 2u);
+}
+
+// Sets the modification time explicitly because the file system may not tell
+// apart writes made in quick succession.
+static void WriteModifiedFile(const std::filesystem::path& path,
+                              const std::string& text,
+                              std::filesystem::file_time_type time) {
+  ASSERT_TRUE(OverwriteFileWithBinaryData(path.string(), text));
+  std::filesystem::last_write_time(path, time);
+}
+
+TEST(DriverTest, ModifiedAndInvalidImportsAreLoadedAgain) {
+  const auto directory =
+      std::filesystem::temp_directory_path() / "epoxy_driver_unittests";
+  std::filesystem::create_directories(directory);
+  const auto common = directory / "common.epoxy";
+  const auto main = (directory / "main.epoxy").string();
+  auto time = std::filesystem::file_time_type::clock::now();
+  ModuleCache cache;
+  // The number of imported namespaces if the import succeeds.
+  auto parse = [&](const char* text) -> std::optional<size_t> {
+    Driver driver(main);
+    driver.SetModuleCache(&cache);
+    if (driver.Parse(text) != Driver::ParserResult::kSuccess) {
+      return std::nullopt;
+    }
+    return driver.GetImportedNamespaces().size();
+  };
+  const auto* const kImport = "import \"common.epoxy\";";
+
+  WriteModifiedFile(common, "namespace foo { struct }", time);
+  ASSERT_FALSE(parse(kImport).has_value());
+  ASSERT_FALSE(parse(kImport).has_value());
+  // Invalid modules are not cached.
+  ASSERT_EQ(cache.GetLoadCount(), 2u);
+
+  time += std::chrono::seconds(1);
+  WriteModifiedFile(common, "namespace foo { struct A { int8_t a; } }", time);
+  ASSERT_EQ(parse(kImport), 1u);
+  ASSERT_EQ(parse(kImport), 1u);
+  ASSERT_EQ(cache.GetLoadCount(), 3u);
+
+  time += std::chrono::seconds(1);
+  WriteModifiedFile(common, "namespace foo {} namespace bar {}", time);
+  ASSERT_EQ(parse(kImport), 2u);
+  ASSERT_EQ(cache.GetLoadCount(), 4u);
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(DriverTest, ReportsImportErrors) {
+  const std::pair<const char*, const char*> cases[] = {
+      {"import \"missing.epoxy\";", "Could not find"},
+      {"import \"cycle.epoxy\";", "cyclic"},
+      {"import \"invalid.epoxy\";", "In imported file: "},
+  };
+  for (const auto& [text, message] : cases) {
+    Driver driver(EPOXY_FIXTURES_LOCATION "imports/errors.epoxy");
+    ASSERT_EQ(driver.Parse(text), Driver::ParserResult::kImportError) << text;
+    ASSERT_EQ(driver.GetErrors().size(), 1u) << text;
+    const auto& error = driver.GetErrors()[0];
+    ASSERT_NE(error.message.find(message), std::string::npos) << text;
+    ASSERT_EQ(error.location.begin.line, 1u);
+    ASSERT_EQ(error.location.begin.column, 8u);
+    ASSERT_TRUE(driver.GetNamespaces().empty());
+  }
+
+  Driver driver;
+  ASSERT_EQ(driver.Parse("import common;"),
+            Driver::ParserResult::kSyntaxError);
+  ASSERT_EQ(driver.GetErrors().size(), 1u);
+  ASSERT_EQ(driver.GetErrors()[0].message,
+            "syntax error, unexpected <identifier>, expecting <string>");
+}
+
 }  // namespace testing
 }  // namespace epoxy
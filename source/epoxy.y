@@ -44,6 +44,9 @@
   STRUCT                  "struct"
   FUNCTION                "function"
   ENUM                    "enum"
+  IMPORT                  "import"
+  CONST                   "const"
+  ASYNC                   "async"
 
   INVALID_TOKEN           "<invalid token>"
 
@@ -53,6 +56,10 @@
   PAREN_LEFT              "("
   PAREN_RIGHT             ")"
   COMMA                   ","
+  BRACKET_LEFT            "["
+  BRACKET_RIGHT           "]"
+  COLON                   ":"
+  EQUAL                   "="
 
   VOID_T                  "void"
 
@@ -68,103 +75,218 @@
 
   DOUBLE                  "double"
   FLOAT                   "float"
+  STRING_T                "string"
 
   ARROW                   "->"
   STAR                    "*"
+  PLUS                    "+"
+  MINUS                   "-"
+  SLASH                   "/"
+  PERCENT                 "%"
+  SHIFT_LEFT              "<<"
+  SHIFT_RIGHT             ">>"
+  AMPERSAND               "&"
+  PIPE                    "|"
   ;
 
 %token <std::string>
   IDENTIFIER      "<identifier>"
+  STRING          "<string>"
+
+%token <uint64_t>
+  NUMBER          "<number>"
 
 %type <epoxy::Namespace> Namespace
 %type <epoxy::NamespaceItems> NamespaceItems
 %type <epoxy::NamespaceItem> NamespaceItem
 %type <epoxy::Function> Function
 %type <epoxy::Variable> Variable
+%type <epoxy::Variable> Field
+%type <epoxy::Variable> Argument
 %type <std::vector<epoxy::Variable>> ArgumentList
 %type <std::vector<epoxy::Variable>> VariableList
 %type <epoxy::Primitive> Primitive
 %type <epoxy::Struct> Struct
 %type <epoxy::Enum> Enum
-%type <std::vector<std::string>> IdentifierList
+%type <epoxy::Constant> Constant
+%type <epoxy::Expression> Expression
+%type <std::vector<epoxy::EnumMember>> MemberList
+%type <epoxy::EnumMember> Member
+%type <std::vector<std::string>> Attributes
+%type <std::vector<std::string>> AttributeList
 %type <std::variant<Primitive, std::string>> PrimitiveOrIdentifier
 
+// Operators in constant expressions bind like they do in C.
+%left PIPE
+%left AMPERSAND
+%left SHIFT_LEFT SHIFT_RIGHT
+%left PLUS MINUS
+%left STAR SLASH PERCENT
+
 %start SourceFile
 
 %%
 
+// Semantic values are not used again after a rule is reduced. So they are
+// moved instead of copied. Copying lists as they are built is quadratic.
+
 SourceFile
-  : NamespaceList
+  : TopLevelList
   | %empty
   ;
 
-NamespaceList
-  : Namespace                 { driver.AddNamespace($1); }
-  | NamespaceList Namespace   { driver.AddNamespace($2); }
+TopLevelList
+  : TopLevelItem
+  | TopLevelList TopLevelItem
+  ;
+
+TopLevelItem
+  : Namespace   { driver.AddNamespace(std::move($1)); }
+  | Import
+  ;
+
+Import
+  : IMPORT STRING SEMI_COLON   { driver.AddImport(std::move($2), @2); }
   ;
 
 Namespace
-  : NAMESPACE IDENTIFIER CURLY_LEFT NamespaceItems CURLY_RIGHT { $$ = epoxy::Namespace{$2, $4}; }
-  | NAMESPACE IDENTIFIER CURLY_LEFT                CURLY_RIGHT { $$ = epoxy::Namespace{$2, {}}; }
+  : NAMESPACE IDENTIFIER CURLY_LEFT NamespaceItems CURLY_RIGHT { $$ = epoxy::Namespace{std::move($2), std::move($4)}; }
+  | NAMESPACE IDENTIFIER CURLY_LEFT                CURLY_RIGHT { $$ = epoxy::Namespace{std::move($2), {}}; }
   ;
 
 NamespaceItems
-  : NamespaceItem                  { $$ = {$1}; }
-  | NamespaceItems NamespaceItem   { $$ = $1; $$.push_back($2); }
+  : NamespaceItem                  { $$.emplace_back(std::move($1)); }
+  | NamespaceItems NamespaceItem   { $$ = std::move($1); $$.emplace_back(std::move($2)); }
+  | RecoveredItem                  { $$ = {}; }
+  | NamespaceItems RecoveredItem   { $$ = std::move($1); }
+  ;
+
+// Error recovery. Malformed items are skipped till the end of their body or
+// argument list or, when that cannot be found, till the next item. The
+// recursive-descent parser in descent_parser.cc mirrors these rules.
+RecoveredItem
+  : error
+  | STRUCT IDENTIFIER CURLY_LEFT error CURLY_RIGHT
+  | ENUM IDENTIFIER CURLY_LEFT error CURLY_RIGHT
+  | ENUM IDENTIFIER COLON Primitive CURLY_LEFT error CURLY_RIGHT
+  | FUNCTION IDENTIFIER PAREN_LEFT error PAREN_RIGHT
+  | ASYNC FUNCTION IDENTIFIER PAREN_LEFT error PAREN_RIGHT
+  | Attributes STRUCT IDENTIFIER CURLY_LEFT error CURLY_RIGHT
+  | Attributes ENUM IDENTIFIER CURLY_LEFT error CURLY_RIGHT
+  | Attributes ENUM IDENTIFIER COLON Primitive CURLY_LEFT error CURLY_RIGHT
+  | Attributes FUNCTION IDENTIFIER PAREN_LEFT error PAREN_RIGHT
+  | Attributes ASYNC FUNCTION IDENTIFIER PAREN_LEFT error PAREN_RIGHT
   ;
 
 NamespaceItem
-  : Function  { $$ = $1; }
-  | Struct    { $$ = $1; }
-  | Enum      { $$ = $1; }
+  : Function             { $$ = std::move($1); }
+  | Struct               { $$ = std::move($1); }
+  | Enum                 { $$ = std::move($1); }
+  | Constant             { $$ = std::move($1); }
+  | ASYNC Function       { $2.SetAsync(true); $$ = std::move($2); }
+  | Attributes Function  { $2.SetAttributes(std::move($1)); $$ = std::move($2); }
+  | Attributes ASYNC Function { $3.SetAttributes(std::move($1)); $3.SetAsync(true); $$ = std::move($3); }
+  | Attributes Struct    { $2.SetAttributes(std::move($1)); $$ = std::move($2); }
+  | Attributes Enum      { $2.SetAttributes(std::move($1)); $$ = std::move($2); }
+  ;
+
+// Attributes are written like C++ attributes. Sema checks that each is known
+// for the kind of item it is applied to.
+Attributes
+  : BRACKET_LEFT BRACKET_LEFT AttributeList BRACKET_RIGHT BRACKET_RIGHT { $$ = std::move($3); }
+  ;
+
+AttributeList
+  : IDENTIFIER                        { $$.emplace_back(std::move($1)); }
+  | AttributeList COMMA IDENTIFIER    { $$ = std::move($1); $$.emplace_back(std::move($3)); }
   ;
 
 Enum
-  : ENUM IDENTIFIER CURLY_LEFT                CURLY_RIGHT { $$ = epoxy::Enum{$2, {}}; }
-  | ENUM IDENTIFIER CURLY_LEFT IdentifierList CURLY_RIGHT { $$ = epoxy::Enum{$2, $4}; }
+  : ENUM IDENTIFIER CURLY_LEFT            CURLY_RIGHT { $$ = epoxy::Enum{std::move($2), {}}; $$.SetLocation(@2); }
+  | ENUM IDENTIFIER CURLY_LEFT MemberList CURLY_RIGHT { $$ = epoxy::Enum{std::move($2), std::move($4)}; $$.SetLocation(@2); }
+  | ENUM IDENTIFIER COLON Primitive CURLY_LEFT            CURLY_RIGHT { $$ = epoxy::Enum{std::move($2), {}}; $$.SetUnderlyingType($4); $$.SetLocation(@2); }
+  | ENUM IDENTIFIER COLON Primitive CURLY_LEFT MemberList CURLY_RIGHT { $$ = epoxy::Enum{std::move($2), std::move($6)}; $$.SetUnderlyingType($4); $$.SetLocation(@2); }
+  ;
+
+MemberList
+  : Member COMMA               { $$.emplace_back(std::move($1)); }
+  | Member                     { $$.emplace_back(std::move($1)); }
+  | MemberList Member COMMA    { $$ = std::move($1); $$.emplace_back(std::move($2)); }
+  | MemberList Member          { $$ = std::move($1); $$.emplace_back(std::move($2)); }
   ;
 
-IdentifierList
-  : IDENTIFIER COMMA                       { $$ = {$1}; }
-  | IDENTIFIER                             { $$ = {$1}; }
-  | IdentifierList IDENTIFIER COMMA        { $$ = $1; $$.push_back($2); }
-  | IdentifierList IDENTIFIER              { $$ = $1; $$.push_back($2); }
+Member
+  : IDENTIFIER                     { $$ = epoxy::EnumMember{std::move($1), std::nullopt, @1}; }
+  | IDENTIFIER EQUAL Expression    { $$ = epoxy::EnumMember{std::move($1), std::move($3), @1}; }
+  ;
+
+Constant
+  : CONST Primitive IDENTIFIER EQUAL Expression SEMI_COLON   { $$ = epoxy::Constant{$2, std::move($3), std::move($5)}; $$.SetLocation(@3); }
+  ;
+
+// Expressions are evaluated by Sema. Parentheses only group and are not part
+// of the location of the expression they enclose.
+Expression
+  : NUMBER                                 { $$ = epoxy::Expression{$1}; }
+  | IDENTIFIER                             { $$ = epoxy::Expression{std::move($1), @$}; }
+  | PAREN_LEFT Expression PAREN_RIGHT      { $$ = std::move($2); }
+  | Expression PIPE Expression             { $$ = epoxy::Expression{epoxy::Expression::Operator::kBitwiseOr, std::move($1), std::move($3), @$}; }
+  | Expression AMPERSAND Expression        { $$ = epoxy::Expression{epoxy::Expression::Operator::kBitwiseAnd, std::move($1), std::move($3), @$}; }
+  | Expression SHIFT_LEFT Expression       { $$ = epoxy::Expression{epoxy::Expression::Operator::kShiftLeft, std::move($1), std::move($3), @$}; }
+  | Expression SHIFT_RIGHT Expression      { $$ = epoxy::Expression{epoxy::Expression::Operator::kShiftRight, std::move($1), std::move($3), @$}; }
+  | Expression PLUS Expression             { $$ = epoxy::Expression{epoxy::Expression::Operator::kAdd, std::move($1), std::move($3), @$}; }
+  | Expression MINUS Expression            { $$ = epoxy::Expression{epoxy::Expression::Operator::kSubtract, std::move($1), std::move($3), @$}; }
+  | Expression STAR Expression             { $$ = epoxy::Expression{epoxy::Expression::Operator::kMultiply, std::move($1), std::move($3), @$}; }
+  | Expression SLASH Expression            { $$ = epoxy::Expression{epoxy::Expression::Operator::kDivide, std::move($1), std::move($3), @$}; }
+  | Expression PERCENT Expression          { $$ = epoxy::Expression{epoxy::Expression::Operator::kRemainder, std::move($1), std::move($3), @$}; }
   ;
 
 Function
-  : FUNCTION IDENTIFIER PAREN_LEFT ArgumentList PAREN_RIGHT ARROW PrimitiveOrIdentifier      { $$ = epoxy::Function{$2, $4, $7, false}; }
-  | FUNCTION IDENTIFIER PAREN_LEFT ArgumentList PAREN_RIGHT ARROW PrimitiveOrIdentifier STAR { $$ = epoxy::Function{$2, $4, $7, true}; }
-  | FUNCTION IDENTIFIER PAREN_LEFT ArgumentList PAREN_RIGHT                                  { $$ = epoxy::Function{$2, $4, epoxy::Primitive::kVoid, false}; }
-  | FUNCTION IDENTIFIER PAREN_LEFT              PAREN_RIGHT ARROW PrimitiveOrIdentifier      { $$ = epoxy::Function{$2, {}, $6, false}; }
-  | FUNCTION IDENTIFIER PAREN_LEFT              PAREN_RIGHT ARROW PrimitiveOrIdentifier STAR { $$ = epoxy::Function{$2, {}, $6, true}; }
-  | FUNCTION IDENTIFIER PAREN_LEFT              PAREN_RIGHT                                  { $$ = epoxy::Function{$2, {}, epoxy::Primitive::kVoid, false}; }
+  : FUNCTION IDENTIFIER PAREN_LEFT ArgumentList PAREN_RIGHT ARROW PrimitiveOrIdentifier      { $$ = epoxy::Function{std::move($2), std::move($4), std::move($7), false}; $$.SetLocation(@2); }
+  | FUNCTION IDENTIFIER PAREN_LEFT ArgumentList PAREN_RIGHT ARROW PrimitiveOrIdentifier STAR { $$ = epoxy::Function{std::move($2), std::move($4), std::move($7), true}; $$.SetLocation(@2); }
+  | FUNCTION IDENTIFIER PAREN_LEFT ArgumentList PAREN_RIGHT                                  { $$ = epoxy::Function{std::move($2), std::move($4), epoxy::Primitive::kVoid, false}; $$.SetLocation(@2); }
+  | FUNCTION IDENTIFIER PAREN_LEFT              PAREN_RIGHT ARROW PrimitiveOrIdentifier      { $$ = epoxy::Function{std::move($2), {}, std::move($6), false}; $$.SetLocation(@2); }
+  | FUNCTION IDENTIFIER PAREN_LEFT              PAREN_RIGHT ARROW PrimitiveOrIdentifier STAR { $$ = epoxy::Function{std::move($2), {}, std::move($6), true}; $$.SetLocation(@2); }
+  | FUNCTION IDENTIFIER PAREN_LEFT              PAREN_RIGHT                                  { $$ = epoxy::Function{std::move($2), {}, epoxy::Primitive::kVoid, false}; $$.SetLocation(@2); }
   ;
 
 PrimitiveOrIdentifier
   : Primitive       { $$ = $1; }
-  | IDENTIFIER      { $$ = $1; }
+  | IDENTIFIER      { $$ = std::move($1); }
   ;
 
 ArgumentList
-  : Variable                        { $$ = {$1}; }
-  | ArgumentList COMMA Variable     { $$ = $1; $$.push_back($3); }
+  : Argument                        { $$.emplace_back(std::move($1)); }
+  | ArgumentList COMMA Argument     { $$ = std::move($1); $$.emplace_back(std::move($3)); }
+  ;
+
+Argument
+  : Variable                                              { $$ = std::move($1); }
+  | Primitive BRACKET_LEFT BRACKET_RIGHT IDENTIFIER       { $$ = epoxy::Variable{$1, std::move($4), false}; $$.SetSlice(true); $$.SetLocation(@$); }
   ;
 
 Struct
-  : STRUCT IDENTIFIER CURLY_LEFT VariableList  CURLY_RIGHT { $$ = epoxy::Struct{$2, $4}; }
-  | STRUCT IDENTIFIER CURLY_LEFT               CURLY_RIGHT { $$ = epoxy::Struct{$2, {}}; }
+  : STRUCT IDENTIFIER CURLY_LEFT VariableList  CURLY_RIGHT { $$ = epoxy::Struct{std::move($2), std::move($4)}; $$.SetLocation(@2); }
+  | STRUCT IDENTIFIER CURLY_LEFT               CURLY_RIGHT { $$ = epoxy::Struct{std::move($2), {}}; $$.SetLocation(@2); }
   ;
 
 Variable
-  : Primitive        IDENTIFIER  { $$ = epoxy::Variable{$1, $2, false}; }
-  | Primitive  STAR  IDENTIFIER  { $$ = epoxy::Variable{$1, $3, true};  }
-  | IDENTIFIER       IDENTIFIER  { $$ = epoxy::Variable{$1, $2, false}; }
-  | IDENTIFIER STAR  IDENTIFIER  { $$ = epoxy::Variable{$1, $3, true};  }
+  : Primitive        IDENTIFIER  { $$ = epoxy::Variable{$1, std::move($2), false}; $$.SetLocation(@$); }
+  | Primitive  STAR  IDENTIFIER  { $$ = epoxy::Variable{$1, std::move($3), true};  $$.SetLocation(@$); }
+  | IDENTIFIER       IDENTIFIER  { $$ = epoxy::Variable{std::move($1), std::move($2), false}; $$.SetLocation(@$); }
+  | IDENTIFIER STAR  IDENTIFIER  { $$ = epoxy::Variable{std::move($1), std::move($3), true};  $$.SetLocation(@$); }
+  ;
+
+Field
+  : Variable                                                    { $$ = std::move($1); }
+  | Variable BRACKET_LEFT Expression BRACKET_RIGHT              { $$ = std::move($1); $$.SetArrayLength(std::move($3)); }
+  | Attributes Variable                                         { $$ = std::move($2); $$.SetAttributes(std::move($1)); }
+  | Attributes Variable BRACKET_LEFT Expression BRACKET_RIGHT   { $$ = std::move($2); $$.SetAttributes(std::move($1)); $$.SetArrayLength(std::move($4)); }
   ;
 
 VariableList
-  : Variable SEMI_COLON              { $$ = {$1}; }
-  | VariableList Variable SEMI_COLON { $$ = $1; $$.push_back($2); }
+  : Field SEMI_COLON              { $$.emplace_back(std::move($1)); }
+  | VariableList Field SEMI_COLON { $$ = std::move($1); $$.emplace_back(std::move($2)); }
   ;
 
 Primitive
@@ -179,6 +301,7 @@ Primitive
   | UINT_64_T  { $$ = epoxy::Primitive::kUnsignedInt64; }
   | DOUBLE     { $$ = epoxy::Primitive::kDouble; }
   | FLOAT      { $$ = epoxy::Primitive::kFloat; }
+  | STRING_T   { $$ = epoxy::Primitive::kString; }
   ;
 
 %%
@@ -0,0 +1,176 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "allocation_tracker.h"
+#include "command_line.h"
+#include "driver.h"
+#include "fast_lexer.h"
+#include "file.h"
+#include "fixture.h"
+#include "scanner.h"
+#include "synthetic_idl.h"
+
+namespace epoxy {
+namespace benchmarks {
+
+struct Input {
+  std::string name;
+  std::string text;
+};
+
+class BenchmarkRunner {
+ public:
+  BenchmarkRunner(std::optional<std::string> filter, double min_seconds)
+      : filter_(std::move(filter)), min_seconds_(min_seconds) {}
+
+  // Runs the closure till at least the minimum time has elapsed. The closure
+  // returns the number of items (tokens, nodes, etc.) it processed. The
+  // allocations made per iteration are reported along with the timings.
+  void Run(const std::string& name,
+           size_t bytes,
+           const std::function<size_t(void)>& closure) {
+    if (filter_.has_value() &&
+        name.find(filter_.value()) == std::string::npos) {
+      return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    size_t iterations = 0u;
+    size_t items = 0u;
+    AllocationScope allocations;
+    const auto start = Clock::now();
+    auto elapsed = std::chrono::duration<double>::zero();
+    do {
+      items += closure();
+      iterations++;
+      elapsed = Clock::now() - start;
+    } while (elapsed.count() < min_seconds_);
+
+    const auto seconds_per_iteration = elapsed.count() / iterations;
+    const auto megabytes_per_second =
+        (bytes * iterations) / elapsed.count() / (1024.0 * 1024.0);
+    const auto items_per_second = items / elapsed.count();
+    const auto allocations_per_iteration =
+        allocations.GetStats().allocations / iterations;
+
+    std::cout << std::left << std::setw(36) << name << std::right
+              << std::setw(10) << iterations << std::setw(14) << std::fixed
+              << std::setprecision(3) << seconds_per_iteration * 1e6 << " us"
+              << std::setw(12) << std::setprecision(1) << megabytes_per_second
+              << " MB/s" << std::setw(14) << std::setprecision(0)
+              << items_per_second << " items/s" << std::setw(10)
+              << allocations_per_iteration << " allocs" << std::endl;
+  }
+
+ private:
+  const std::optional<std::string> filter_;
+  const double min_seconds_;
+};
+
+static size_t LexAll(const std::string& text, Driver::LexerType type) {
+  const auto end_kind = Parser::make_END(location()).type_get();
+  Driver driver;
+  Scanner scanner(text, type, driver.GetCurrentLocation());
+  size_t tokens = 0u;
+  while (scanner.Lex(driver).type_get() != end_kind) {
+    tokens++;
+  }
+  return tokens;
+}
+
+static std::vector<Input> GetInputs() {
+  std::vector<Input> inputs;
+
+  if (auto hello = ReadFileAsString(EPOXY_EXAMPLES_LOCATION "hello.epoxy");
+      hello.has_value()) {
+    inputs.push_back({"hello", hello.value()});
+  }
+
+  SyntheticIDLOptions options;
+  options.namespaces = 10u;
+  options.enums_per_namespace = 20u;
+  options.structs_per_namespace = 100u;
+  options.functions_per_namespace = 200u;
+  options.fields_per_struct = 8u;
+  options.arguments_per_function = 4u;
+  inputs.push_back({"synthetic", GenerateSyntheticIDL(options)});
+
+  return inputs;
+}
+
+static void RunLexerBenchmarks(BenchmarkRunner& runner,
+                               const std::vector<Input>& inputs) {
+  for (const auto& input : inputs) {
+    runner.Run("Lex/Flex/" + input.name, input.text.size(), [&]() {
+      return LexAll(input.text, Driver::LexerType::kFlex);
+    });
+    runner.Run("Lex/Fast/" + input.name, input.text.size(), [&]() {
+      return LexAll(input.text, Driver::LexerType::kFast);
+    });
+  }
+}
+
+static void RunParserBenchmarks(BenchmarkRunner& runner,
+                                const std::vector<Input>& inputs) {
+  const std::vector<std::pair<std::string, Driver::ParserType>> parsers = {
+      {"Bison", Driver::ParserType::kBison},
+      {"Descent", Driver::ParserType::kDescent},
+  };
+  const std::vector<std::pair<std::string, Driver::LexerType>> lexers = {
+      {"Flex", Driver::LexerType::kFlex},
+      {"Fast", Driver::LexerType::kFast},
+  };
+  for (const auto& input : inputs) {
+    for (const auto& parser : parsers) {
+      for (const auto& lexer : lexers) {
+        runner.Run(
+            "Parse/" + parser.first + "/" + lexer.first + "/" + input.name,
+            input.text.size(), [&]() {
+              Driver driver;
+              driver.SetParserType(parser.second);
+              driver.SetLexerType(lexer.second);
+              driver.Parse(input.text);
+              return driver.GetNamespaces().size();
+            });
+      }
+    }
+  }
+}
+
+static bool Main(const CommandLine& args) {
+  const auto filter = args.GetString("filter");
+  double min_seconds = 0.5;
+  if (auto min_time = args.GetString("min-time"); min_time.has_value()) {
+    min_seconds = std::stod(min_time.value());
+  }
+
+  std::cout << "Fast lexer SIMD backend: " << FastLexer::GetSIMDBackendName()
+            << std::endl;
+
+  const auto inputs = GetInputs();
+  for (const auto& input : inputs) {
+    std::cout << "Input '" << input.name << "': " << input.text.size()
+              << " bytes, " << LexAll(input.text, Driver::LexerType::kFast)
+              << " tokens." << std::endl;
+  }
+
+  BenchmarkRunner runner(filter, min_seconds);
+  RunLexerBenchmarks(runner, inputs);
+  RunParserBenchmarks(runner, inputs);
+  return true;
+}
+
+}  // namespace benchmarks
+}  // namespace epoxy
+
+int main(int argc, const char* argv[]) {
+  return epoxy::benchmarks::Main({argc, argv}) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
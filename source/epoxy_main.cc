@@ -2,12 +2,20 @@
 // See LICENSE.md file for details.
 
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "code_gen.h"
 #include "command_line.h"
+#include "compiled_template.h"
 #include "driver.h"
 #include "file.h"
+#include "perf_lint.h"
 #include "sema.h"
+#include "template_profiler.h"
 #include "version.h"
 
 namespace epoxy {
@@ -23,9 +31,19 @@ Usage:
            --idl    <Epoxy IDL file path>
            [--template-file <Template File Path>]
            [--template-data-dump]
+           [--lexer <flex|fast>]
+           [--parser <bison|descent>]
+           [--select <namespace::Symbol,namespace::*,...>]
+           [--abi <x86_64,aarch64,arm32,ia32>]
+           [--perf-lint]
+           [--perf-lint-sarif <SARIF file path>]
+           [--profile-template]
            [--help]
            [--version]
 
+    epoxy  --compile-template <Template File Path>
+           --output <compiled template file path>
+
 Options:
 --------
 
@@ -38,13 +56,62 @@ Options:
   --template-file     The path to a custom code generation template. To
                       introspect the data used to render the template, use the
                       --template-data-dump option. The Inja template rendering
-                      system is used to render the template data.
+                      system is used to render the template data. The template
+                      may also be one compiled using --compile-template.
 
   --template-data-dump
                       Instead of rendering the code generation template, dump
                       the template data. This is useful when writing or
                       customizing a custom code generation template.
 
+  --lexer             The lexer used to tokenize the IDL. Either "flex" (the
+                      default) for the lexer generated by flex or "fast" for
+                      the hand-written lexer that uses SIMD instructions where
+                      available. Both produce identical tokens.
+
+  --parser            The parser used to build the IDL declarations. Either
+                      "bison" (the default) for the parser generated by bison
+                      or "descent" for the hand-written recursive-descent
+                      parser. Both report identical syntax errors.
+
+  --select            Only generate code for the selected items and the structs
+                      and enums they reference. Selectors are separated by
+                      commas. Each is either "namespace::Symbol" to select the
+                      function, struct, enum or constant named Symbol or
+                      "namespace::*" to select the whole namespace.
+                      Namespaces without selected items are omitted.
+
+  --abi               Compute the size, alignment and field offsets of each
+                      struct for the target ABIs separated by commas. Either
+                      "x86_64", "aarch64", "arm32" or "ia32". The layouts are
+                      in the template data. The C++ interface template checks
+                      them using static_assert.
+
+  --perf-lint         Warn about declarations that make the generated bindings
+                      slower than they need to be. Structs with more than 8
+                      bytes of padding, structs with the hot attribute that
+                      straddle 64 byte cache lines, struct fields that store
+                      enums in wider types than needed, pointers to primitive
+                      arguments and functions that only read a field of a
+                      struct are reported. Warnings do not fail code
+                      generation.
+
+  --perf-lint-sarif   Run the performance lints and write the warnings to the
+                      given path as a SARIF log.
+
+  --profile-template  Record the time spent on each line of the template and in
+                      each callback while rendering. A table sorted by time is
+                      printed and stacks are written to the output file path
+                      with a ".folded" extension appended. The stacks are in
+                      the folded format understood by flamegraph tools.
+
+  --compile-template  Parse the template at the given path and write it to the
+                      output file path in a compact binary form. Compiled
+                      templates may be specified using --template-file and
+                      are loaded without being parsed again. Templates must be
+                      compiled again when Epoxy is updated. Templates that
+                      include other templates cannot be compiled.
+
   --help              Dump these help instructions.
 
   --version           Get the Epoxy version.
@@ -57,6 +124,8 @@ static void DumpHelpString(std::ostream& stream) {
 struct FileInfo {
   std::string file_name;
   std::string file_contents;
+  // Set instead of the contents if the file contained a compiled template.
+  std::shared_ptr<const inja::Template> compiled_template;
 };
 
 static std::optional<FileInfo> GetTemplateData(const CommandLine& args) {
@@ -69,13 +138,98 @@ static std::optional<FileInfo> GetTemplateData(const CommandLine& args) {
     return std::nullopt;
   }
 
-  auto template_file_data = ReadFileAsString(template_file_flag.value());
-  if (!template_file_data.has_value()) {
+  auto mapping = FileMapping::Create(template_file_flag.value());
+  if (!mapping) {
     std::cerr << "Could not read " << template_file_flag.value()
               << " to obtain code generation template data." << std::endl;
     return std::nullopt;
   }
-  return FileInfo{template_file_flag.value(), template_file_data.value()};
+
+  const auto data = mapping->GetData();
+  if (IsCompiledTemplate(data)) {
+    auto compiled = LoadCompiledTemplate(data);
+    if (!compiled.result) {
+      std::cerr << "Could not load the compiled template at "
+                << template_file_flag.value() << ": "
+                << compiled.error.value_or("") << std::endl;
+      return std::nullopt;
+    }
+    return FileInfo{template_file_flag.value(), "",
+                    std::move(compiled.result)};
+  }
+
+  return FileInfo{template_file_flag.value(),
+                  HomogenizeNewlines(std::string(data)), nullptr};
+}
+
+static std::vector<std::string> SplitAtCommas(const std::string& flag) {
+  std::vector<std::string> items;
+  size_t begin = 0u;
+  while (begin <= flag.size()) {
+    auto end = flag.find(',', begin);
+    if (end == std::string::npos) {
+      end = flag.size();
+    }
+    if (end > begin) {
+      items.emplace_back(flag.substr(begin, end - begin));
+    }
+    begin = end + 1u;
+  }
+  return items;
+}
+
+static std::optional<std::vector<ABI>> GetABIs(const std::string& flag) {
+  std::vector<ABI> abis;
+  for (const auto& name : SplitAtCommas(flag)) {
+    auto abi = GetABINamed(name);
+    if (!abi.has_value()) {
+      std::cerr << "Unknown ABI '" << name
+                << "'. Specify x86_64, aarch64, arm32 or ia32." << std::endl;
+      return std::nullopt;
+    }
+    abis.push_back(abi.value());
+  }
+  return abis;
+}
+
+static bool CompileTemplateFile(const std::string& template_file,
+                                const CommandLine& args) {
+  auto out_file_flag = args.GetString("output");
+  if (!out_file_flag.has_value()) {
+    std::cerr << "Output file path not specified. Specify the save via the "
+                 "--output flag."
+              << std::endl;
+    return false;
+  }
+
+  auto template_data = ReadFileAsString(template_file);
+  if (!template_data.has_value()) {
+    std::cerr << "Could not read " << template_file
+              << " to obtain code generation template data." << std::endl;
+    return false;
+  }
+
+  auto parsed = CodeGen::ParseTemplate(template_data.value());
+  if (!parsed.result) {
+    std::cerr << "Errors while parsing the template: " << std::endl
+              << parsed.error.value_or("") << std::endl;
+    return false;
+  }
+
+  auto compiled = CompileTemplate(*parsed.result);
+  if (!compiled.result.has_value()) {
+    std::cerr << "Could not compile the template: "
+              << compiled.error.value_or("") << std::endl;
+    return false;
+  }
+
+  if (!OverwriteFileWithBinaryData(out_file_flag.value(),
+                                   compiled.result.value())) {
+    std::cerr << "Error while writing the compiled template to file at path: "
+              << out_file_flag.value() << std::endl;
+    return false;
+  }
+  return true;
 }
 
 static std::optional<FileInfo> GetIDLData(const CommandLine& args) {
@@ -109,6 +263,10 @@ bool Main(const CommandLine& args) {
     return true;
   }
 
+  if (auto compile = args.GetString("compile-template"); compile.has_value()) {
+    return CompileTemplateFile(compile.value(), args);
+  }
+
   const auto template_data = GetTemplateData(args);
 
   if (!template_data.has_value()) {
@@ -123,6 +281,28 @@ bool Main(const CommandLine& args) {
   }
 
   Driver driver(idl_data.value().file_name);
+  if (auto lexer = args.GetString("lexer"); lexer.has_value()) {
+    if (lexer.value() == "flex") {
+      driver.SetLexerType(Driver::LexerType::kFlex);
+    } else if (lexer.value() == "fast") {
+      driver.SetLexerType(Driver::LexerType::kFast);
+    } else {
+      std::cerr << "Unknown lexer '" << lexer.value()
+                << "'. Specify either flex or fast." << std::endl;
+      return false;
+    }
+  }
+  if (auto parser = args.GetString("parser"); parser.has_value()) {
+    if (parser.value() == "bison") {
+      driver.SetParserType(Driver::ParserType::kBison);
+    } else if (parser.value() == "descent") {
+      driver.SetParserType(Driver::ParserType::kDescent);
+    } else {
+      std::cerr << "Unknown parser '" << parser.value()
+                << "'. Specify either bison or descent." << std::endl;
+      return false;
+    }
+  }
   const auto parse_result = driver.Parse(idl_data.value().file_contents);
   if (parse_result != Driver::ParserResult::kSuccess) {
     std::cerr << "Errors when attempting to parse IDL: " << std::endl;
@@ -131,10 +311,37 @@ bool Main(const CommandLine& args) {
   }
 
   Sema sema;
-  const auto sema_result = sema.Perform(driver.GetNamespaces());
+  if (auto select = args.GetString("select"); select.has_value()) {
+    sema.SetSelectors(SplitAtCommas(select.value()));
+  }
+  if (auto abi_flag = args.GetString("abi"); abi_flag.has_value()) {
+    auto abis = GetABIs(abi_flag.value());
+    if (!abis.has_value()) {
+      return false;
+    }
+    sema.SetABIs(std::move(abis.value()));
+  }
+  const auto sarif_file_flag = args.GetString("perf-lint-sarif");
+  if (args.GetOptionWithDefault("perf-lint", false) ||
+      sarif_file_flag.has_value()) {
+    sema.SetPerfLint({});
+  }
+  const auto sema_result = sema.Perform(driver.TakeNamespaces(),
+                                        driver.GetImportedNamespaces());
   if (sema_result != Sema::Result::kSuccess) {
-    std::cerr << "Errors in interface definition: ";
-    sema.PrettyPrintErrors(std::cerr);
+    std::cerr << "Errors in interface definition: " << std::endl;
+    sema.PrettyPrintErrors(std::cerr, idl_data.value().file_contents);
+    return false;
+  }
+
+  PrettyPrintLintWarnings(std::cerr, sema.GetLintWarnings(),
+                          idl_data.value().file_contents);
+  if (sarif_file_flag.has_value() &&
+      !OverwriteFileWithStringData(
+          sarif_file_flag.value(),
+          GetLintWarningsSARIF(sema.GetLintWarnings()))) {
+    std::cerr << "Error while writing the lint warnings to file at path: "
+              << sarif_file_flag.value() << std::endl;
     return false;
   }
 
@@ -147,7 +354,20 @@ bool Main(const CommandLine& args) {
     return true;
   }
 
-  auto code_gen_result = code_gen.Render(sema.GetNamespaces());
+  std::unique_ptr<TemplateProfiler> profiler;
+  if (args.GetOptionWithDefault("profile-template", false)) {
+    // Only the name of the file is used to keep the stack frames short.
+    const auto& path = template_data.value().file_name;
+    profiler = std::make_unique<TemplateProfiler>(
+        path.substr(path.find_last_of("/\\") + 1u));
+  }
+
+  const auto& compiled_template = template_data.value().compiled_template;
+  auto code_gen_result =
+      compiled_template
+          ? CodeGen::RenderTemplate(*compiled_template, sema.GetNamespaces(),
+                                    profiler.get())
+          : code_gen.Render(sema.GetNamespaces(), profiler.get());
   if (code_gen_result.error.has_value()) {
     std::cerr << "Errors during code generation: " << std::endl
               << code_gen_result.error.value() << std::endl;
@@ -174,6 +394,21 @@ bool Main(const CommandLine& args) {
     return false;
   }
 
+  if (profiler) {
+    profiler->PrintReport(std::cout,
+                          compiled_template
+                              ? GetTemplateSource(*compiled_template)
+                              : template_data.value().file_contents);
+    const auto folded_file = out_file_flag.value() + ".folded";
+    std::stringstream folded;
+    profiler->WriteFoldedStacks(folded);
+    if (!OverwriteFileWithStringData(folded_file, folded.str())) {
+      std::cerr << "Error while writing the template profile to file at path: "
+                << folded_file << std::endl;
+      return false;
+    }
+  }
+
   return true;
 }
 
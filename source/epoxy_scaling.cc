@@ -0,0 +1,341 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "allocation_tracker.h"
+#include "code_gen.h"
+#include "command_line.h"
+#include "driver.h"
+#include "file.h"
+#include "fixture.h"
+#include "scanner.h"
+#include "sema.h"
+#include "synthetic_idl.h"
+
+namespace epoxy {
+namespace scaling {
+
+// The largest exponents allowed in the fit of the time and memory used by a
+// phase against the number of items. Between 1k and 1M items, n log n fits an
+// exponent of about 1.1. Quadratic behavior fits 2. At 1M items, n^1.5 is
+// already about 50 times slower than n log n. So time is only allowed a little
+// headroom for noise.
+static constexpr double kMaxTimeExponent = 1.25;
+
+// Each measurement is the fastest of at least these many runs.
+static constexpr size_t kMinRuns = 3u;
+static constexpr double kMaxMemoryExponent = 1.25;
+
+// The number of times a shape is measured before it fails.
+static constexpr size_t kMaxAttempts = 3u;
+
+// Describes how to generate an IDL with approximately the given number of AST
+// nodes.
+struct Shape {
+  std::string name;
+  std::function<SyntheticIDLOptions(size_t items)> options;
+};
+
+static std::vector<Shape> GetShapes() {
+  std::vector<Shape> shapes;
+  // All items in a single namespace.
+  shapes.push_back({"WideNamespace", [](size_t items) {
+                      SyntheticIDLOptions options;
+                      options.enums_per_namespace = items / 20u;
+                      options.structs_per_namespace = items / 20u;
+                      options.functions_per_namespace = items / 10u;
+                      options.arguments_per_function = 4u;
+                      return options;
+                    }});
+  // Lots of small namespaces.
+  shapes.push_back({"ManyNamespaces", [](size_t items) {
+                      SyntheticIDLOptions options;
+                      options.namespaces = items / 21u;
+                      options.enums_per_namespace = 1u;
+                      options.structs_per_namespace = 1u;
+                      options.functions_per_namespace = 2u;
+                      options.arguments_per_function = 4u;
+                      return options;
+                    }});
+  // A few functions and structs with very long argument and field lists.
+  shapes.push_back({"LongArgumentLists", [](size_t items) {
+                      SyntheticIDLOptions options;
+                      options.enums_per_namespace = 1u;
+                      options.structs_per_namespace = 5u;
+                      options.functions_per_namespace = 5u;
+                      options.fields_per_struct = items / 10u;
+                      options.arguments_per_function = items / 10u;
+                      return options;
+                    }});
+  return shapes;
+}
+
+struct Measurement {
+  size_t items = 0u;
+  double seconds = 0.0;
+  size_t bytes = 0u;
+};
+
+struct PhaseMeasurements {
+  std::string name;
+  std::vector<Measurement> measurements;
+};
+
+// Runs the closure till at least the minimum time has elapsed and records the
+// fastest run. The bytes allocated are recorded for the first run.
+static Measurement Measure(size_t items,
+                           double min_seconds,
+                           const std::function<void(void)>& closure) {
+  Measurement measurement;
+  measurement.items = items;
+  measurement.seconds = std::numeric_limits<double>::max();
+  double total = 0.0;
+  size_t runs = 0u;
+  do {
+    AllocationScope allocations;
+    // The processor time of the process is used instead of the wall time. So
+    // runs that are preempted by other processes are not slower.
+    const auto start = std::clock();
+    closure();
+    const auto elapsed =
+        static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+    if (runs++ == 0u) {
+      measurement.bytes = allocations.GetStats().bytes;
+    }
+    measurement.seconds = std::min(measurement.seconds, elapsed);
+    total += elapsed;
+  } while (runs < kMinRuns || total < min_seconds);
+  return measurement;
+}
+
+static size_t CountNodes(const std::vector<Namespace>& namespaces) {
+  size_t nodes = 0u;
+  for (const auto& ns : namespaces) {
+    nodes++;
+    for (const auto& function : ns.GetFunctions()) {
+      nodes += 1u + function.GetArguments().size();
+    }
+    for (const auto& strut : ns.GetStructs()) {
+      nodes += 1u + strut.GetVariables().size();
+    }
+    for (const auto& enumm : ns.GetEnums()) {
+      nodes += 1u + enumm.GetMembers().size();
+    }
+  }
+  return nodes;
+}
+
+static void LexAll(const std::string& text, Driver::LexerType type) {
+  const auto end_kind = Parser::make_END(location()).type_get();
+  Driver driver;
+  Scanner scanner(text, type, driver.GetCurrentLocation());
+  while (scanner.Lex(driver).type_get() != end_kind) {
+  }
+}
+
+static bool Parse(const std::string& text,
+                  Driver::LexerType lexer_type,
+                  Driver::ParserType parser_type) {
+  Driver driver;
+  driver.SetLexerType(lexer_type);
+  driver.SetParserType(parser_type);
+  return driver.Parse(text) == Driver::ParserResult::kSuccess;
+}
+
+// Measures all phases of code generation for IDLs of the given shape at each
+// size. Returns false if any phase failed.
+static bool MeasureShape(const Shape& shape,
+                         const std::vector<size_t>& sizes,
+                         const inja::Template& parsed_template,
+                         double min_seconds,
+                         std::vector<PhaseMeasurements>& phases) {
+  phases = {{"Lex/Flex"},   {"Lex/Fast"}, {"Parse/Bison"}, {"Parse/Descent"},
+            {"Sema"},       {"JSON"},     {"Render"}};
+  for (const auto size : sizes) {
+    const auto text = GenerateSyntheticIDL(shape.options(size));
+
+    Driver driver;
+    if (driver.Parse(text) != Driver::ParserResult::kSuccess) {
+      driver.PrettyPrintErrors(std::cerr, text);
+      return false;
+    }
+    Sema sema;
+    if (sema.Perform(driver.GetNamespaces()) != Sema::Result::kSuccess) {
+      sema.PrettyPrintErrors(std::cerr, text);
+      return false;
+    }
+    const auto& namespaces = sema.GetNamespaces();
+    const auto items = CountNodes(namespaces);
+
+    bool success = true;
+    phases[0].measurements.push_back(Measure(items, min_seconds, [&]() {
+      LexAll(text, Driver::LexerType::kFlex);
+    }));
+    phases[1].measurements.push_back(Measure(items, min_seconds, [&]() {
+      LexAll(text, Driver::LexerType::kFast);
+    }));
+    phases[2].measurements.push_back(Measure(items, min_seconds, [&]() {
+      success = Parse(text, Driver::LexerType::kFlex,
+                      Driver::ParserType::kBison) &&
+                success;
+    }));
+    phases[3].measurements.push_back(Measure(items, min_seconds, [&]() {
+      success = Parse(text, Driver::LexerType::kFast,
+                      Driver::ParserType::kDescent) &&
+                success;
+    }));
+    phases[4].measurements.push_back(Measure(items, min_seconds, [&]() {
+      Sema other;
+      const auto result = other.Perform(driver.GetNamespaces());
+      success = result == Sema::Result::kSuccess && success;
+    }));
+    phases[5].measurements.push_back(Measure(items, min_seconds, [&]() {
+      for (const auto& ns : namespaces) {
+        ns.GetJSONObject();
+      }
+    }));
+    phases[6].measurements.push_back(Measure(items, min_seconds, [&]() {
+      success = CodeGen::RenderTemplate(parsed_template, namespaces)
+                    .result.has_value() &&
+                success;
+    }));
+    if (!success) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The slope of the least squares fit of log(value) against log(items).
+static double FitExponent(const std::vector<Measurement>& measurements,
+                          const std::function<double(const Measurement&)>& y) {
+  double mean_x = 0.0;
+  double mean_y = 0.0;
+  for (const auto& measurement : measurements) {
+    mean_x += std::log(static_cast<double>(measurement.items));
+    mean_y += std::log(std::max(y(measurement), 1e-9));
+  }
+  mean_x /= measurements.size();
+  mean_y /= measurements.size();
+  double covariance = 0.0;
+  double variance = 0.0;
+  for (const auto& measurement : measurements) {
+    const auto dx = std::log(static_cast<double>(measurement.items)) - mean_x;
+    const auto dy = std::log(std::max(y(measurement), 1e-9)) - mean_y;
+    covariance += dx * dy;
+    variance += dx * dx;
+  }
+  return variance == 0.0 ? 0.0 : covariance / variance;
+}
+
+// A fit over all sizes can hide superlinear growth at the larger sizes when the
+// smaller sizes are dominated by constant overheads. So the exponent between
+// the two largest sizes is checked as well.
+static double GetExponent(const std::vector<Measurement>& measurements,
+                          const std::function<double(const Measurement&)>& y) {
+  if (measurements.size() < 2u) {
+    return 0.0;
+  }
+  return std::max(
+      FitExponent(measurements, y),
+      FitExponent({measurements.end() - 2u, measurements.end()}, y));
+}
+
+static bool CheckPhases(const std::string& shape_name,
+                        const std::vector<PhaseMeasurements>& phases) {
+  bool passes = true;
+  std::cout << shape_name << std::endl;
+  for (const auto& phase : phases) {
+    const auto time_exponent = GetExponent(
+        phase.measurements, [](const auto& m) { return m.seconds; });
+    const auto memory_exponent = GetExponent(
+        phase.measurements, [](const auto& m) { return m.bytes; });
+    const auto time_passes = time_exponent <= kMaxTimeExponent;
+    // Phases that allocate less than a byte per item are not checked for
+    // memory.
+    const auto& largest = phase.measurements.back();
+    const auto memory_passes = largest.bytes < largest.items ||
+                               memory_exponent <= kMaxMemoryExponent;
+    std::cout << "  " << std::left << std::setw(16) << phase.name
+              << std::right;
+    for (const auto& measurement : phase.measurements) {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(3)
+                << measurement.seconds * 1e3 << " ms";
+    }
+    std::cout << "  time ~ n^" << std::setprecision(2) << time_exponent
+              << (time_passes ? "" : " (FAIL)") << ", memory ~ n^"
+              << memory_exponent << (memory_passes ? "" : " (FAIL)")
+              << std::endl;
+    passes = passes && time_passes && memory_passes;
+  }
+  return passes;
+}
+
+static bool Main(const CommandLine& args) {
+  size_t max_items = 1000000u;
+  if (auto max = args.GetString("max-items"); max.has_value()) {
+    max_items = std::stoul(max.value());
+  }
+  double min_seconds = 0.05;
+  if (auto min_time = args.GetString("min-time"); min_time.has_value()) {
+    min_seconds = std::stod(min_time.value());
+  }
+  const auto filter = args.GetString("filter");
+
+  std::vector<size_t> sizes;
+  for (size_t size = 1000u; size <= max_items; size *= 10u) {
+    sizes.push_back(size);
+  }
+
+  auto template_data =
+      ReadFileAsString(EPOXY_EXAMPLES_LOCATION "cxx_interface.template.epoxy");
+  if (!template_data.has_value()) {
+    std::cerr << "Could not read the template." << std::endl;
+    return false;
+  }
+  auto parsed_template = CodeGen::ParseTemplate(template_data.value());
+  if (!parsed_template.result) {
+    std::cerr << parsed_template.error.value_or("") << std::endl;
+    return false;
+  }
+
+  bool passes = true;
+  for (const auto& shape : GetShapes()) {
+    if (filter.has_value() &&
+        shape.name.find(filter.value()) == std::string::npos) {
+      continue;
+    }
+    // Timings are noisy on shared machines. So a shape that fails is measured
+    // again before it is reported as failing.
+    bool shape_passes = false;
+    for (size_t attempt = 0u; attempt < kMaxAttempts && !shape_passes;
+         attempt++) {
+      std::vector<PhaseMeasurements> phases;
+      if (!MeasureShape(shape, sizes, *parsed_template.result, min_seconds,
+                        phases)) {
+        std::cerr << "Could not generate code for shape " << shape.name
+                  << std::endl;
+        return false;
+      }
+      shape_passes = CheckPhases(shape.name, phases);
+    }
+    passes = shape_passes && passes;
+  }
+  return passes;
+}
+
+}  // namespace scaling
+}  // namespace epoxy
+
+int main(int argc, const char* argv[]) {
+  return epoxy::scaling::Main({argc, argv}) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
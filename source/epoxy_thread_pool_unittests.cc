@@ -0,0 +1,194 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include "epoxy_thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace epoxy {
+namespace testing {
+
+using runtime::ThreadPool;
+
+static constexpr auto kTimeout = std::chrono::seconds(10);
+
+// Counts down like std::latch, which needs C++20.
+class Latch {
+ public:
+  explicit Latch(size_t count) : count_(count) {}
+
+  void CountDown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_--;
+    done_.notify_all();
+  }
+
+  bool Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return done_.wait_for(lock, kTimeout, [&]() { return count_ == 0u; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable done_;
+  size_t count_;
+};
+
+TEST(ThreadPoolTest, RunsSubmittedTasks) {
+  ThreadPool pool({4u, 2000u});
+  ASSERT_EQ(pool.GetThreadCount(), 4u);
+  ASSERT_EQ(pool.GetQueueDepth(), 2000u);
+  std::atomic<size_t> runs = 0u;
+  Latch latch(1000u);
+  for (size_t i = 0; i < 1000u; i++) {
+    ASSERT_TRUE(pool.TrySubmit([&]() {
+      runs++;
+      latch.CountDown();
+    }));
+  }
+  ASSERT_TRUE(latch.Wait());
+  ASSERT_EQ(runs, 1000u);
+}
+
+TEST(ThreadPoolTest, PicksThreadCountAndQueueDepthByDefault) {
+  ThreadPool pool({0u, 0u});
+  ASSERT_GE(pool.GetThreadCount(), 1u);
+  ASSERT_EQ(pool.GetQueueDepth(), 1u);
+  ThreadPool::Options options;
+  ASSERT_EQ(options.queue_depth, EPOXY_THREAD_POOL_QUEUE_DEPTH);
+}
+
+TEST(ThreadPoolTest, RejectsTasksWhenTheQueuesAreFull) {
+  ThreadPool pool({1u, 2u});
+  std::promise<void> started;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  ASSERT_TRUE(pool.TrySubmit([&]() {
+    started.set_value();
+    released.wait();
+  }));
+  ASSERT_EQ(started.get_future().wait_for(kTimeout),
+            std::future_status::ready);
+
+  // The running task no longer takes up space in the queue.
+  Latch latch(2u);
+  ASSERT_TRUE(pool.TrySubmit([&]() { latch.CountDown(); }));
+  ASSERT_TRUE(pool.TrySubmit([&]() { latch.CountDown(); }));
+  ASSERT_FALSE(pool.TrySubmit([]() { FAIL() << "Must not run."; }));
+
+  release.set_value();
+  ASSERT_TRUE(latch.Wait());
+  Latch after(1u);
+  ASSERT_TRUE(pool.TrySubmit([&]() { after.CountDown(); }));
+  ASSERT_TRUE(after.Wait());
+}
+
+TEST(ThreadPoolTest, IdleThreadsStealTasks) {
+  ThreadPool pool({2u, 8u});
+  std::promise<void> stolen;
+  auto was_stolen = stolen.get_future();
+  std::promise<bool> result;
+  // The task blocks its thread after queueing another task on it. So only the
+  // other thread can run the second task.
+  ASSERT_TRUE(pool.TrySubmit([&]() {
+    ASSERT_TRUE(pool.TrySubmit([&]() { stolen.set_value(); }));
+    result.set_value(was_stolen.wait_for(kTimeout) ==
+                     std::future_status::ready);
+  }));
+  auto future = result.get_future();
+  ASSERT_EQ(future.wait_for(kTimeout * 2), std::future_status::ready);
+  ASSERT_TRUE(future.get());
+}
+
+TEST(ThreadPoolTest, RunsWaitingTasksBeforeDestruction) {
+  std::atomic<size_t> runs = 0u;
+  {
+    ThreadPool pool({2u, 100u});
+    for (size_t i = 0; i < 100u; i++) {
+      ASSERT_TRUE(pool.TrySubmit([&]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+        runs++;
+      }));
+    }
+  }
+  ASSERT_EQ(runs, 100u);
+}
+
+TEST(ThreadPoolTest, UsesEveryThread) {
+  ThreadPool pool({4u, 4u});
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  Latch started(4u);
+  // Each task waits for the others to start so each must have its own thread.
+  for (size_t i = 0; i < 4u; i++) {
+    ASSERT_TRUE(pool.TrySubmit([&]() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+      }
+      started.CountDown();
+      started.Wait();
+    }));
+  }
+  ASSERT_TRUE(started.Wait());
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(threads.size(), 4u);
+}
+
+// The generated entry points of async functions submit a task that calls the
+// function and passes the result to a completion callback. In Dart, that
+// callback posts the result to the port of the isolate that made the call.
+static std::promise<double>* gCompletion = nullptr;
+
+static void Complete(double result) {
+  gCompletion->set_value(result);
+}
+
+static double Square(double value) {
+  return value * value;
+}
+
+static bool BindSquare(void (*complete)(double), double value) {
+  return runtime::GetThreadPool().TrySubmit(
+      [=]() { complete(Square(value)); });
+}
+
+TEST(ThreadPoolTest, AsyncCallsCompleteOnTheSharedPool) {
+  ASSERT_TRUE(runtime::ConfigureThreadPool({2u, 16u}));
+  // Threads that race to start the pool all get the same one.
+  std::vector<std::thread> threads;
+  std::vector<ThreadPool*> pools(4u, nullptr);
+  for (auto& pool : pools) {
+    threads.emplace_back([&pool]() { pool = &runtime::GetThreadPool(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(std::set<ThreadPool*>(pools.begin(), pools.end()).size(), 1u);
+  ASSERT_EQ(pools[0], &runtime::GetThreadPool());
+
+  std::promise<double> completion;
+  gCompletion = &completion;
+  ASSERT_TRUE(BindSquare(&Complete, 3.0));
+  auto future = completion.get_future();
+  ASSERT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(future.get(), 9.0);
+  gCompletion = nullptr;
+
+  // The pool has started with the options given before the first call.
+  ASSERT_EQ(runtime::GetThreadPool().GetThreadCount(), 2u);
+  ASSERT_EQ(runtime::GetThreadPool().GetQueueDepth(), 16u);
+  ASSERT_FALSE(runtime::ConfigureThreadPool({4u, 16u}));
+}
+
+}  // namespace testing
+}  // namespace epoxy
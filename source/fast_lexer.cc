@@ -0,0 +1,513 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "fast_lexer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define EPOXY_FAST_LEXER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EPOXY_FAST_LEXER_SSE2 1
+#endif
+
+namespace epoxy {
+
+// Must be at least twice the vector size. See |FastLexer::buffer_|.
+static constexpr size_t kBufferPadding = 64u;
+
+static inline bool IsWhitespace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\f');
+}
+
+static inline bool IsIdentifierStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline bool IsIdentifierPart(char c) {
+  return IsIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+static inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline bool IsHexDigit(char c) {
+  return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline uint64_t GetDigitValue(char c) {
+  if (IsDigit(c)) {
+    return c - '0';
+  }
+  return (c | 0x20) - 'a' + 10;
+}
+
+static inline bool IsLineEnd(char c) {
+  return c == '\n' || c == '\0';
+}
+
+#if defined(EPOXY_FAST_LEXER_AVX2) || defined(EPOXY_FAST_LEXER_SSE2)
+
+static inline uint32_t CountTrailingZeros(uint32_t value) {
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward(&index, value);
+  return index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+static inline uint32_t HighestSetBit(uint32_t value) {
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanReverse(&index, value);
+  return index;
+#else
+  return 31u - __builtin_clz(value);
+#endif
+}
+
+static inline uint32_t PopCount(uint32_t value) {
+#if defined(_MSC_VER)
+  value = value - ((value >> 1) & 0x55555555u);
+  value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+  return (((value + (value >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#else
+  return __builtin_popcount(value);
+#endif
+}
+
+// All comparisons are signed. Bytes with the high bit set (non-ASCII) compare
+// as negative and are never classified as whitespace or identifier characters.
+#if defined(EPOXY_FAST_LEXER_AVX2)
+
+using Vector = __m256i;
+static constexpr size_t kVectorSize = 32u;
+static constexpr uint32_t kFullMask = 0xFFFFFFFFu;
+
+static inline Vector Load(const char* text) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+}
+
+static inline Vector Equal(Vector vector, char c) {
+  return _mm256_cmpeq_epi8(vector, _mm256_set1_epi8(c));
+}
+
+static inline Vector InRange(Vector vector, char low, char high) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(vector, _mm256_set1_epi8(low - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), vector));
+}
+
+static inline Vector Or(Vector a, Vector b) {
+  return _mm256_or_si256(a, b);
+}
+
+static inline uint32_t ToMask(Vector vector) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(vector));
+}
+
+#else  // defined(EPOXY_FAST_LEXER_AVX2)
+
+using Vector = __m128i;
+static constexpr size_t kVectorSize = 16u;
+static constexpr uint32_t kFullMask = 0xFFFFu;
+
+static inline Vector Load(const char* text) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+}
+
+static inline Vector Equal(Vector vector, char c) {
+  return _mm_cmpeq_epi8(vector, _mm_set1_epi8(c));
+}
+
+static inline Vector InRange(Vector vector, char low, char high) {
+  return _mm_and_si128(_mm_cmpgt_epi8(vector, _mm_set1_epi8(low - 1)),
+                       _mm_cmplt_epi8(vector, _mm_set1_epi8(high + 1)));
+}
+
+static inline Vector Or(Vector a, Vector b) {
+  return _mm_or_si128(a, b);
+}
+
+static inline uint32_t ToMask(Vector vector) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(vector));
+}
+
+#endif  // defined(EPOXY_FAST_LEXER_AVX2)
+
+static_assert(kBufferPadding >= 2u * kVectorSize, "Padding too small.");
+
+static inline uint32_t WhitespaceMask(Vector vector) {
+  return ToMask(Or(Equal(vector, ' '), InRange(vector, '\t', '\f')));
+}
+
+static inline uint32_t IdentifierPartMask(Vector vector) {
+  return ToMask(Or(Or(InRange(vector, 'a', 'z'), InRange(vector, 'A', 'Z')),
+                   Or(InRange(vector, '0', '9'), Equal(vector, '_'))));
+}
+
+static inline uint32_t LineEndMask(Vector vector) {
+  return ToMask(Or(Equal(vector, '\n'), Equal(vector, '\0')));
+}
+
+// Returns the number of leading characters for which the mask is set. The text
+// is always terminated by padding for which the mask is unset.
+template <uint32_t (*Mask)(Vector)>
+static inline size_t RunLength(const char* text) {
+  size_t length = 0u;
+  while (true) {
+    const auto others = ~Mask(Load(text + length)) & kFullMask;
+    if (others != 0u) {
+      return length + CountTrailingZeros(others);
+    }
+    length += kVectorSize;
+  }
+}
+
+#endif  // defined(EPOXY_FAST_LEXER_AVX2) || defined(EPOXY_FAST_LEXER_SSE2)
+
+struct WhitespaceRun {
+  size_t length = 0u;
+  size_t newlines = 0u;
+  // The offset of the first character after the last newline in the run.
+  size_t last_line_start = 0u;
+};
+
+static WhitespaceRun ScanWhitespace(const char* text) {
+  WhitespaceRun run;
+#if defined(EPOXY_FAST_LEXER_AVX2) || defined(EPOXY_FAST_LEXER_SSE2)
+  while (true) {
+    const auto vector = Load(text + run.length);
+    const auto others = ~WhitespaceMask(vector) & kFullMask;
+    const auto run_mask =
+        others == 0u ? kFullMask : (1u << CountTrailingZeros(others)) - 1u;
+    const auto newlines = ToMask(Equal(vector, '\n')) & run_mask;
+    if (newlines != 0u) {
+      run.newlines += PopCount(newlines);
+      run.last_line_start = run.length + HighestSetBit(newlines) + 1u;
+    }
+    if (others != 0u) {
+      run.length += CountTrailingZeros(others);
+      return run;
+    }
+    run.length += kVectorSize;
+  }
+#else
+  while (IsWhitespace(text[run.length])) {
+    if (text[run.length] == '\n') {
+      run.newlines++;
+      run.last_line_start = run.length + 1u;
+    }
+    run.length++;
+  }
+  return run;
+#endif
+}
+
+static size_t ScanIdentifierPart(const char* text) {
+#if defined(EPOXY_FAST_LEXER_AVX2) || defined(EPOXY_FAST_LEXER_SSE2)
+  return RunLength<IdentifierPartMask>(text);
+#else
+  size_t length = 0u;
+  while (IsIdentifierPart(text[length])) {
+    length++;
+  }
+  return length;
+#endif
+}
+
+static size_t ScanUntilLineEnd(const char* text) {
+#if defined(EPOXY_FAST_LEXER_AVX2) || defined(EPOXY_FAST_LEXER_SSE2)
+  size_t offset = 0u;
+  while (true) {
+    const auto line_ends = LineEndMask(Load(text + offset));
+    if (line_ends != 0u) {
+      return offset + CountTrailingZeros(line_ends);
+    }
+    offset += kVectorSize;
+  }
+#else
+  size_t length = 0u;
+  while (!IsLineEnd(text[length])) {
+    length++;
+  }
+  return length;
+#endif
+}
+
+template <size_t N>
+static inline bool IsKeyword(const char* text, const char (&keyword)[N]) {
+  return std::memcmp(text, keyword, N - 1u) == 0;
+}
+
+FastLexer::FastLexer(const std::string& text, const location& start_location)
+    : location_(start_location) {
+  // Just like the flex generated scanner, the text ends at the first NUL.
+  const auto length = std::strlen(text.c_str());
+  buffer_.reserve(length + kBufferPadding);
+  buffer_.append(text.c_str(), length);
+  buffer_.append(kBufferPadding, '\0');
+  cursor_ = buffer_.data();
+}
+
+FastLexer::~FastLexer() = default;
+
+const char* FastLexer::GetSIMDBackendName() {
+#if defined(EPOXY_FAST_LEXER_AVX2)
+  return "AVX2";
+#elif defined(EPOXY_FAST_LEXER_SSE2)
+  return "SSE2";
+#else
+  return "Scalar";
+#endif
+}
+
+void FastLexer::Consume(size_t length) {
+  location_.step();
+  location_.columns(static_cast<location::counter_type>(length));
+  cursor_ += length;
+}
+
+void FastLexer::ConsumeWhitespace() {
+  const auto run = ScanWhitespace(cursor_);
+  location_.step();
+  if (run.newlines > 0u) {
+    location_.lines(static_cast<location::counter_type>(run.newlines));
+    location_.columns(
+        static_cast<location::counter_type>(run.length - run.last_line_start));
+  } else {
+    location_.columns(static_cast<location::counter_type>(run.length));
+  }
+  cursor_ += run.length;
+}
+
+Parser::symbol_type FastLexer::Lex() {
+  while (true) {
+    const char c = *cursor_;
+
+    if (c == '\0') {
+      return Parser::make_END(location_);
+    }
+
+    if (IsWhitespace(c)) {
+      ConsumeWhitespace();
+      continue;
+    }
+
+    if (c == '/' && cursor_[1] == '/') {
+      Consume(2u + ScanUntilLineEnd(cursor_ + 2u));
+      continue;
+    }
+
+    if (IsIdentifierStart(c)) {
+      const char* identifier = cursor_;
+      const auto length = 1u + ScanIdentifierPart(cursor_ + 1u);
+      Consume(length);
+      switch (length) {
+        case 4u:
+          if (IsKeyword(identifier, "void")) {
+            return Parser::make_VOID_T(location_);
+          }
+          if (IsKeyword(identifier, "enum")) {
+            return Parser::make_ENUM(location_);
+          }
+          break;
+        case 5u:
+          if (IsKeyword(identifier, "class")) {
+            return Parser::make_CLASS(location_);
+          }
+          if (IsKeyword(identifier, "float")) {
+            return Parser::make_FLOAT(location_);
+          }
+          if (IsKeyword(identifier, "const")) {
+            return Parser::make_CONST(location_);
+          }
+          if (IsKeyword(identifier, "async")) {
+            return Parser::make_ASYNC(location_);
+          }
+          break;
+        case 6u:
+          if (IsKeyword(identifier, "struct")) {
+            return Parser::make_STRUCT(location_);
+          }
+          if (IsKeyword(identifier, "int8_t")) {
+            return Parser::make_INT_8_T(location_);
+          }
+          if (IsKeyword(identifier, "double")) {
+            return Parser::make_DOUBLE(location_);
+          }
+          if (IsKeyword(identifier, "import")) {
+            return Parser::make_IMPORT(location_);
+          }
+          if (IsKeyword(identifier, "string")) {
+            return Parser::make_STRING_T(location_);
+          }
+          break;
+        case 7u:
+          if (IsKeyword(identifier, "int16_t")) {
+            return Parser::make_INT_16_T(location_);
+          }
+          if (IsKeyword(identifier, "int32_t")) {
+            return Parser::make_INT_32_T(location_);
+          }
+          if (IsKeyword(identifier, "int64_t")) {
+            return Parser::make_INT_64_T(location_);
+          }
+          if (IsKeyword(identifier, "uint8_t")) {
+            return Parser::make_UINT_8_T(location_);
+          }
+          break;
+        case 8u:
+          if (IsKeyword(identifier, "function")) {
+            return Parser::make_FUNCTION(location_);
+          }
+          if (IsKeyword(identifier, "uint16_t")) {
+            return Parser::make_UINT_16_T(location_);
+          }
+          if (IsKeyword(identifier, "uint32_t")) {
+            return Parser::make_UINT_32_T(location_);
+          }
+          if (IsKeyword(identifier, "uint64_t")) {
+            return Parser::make_UINT_64_T(location_);
+          }
+          break;
+        case 9u:
+          if (IsKeyword(identifier, "namespace")) {
+            return Parser::make_NAMESPACE(location_);
+          }
+          break;
+      }
+      return Parser::make_IDENTIFIER(std::string{identifier, length},
+                                     location_);
+    }
+
+    if (IsDigit(c)) {
+      // Like the longest match of flex, "0x" only starts a hexadecimal number
+      // if a hexadecimal digit follows.
+      const bool is_hex = c == '0' &&
+                          (cursor_[1] == 'x' || cursor_[1] == 'X') &&
+                          IsHexDigit(cursor_[2]);
+      const auto prefix = is_hex ? 2u : 0u;
+      const uint64_t base = is_hex ? 16u : 10u;
+      uint64_t number = 0u;
+      bool overflows = false;
+      size_t length = prefix;
+      while (is_hex ? IsHexDigit(cursor_[length]) : IsDigit(cursor_[length])) {
+        const auto digit = GetDigitValue(cursor_[length]);
+        if (number > (std::numeric_limits<uint64_t>::max() - digit) / base) {
+          overflows = true;
+        } else {
+          number = number * base + digit;
+        }
+        length++;
+      }
+      Consume(length);
+      // Numbers that do not fit in 64 bits are invalid.
+      if (overflows) {
+        return Parser::make_INVALID_TOKEN(location_);
+      }
+      return Parser::make_NUMBER(number, location_);
+    }
+
+    switch (c) {
+      case ';':
+        Consume(1u);
+        return Parser::make_SEMI_COLON(location_);
+      case '{':
+        Consume(1u);
+        return Parser::make_CURLY_LEFT(location_);
+      case '}':
+        Consume(1u);
+        return Parser::make_CURLY_RIGHT(location_);
+      case '(':
+        Consume(1u);
+        return Parser::make_PAREN_LEFT(location_);
+      case ')':
+        Consume(1u);
+        return Parser::make_PAREN_RIGHT(location_);
+      case ',':
+        Consume(1u);
+        return Parser::make_COMMA(location_);
+      case '[':
+        Consume(1u);
+        return Parser::make_BRACKET_LEFT(location_);
+      case ']':
+        Consume(1u);
+        return Parser::make_BRACKET_RIGHT(location_);
+      case ':':
+        Consume(1u);
+        return Parser::make_COLON(location_);
+      case '=':
+        Consume(1u);
+        return Parser::make_EQUAL(location_);
+      case '*':
+        Consume(1u);
+        return Parser::make_STAR(location_);
+      case '-':
+        if (cursor_[1] == '>') {
+          Consume(2u);
+          return Parser::make_ARROW(location_);
+        }
+        Consume(1u);
+        return Parser::make_MINUS(location_);
+      case '+':
+        Consume(1u);
+        return Parser::make_PLUS(location_);
+      case '/':
+        // Comments have already been consumed.
+        Consume(1u);
+        return Parser::make_SLASH(location_);
+      case '%':
+        Consume(1u);
+        return Parser::make_PERCENT(location_);
+      case '<':
+        if (cursor_[1] == '<') {
+          Consume(2u);
+          return Parser::make_SHIFT_LEFT(location_);
+        }
+        break;
+      case '>':
+        if (cursor_[1] == '>') {
+          Consume(2u);
+          return Parser::make_SHIFT_RIGHT(location_);
+        }
+        break;
+      case '&':
+        Consume(1u);
+        return Parser::make_AMPERSAND(location_);
+      case '|':
+        Consume(1u);
+        return Parser::make_PIPE(location_);
+      case '"': {
+        // Strings may not span lines. An unterminated quote is invalid.
+        size_t length = 1u;
+        while (cursor_[length] != '"' && !IsLineEnd(cursor_[length])) {
+          length++;
+        }
+        if (cursor_[length] == '"') {
+          std::string string{cursor_ + 1u, length - 1u};
+          Consume(length + 1u);
+          return Parser::make_STRING(std::move(string), location_);
+        }
+        break;
+      }
+    }
+
+    Consume(1u);
+    return Parser::make_INVALID_TOKEN(location_);
+  }
+}
+
+}  // namespace epoxy
@@ -0,0 +1,41 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <string>
+
+#include "location.hh"
+#include "macros.h"
+#include "parser.h"
+
+namespace epoxy {
+
+// A hand-written alternative to the flex generated lexer in epoxy.l. It
+// produces the exact same tokens and locations. Runs of whitespace, comments
+// and identifiers are scanned using SSE2 or AVX2 when available.
+class FastLexer {
+ public:
+  FastLexer(const std::string& text, const location& start_location);
+
+  ~FastLexer();
+
+  Parser::symbol_type Lex();
+
+  static const char* GetSIMDBackendName();
+
+ private:
+  // The text is copied into a buffer that is padded with zeros so that SIMD
+  // loads past the end of the text never read out of bounds.
+  std::string buffer_;
+  const char* cursor_ = nullptr;
+  location location_;
+
+  void Consume(size_t length);
+
+  void ConsumeWhitespace();
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(FastLexer);
+};
+
+}  // namespace epoxy
@@ -0,0 +1,197 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include "driver.h"
+#include "file.h"
+#include "fixture.h"
+#include "scanner.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace epoxy {
+namespace testing {
+
+struct Token {
+  int kind = 0;
+  std::string text;
+  location::counter_type begin_line = 0;
+  location::counter_type begin_column = 0;
+  location::counter_type end_line = 0;
+  location::counter_type end_column = 0;
+
+  bool operator==(const Token& other) const {
+    return kind == other.kind && text == other.text &&
+           begin_line == other.begin_line &&
+           begin_column == other.begin_column && end_line == other.end_line &&
+           end_column == other.end_column;
+  }
+};
+
+std::ostream& operator<<(std::ostream& stream, const Token& token) {
+  return stream << "{kind: " << token.kind << ", text: '" << token.text
+                << "', " << token.begin_line << "." << token.begin_column
+                << "-" << token.end_line << "." << token.end_column << "}";
+}
+
+static std::vector<Token> Tokenize(const std::string& text,
+                                   Driver::LexerType type) {
+  const auto end_kind =
+      static_cast<int>(Parser::make_END(location()).type_get());
+  const auto identifier_kind =
+      static_cast<int>(Parser::make_IDENTIFIER({}, location()).type_get());
+  const auto string_kind =
+      static_cast<int>(Parser::make_STRING({}, location()).type_get());
+  const auto number_kind =
+      static_cast<int>(Parser::make_NUMBER(0u, location()).type_get());
+
+  Driver driver;
+  Scanner scanner(text, type, driver.GetCurrentLocation());
+  EXPECT_TRUE(scanner.IsValid());
+
+  std::vector<Token> tokens;
+  while (true) {
+    auto symbol = scanner.Lex(driver);
+    Token token;
+    token.kind = static_cast<int>(symbol.type_get());
+    if (token.kind == identifier_kind || token.kind == string_kind) {
+      token.text = symbol.value.as<std::string>();
+    } else if (token.kind == number_kind) {
+      token.text = std::to_string(symbol.value.as<uint64_t>());
+    }
+    token.begin_line = symbol.location.begin.line;
+    token.begin_column = symbol.location.begin.column;
+    token.end_line = symbol.location.end.line;
+    token.end_column = symbol.location.end.column;
+    tokens.emplace_back(std::move(token));
+    if (tokens.back().kind == end_kind) {
+      break;
+    }
+  }
+  return tokens;
+}
+
+static void ExpectSameTokens(const std::string& text) {
+  const auto flex_tokens = Tokenize(text, Driver::LexerType::kFlex);
+  const auto fast_tokens = Tokenize(text, Driver::LexerType::kFast);
+  ASSERT_EQ(flex_tokens.size(), fast_tokens.size()) << "Text: " << text;
+  for (size_t i = 0; i < flex_tokens.size(); i++) {
+    ASSERT_EQ(flex_tokens[i], fast_tokens[i])
+        << "Token " << i << " differs in text: " << text;
+  }
+}
+
+TEST(FastLexerTest, MatchesFlexOnFixtures) {
+  const std::vector<std::string> fixtures = {
+      EPOXY_FIXTURES_LOCATION "error1_1.epoxy",
+      EPOXY_FIXTURES_LOCATION "error3_1.epoxy",
+      EPOXY_FIXTURES_LOCATION "error3_3.epoxy",
+      EPOXY_FIXTURES_LOCATION "error51_12.epoxy",
+      EPOXY_FIXTURES_LOCATION "error84_24.epoxy",
+      EPOXY_FIXTURES_LOCATION "error_pretty.epoxy",
+      EPOXY_FIXTURES_LOCATION "hello.txt",
+      EPOXY_EXAMPLES_LOCATION "hello.epoxy",
+  };
+  for (const auto& fixture : fixtures) {
+    auto text = ReadFileAsString(fixture);
+    ASSERT_TRUE(text.has_value()) << fixture;
+    ExpectSameTokens(text.value());
+  }
+}
+
+TEST(FastLexerTest, MatchesFlexOnEdgeCases) {
+  const std::vector<std::string> cases = {
+      "",
+      " ",
+      "\t\v\f\n \n\n  ",
+      "//",
+      "// A comment without a trailing newline",
+      "a//b\nc",
+      "->-> - > -",
+      "/ /",
+      "namespacex namespace _namespace namespace_",
+      "int8_t int8 uint64_tt uint64_t uint128_t",
+      "void enum class float struct double function",
+      "string strings _string string_t String",
+      "import imports _import \"common.epoxy\";",
+      "\"\" \"a\"\"b\" \"a b // c\"",
+      "\"unterminated\n\"",
+      "\"unterminated",
+      "a1_ _1a 1a",
+      "\xC3\xA9t\xC3\xA9",
+      "foo\r\nbar",
+      "$@#!~`'\"[]<>?.=+-%^&|\\",
+      "enum A : uint8_t {} :: a:b",
+      "0 00 007 1a a1 0x 0xg 0x1F 0XaBg 0x0x1 00x1 A=1 == =",
+      "18446744073709551615 18446744073709551616 0xFFFFFFFFFFFFFFFF",
+      "0x10000000000000000 0x00000000000000000001 99999999999999999999999",
+      "const constant _const const1 uint32_t A = B*2+1-3/4%5<<6>>7&8|9;",
+      "async asyncs _async async_ Async async function",
+      "< > <<< >>> <> >< << >> <<>> / /// - -- --> -> + ++ % & && | ||",
+      std::string(100u, 'x') + " " + std::string(100u, 'y'),
+      std::string(100u, ' ') + "\n" + std::string(100u, '\t') + "a",
+      "//" + std::string(100u, '/') + "\n" + std::string(100u, '\n') + "//",
+      std::string("foo\0bar", 7u),
+  };
+  for (const auto& text : cases) {
+    ExpectSameTokens(text);
+  }
+}
+
+TEST(FastLexerTest, MatchesFlexOnRandomText) {
+  const std::string alphabet =
+      "abcxyzABCXYZ_0189 \t\v\f\n\n\n/////-->>;{}(),*[]:=\"\r\x80\xFF"
+      "+%<&|";
+  const std::vector<std::string> fragments = {
+      "namespace", "struct", "enum",  "function", "int32_t", "uint8_t",
+      "double",    "float",  "void",  "class",    "// ",     "\n    ",
+      "0x",        "0xfF",   "9999999999999999999999", "const",
+      "string",    "async",
+  };
+  std::mt19937 generator(1u);
+  for (size_t i = 0; i < 500u; i++) {
+    std::string text;
+    const auto length = generator() % 200u;
+    for (size_t j = 0; j < length; j++) {
+      if (generator() % 4u == 0u) {
+        text += fragments[generator() % fragments.size()];
+      } else {
+        text += alphabet[generator() % alphabet.size()];
+      }
+    }
+    ExpectSameTokens(text);
+  }
+}
+
+TEST(FastLexerTest, CanParseWithFastLexer) {
+  auto source = ReadFileAsString(EPOXY_EXAMPLES_LOCATION "hello.epoxy");
+  ASSERT_TRUE(source.has_value());
+  Driver driver;
+  driver.SetLexerType(Driver::LexerType::kFast);
+  ASSERT_EQ(driver.GetLexerType(), Driver::LexerType::kFast);
+  auto result = driver.Parse(source.value());
+  driver.PrettyPrintErrors(std::cerr, source.value());
+  ASSERT_EQ(result, Driver::ParserResult::kSuccess);
+  ASSERT_EQ(driver.GetNamespaces().size(), 1u);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetFunctions().size(), 12u);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetStructs().size(), 3u);
+  ASSERT_EQ(driver.GetNamespaces()[0].GetEnums().size(), 2u);
+}
+
+TEST(FastLexerTest, ErrorLocationsMatchFlex) {
+  auto source = ReadFileAsString(EPOXY_FIXTURES_LOCATION "error84_24.epoxy");
+  ASSERT_TRUE(source.has_value());
+  Driver driver;
+  driver.SetLexerType(Driver::LexerType::kFast);
+  auto result = driver.Parse(source.value());
+  ASSERT_EQ(result, Driver::ParserResult::kSyntaxError);
+  std::stringstream stream;
+  driver.PrettyPrintErrors(stream);
+  ASSERT_NE(stream.str().find("84:24: error"), std::string::npos);
+}
+
+}  // namespace testing
+}  // namespace epoxy
@@ -8,6 +8,15 @@
 #include <sstream>
 #include <string>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else  // defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // defined(_WIN32)
+
 namespace epoxy {
 
 std::optional<std::string> ReadFileAsString(const std::string& file_path) {
@@ -42,6 +51,23 @@ bool OverwriteFileWithStringData(const std::string& file_path,
   return true;
 }
 
+bool OverwriteFileWithBinaryData(const std::string& file_path,
+                                 std::string_view data) {
+  std::ofstream file_stream;
+  file_stream.open(file_path, std::ofstream::out | std::ofstream::trunc |
+                                  std::ofstream::binary);
+  if (file_stream.fail()) {
+    std::cerr << "Could not open " << file_path << " for writing." << std::endl;
+    return false;
+  }
+  file_stream.write(data.data(), data.size());
+  if (!file_stream.good()) {
+    std::cerr << "Could not write the whole file " << file_path << std::endl;
+    return false;
+  }
+  return true;
+}
+
 std::string HomogenizeNewlines(const std::string& string) {
   return StringReplaceAllOccurrances(string, "\r\n", "\n");
 }
@@ -105,4 +131,122 @@ std::optional<std::string> GetLineInString(const std::string& string,
   return string.substr(offset, found - offset);
 }
 
+LineIndex::LineIndex(std::string_view string) : string_(string) {
+  line_offsets_.push_back(0u);
+  for (size_t offset = string_.find('\n'); offset != std::string_view::npos;
+       offset = string_.find('\n', offset + 1u)) {
+    line_offsets_.push_back(offset + 1u);
+  }
+}
+
+LineIndex::~LineIndex() = default;
+
+size_t LineIndex::GetLineCount() const {
+  return line_offsets_.size();
+}
+
+std::optional<std::string_view> LineIndex::GetLine(size_t line) const {
+  if (line == 0u || line > line_offsets_.size()) {
+    return std::nullopt;
+  }
+  const auto begin = line_offsets_[line - 1u];
+  const auto end = line < line_offsets_.size() ? line_offsets_[line] - 1u
+                                               : string_.size();
+  return string_.substr(begin, end - begin);
+}
+
+FileMapping::FileMapping() = default;
+
+#if defined(_WIN32)
+
+std::unique_ptr<FileMapping> FileMapping::Create(const std::string& file_path) {
+  std::unique_ptr<FileMapping> mapping(new FileMapping());
+  auto file = ::CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cerr << "Could not open " << file_path << " for reading." << std::endl;
+    return nullptr;
+  }
+  mapping->file_ = file;
+  LARGE_INTEGER size = {};
+  if (!::GetFileSizeEx(file, &size)) {
+    std::cerr << "Could not get the size of " << file_path << std::endl;
+    return nullptr;
+  }
+  // Empty files cannot be mapped.
+  if (size.QuadPart == 0) {
+    return mapping;
+  }
+  mapping->mapping_ =
+      ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping->mapping_ == nullptr) {
+    std::cerr << "Could not map " << file_path << std::endl;
+    return nullptr;
+  }
+  mapping->data_ = static_cast<const char*>(
+      ::MapViewOfFile(mapping->mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (mapping->data_ == nullptr) {
+    std::cerr << "Could not map " << file_path << std::endl;
+    return nullptr;
+  }
+  mapping->size_ = static_cast<size_t>(size.QuadPart);
+  return mapping;
+}
+
+FileMapping::~FileMapping() {
+  if (data_ != nullptr) {
+    ::UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    ::CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    ::CloseHandle(file_);
+  }
+}
+
+#else  // defined(_WIN32)
+
+std::unique_ptr<FileMapping> FileMapping::Create(const std::string& file_path) {
+  const auto file = ::open(file_path.c_str(), O_RDONLY);
+  if (file == -1) {
+    std::cerr << "Could not open " << file_path << " for reading." << std::endl;
+    return nullptr;
+  }
+  struct stat info = {};
+  if (::fstat(file, &info) != 0) {
+    std::cerr << "Could not get the size of " << file_path << std::endl;
+    ::close(file);
+    return nullptr;
+  }
+  std::unique_ptr<FileMapping> mapping(new FileMapping());
+  // Empty files cannot be mapped.
+  if (info.st_size > 0) {
+    auto data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (data == MAP_FAILED) {
+      std::cerr << "Could not map " << file_path << std::endl;
+      ::close(file);
+      return nullptr;
+    }
+    mapping->data_ = static_cast<const char*>(data);
+    mapping->size_ = static_cast<size_t>(info.st_size);
+  }
+  // The mapping remains valid after the file is closed.
+  ::close(file);
+  return mapping;
+}
+
+FileMapping::~FileMapping() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+#endif  // defined(_WIN32)
+
+std::string_view FileMapping::GetData() const {
+  return {data_, size_};
+}
+
 }  // namespace epoxy
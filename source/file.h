@@ -1,11 +1,16 @@
 // This source file is part of Epoxy licensed under the MIT License.
 // See LICENSE.md file for details.
 
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #pragma once
 
+#include "macros.h"
+
 namespace epoxy {
 
 std::optional<std::string> ReadFileAsString(const std::string& file_path);
@@ -13,6 +18,10 @@ std::optional<std::string> ReadFileAsString(const std::string& file_path);
 bool OverwriteFileWithStringData(const std::string& file_path,
                                  std::string data);
 
+// Unlike |OverwriteFileWithStringData|, newlines are never translated.
+bool OverwriteFileWithBinaryData(const std::string& file_path,
+                                 std::string_view data);
+
 std::string HomogenizeNewlines(const std::string& string);
 
 std::string StringReplaceAllOccurrances(const std::string& string,
@@ -22,4 +31,47 @@ std::string StringReplaceAllOccurrances(const std::string& string,
 std::optional<std::string> GetLineInString(const std::string& string,
                                            size_t line);
 
+// Finds the offsets of all lines in a string once so that individual lines may
+// be looked up in constant time. Lines are numbered from one, like in
+// locations, and the rules for finding them are the same as those in
+// |GetLineInString|. The string must outlive the index.
+class LineIndex {
+ public:
+  explicit LineIndex(std::string_view string);
+
+  ~LineIndex();
+
+  size_t GetLineCount() const;
+
+  std::optional<std::string_view> GetLine(size_t line) const;
+
+ private:
+  std::string_view string_;
+  std::vector<size_t> line_offsets_;
+};
+
+// A read-only mapping of the contents of a file into memory.
+class FileMapping {
+ public:
+  // Returns null if the file could not be mapped.
+  static std::unique_ptr<FileMapping> Create(const std::string& file_path);
+
+  ~FileMapping();
+
+  // Valid for the lifetime of the mapping.
+  std::string_view GetData() const;
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0u;
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#endif  // defined(_WIN32)
+
+  FileMapping();
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(FileMapping);
+};
+
 }  // namespace epoxy
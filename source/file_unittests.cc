@@ -180,5 +180,36 @@ TEST(FileTest, CanGetLineInString) {
   }
 }
 
+TEST(FileTest, LineIndexMatchesGetLineInString) {
+  const std::vector<std::string> strings = {
+      "", "\n", "\nA\n", "A", "A\nB", "A\n\nB\n\n", "\r\n\r\n",
+  };
+  for (const auto& string : strings) {
+    LineIndex index(string);
+    for (size_t line = 0; line < 8u; line++) {
+      auto expected = GetLineInString(string, line);
+      auto found = index.GetLine(line);
+      ASSERT_EQ(expected.has_value(), found.has_value());
+      if (expected.has_value()) {
+        ASSERT_EQ(expected.value(), found.value());
+        ASSERT_LE(line, index.GetLineCount());
+      } else if (line != 0u) {
+        ASSERT_GT(line, index.GetLineCount());
+      }
+    }
+  }
+}
+
+TEST(FileTest, CanMapFile) {
+  auto mapping = FileMapping::Create(EPOXY_FIXTURES_LOCATION "hello.txt");
+  ASSERT_NE(mapping, nullptr);
+  auto string = ReadFileAsString(EPOXY_FIXTURES_LOCATION "hello.txt");
+  ASSERT_TRUE(string.has_value());
+  ASSERT_EQ(HomogenizeNewlines(std::string(mapping->GetData())),
+            string.value());
+  ASSERT_EQ(FileMapping::Create(EPOXY_FIXTURES_LOCATION "absent.txt"),
+            nullptr);
+}
+
 }  // namespace testing
 }  // namespace epoxy
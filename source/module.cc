@@ -0,0 +1,186 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "module.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <utility>
+
+#include "file.h"
+#include "sema.h"
+
+namespace epoxy {
+
+Module::Module(std::shared_ptr<const std::string> path,
+               std::filesystem::file_time_type modified_time,
+               std::vector<Namespace> namespaces,
+               std::vector<std::shared_ptr<const Module>> imports,
+               std::vector<std::string> errors)
+    : path_(std::move(path)),
+      modified_time_(modified_time),
+      namespaces_(std::move(namespaces)),
+      imports_(std::move(imports)),
+      errors_(std::move(errors)) {}
+
+Module::~Module() = default;
+
+const std::string& Module::GetPath() const {
+  return *path_;
+}
+
+const std::vector<Namespace>& Module::GetNamespaces() const {
+  return namespaces_;
+}
+
+const std::vector<std::shared_ptr<const Module>>& Module::GetImports() const {
+  return imports_;
+}
+
+const std::vector<std::string>& Module::GetErrors() const {
+  return errors_;
+}
+
+std::filesystem::file_time_type Module::GetModifiedTime() const {
+  return modified_time_;
+}
+
+bool Module::IsUpToDate() const {
+  std::error_code error;
+  const auto modified_time =
+      std::filesystem::last_write_time(GetPath(), error);
+  if (error || modified_time != modified_time_) {
+    return false;
+  }
+  // The imports are listed after the modules they import. So none of them need
+  // to check their own imports again.
+  for (const auto& module : GetImports()) {
+    const auto import_time =
+        std::filesystem::last_write_time(module->GetPath(), error);
+    if (error || import_time != module->modified_time_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ModuleCache::ModuleCache() = default;
+
+ModuleCache::~ModuleCache() = default;
+
+static std::string FormatDiagnostic(const Diagnostic& diagnostic) {
+  std::stringstream stream;
+  stream << diagnostic.location << ": " << diagnostic.message;
+  return stream.str();
+}
+
+ModuleCache::LoadResult ModuleCache::Load(const std::string& path,
+                                          Driver::LexerType lexer_type,
+                                          Driver::ParserType parser_type) {
+  std::error_code error;
+  const auto canonical_path = std::filesystem::canonical(path, error).string();
+  if (error) {
+    return {nullptr, "Could not find the imported file " + path + "."};
+  }
+
+  std::shared_ptr<const Module> cached;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto found = modules_.find(canonical_path); found != modules_.end()) {
+      cached = found->second;
+    }
+  }
+  if (cached && cached->IsUpToDate()) {
+    return {std::move(cached), std::nullopt};
+  }
+
+  // The modules being loaded by the current thread. Since the lock is not held
+  // while loading, a thread that finds its own module again is in a cycle.
+  // Other threads loading the same module at the same time are not.
+  static thread_local std::vector<std::pair<const ModuleCache*, std::string>>
+      loading;
+  const std::pair<const ModuleCache*, std::string> key{this, canonical_path};
+  if (std::find(loading.begin(), loading.end(), key) != loading.end()) {
+    return {nullptr, "The import of " + canonical_path + " is cyclic."};
+  }
+
+  // The time is read before the file so that modifications made while it is
+  // being read are picked up by the next load.
+  std::error_code time_error;
+  const auto modified_time =
+      std::filesystem::last_write_time(canonical_path, time_error);
+  auto text = ReadFileAsString(canonical_path);
+  if (time_error || !text.has_value()) {
+    return {nullptr, "Could not read the imported file " + path + "."};
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    load_count_++;
+  }
+
+  Driver driver(canonical_path);
+  driver.SetLexerType(lexer_type);
+  driver.SetParserType(parser_type);
+  driver.SetModuleCache(this);
+  std::vector<Namespace> namespaces;
+  std::vector<std::string> errors;
+  loading.push_back(key);
+  const auto parse_result = driver.Parse(text.value());
+  loading.pop_back();
+  if (parse_result != Driver::ParserResult::kSuccess) {
+    for (const auto& driver_error : driver.GetErrors()) {
+      errors.emplace_back(FormatDiagnostic(driver_error));
+    }
+  } else {
+    // The namespaces of imported modules have already been checked. So only
+    // the items in this file are checked here. Only those are kept by the
+    // module. Importers refer to the imported modules for the rest.
+    namespaces = driver.TakeNamespaces();
+    Sema sema;
+    if (sema.Perform(namespaces, driver.GetImportedNamespaces()) !=
+        Sema::Result::kSuccess) {
+      for (const auto& diagnostic : sema.GetDiagnostics()) {
+        errors.emplace_back(FormatDiagnostic(diagnostic));
+      }
+      namespaces.clear();
+    } else {
+      for (auto& ns : namespaces) {
+        ns.MarkChecked();
+      }
+    }
+  }
+
+  std::shared_ptr<const Module> module = std::make_shared<const Module>(
+      driver.GetSharedFileName(), modified_time, std::move(namespaces),
+      driver.GetImportedModules(), std::move(errors));
+  if (!module->GetErrors().empty()) {
+    return {std::move(module), std::nullopt};
+  }
+
+  // Another thread may have loaded the same version of the module in the
+  // meantime. That one is kept so that all importers share one module.
+  // Otherwise, the items of a file imported both directly and through another
+  // module would be added twice.
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& cached_module = modules_[canonical_path];
+  if (cached_module && cached_module->GetModifiedTime() == modified_time) {
+    return {cached_module, std::nullopt};
+  }
+  cached_module = module;
+  return {std::move(module), std::nullopt};
+}
+
+size_t ModuleCache::GetLoadCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return load_count_;
+}
+
+void ModuleCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  modules_.clear();
+  load_count_ = 0u;
+}
+
+}  // namespace epoxy
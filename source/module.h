@@ -0,0 +1,103 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "driver.h"
+#include "macros.h"
+#include "types.h"
+
+namespace epoxy {
+
+// An IDL file imported by other IDL files. A module is parsed and checked by
+// Sema once per version of the file. The result is shared by all the files
+// that import it.
+class Module {
+ public:
+  Module(std::shared_ptr<const std::string> path,
+         std::filesystem::file_time_type modified_time,
+         std::vector<Namespace> namespaces,
+         std::vector<std::shared_ptr<const Module>> imports,
+         std::vector<std::string> errors);
+
+  ~Module();
+
+  // The canonical path of the file.
+  const std::string& GetPath() const;
+
+  // The namespaces declared in the file itself. These have been checked by
+  // Sema and are not checked again by files that import the module.
+  const std::vector<Namespace>& GetNamespaces() const;
+
+  // The modules imported by this one directly or indirectly. Each module is
+  // listed once and after the modules it imports.
+  const std::vector<std::shared_ptr<const Module>>& GetImports() const;
+
+  // The syntax and Sema errors in the file or its imports. The namespaces are
+  // empty if there are errors.
+  const std::vector<std::string>& GetErrors() const;
+
+  // The modification time of the file when it was read.
+  std::filesystem::file_time_type GetModifiedTime() const;
+
+  // Whether neither the file nor any of its imports have been modified since
+  // they were read.
+  bool IsUpToDate() const;
+
+ private:
+  // Owns the file name the locations of items in the module refer to.
+  std::shared_ptr<const std::string> path_;
+  std::filesystem::file_time_type modified_time_;
+  std::vector<Namespace> namespaces_;
+  std::vector<std::shared_ptr<const Module>> imports_;
+  std::vector<std::string> errors_;
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(Module);
+};
+
+// Modules keyed by their canonical path. Files imported by more than one IDL
+// file are only parsed and checked once per cache. Modules are loaded again
+// once they or their imports are modified. A cache may be used from multiple
+// threads concurrently.
+class ModuleCache {
+ public:
+  ModuleCache();
+
+  ~ModuleCache();
+
+  struct LoadResult {
+    std::shared_ptr<const Module> module;
+    std::optional<std::string> error;
+  };
+
+  // Files that cannot be read and cyclic imports are errors. Modules with
+  // syntax or Sema errors are returned with those errors but not cached. So
+  // they are loaded again once fixed.
+  LoadResult Load(const std::string& path,
+                  Driver::LexerType lexer_type,
+                  Driver::ParserType parser_type);
+
+  // The number of files parsed by the cache.
+  size_t GetLoadCount() const;
+
+  void Clear();
+
+ private:
+  // Only guards the map and count. Files are read and parsed without holding
+  // it so that loads of unrelated modules don't serialize on each other.
+  mutable std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<const Module>> modules_;
+  size_t load_count_ = 0u;
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(ModuleCache);
+};
+
+}  // namespace epoxy
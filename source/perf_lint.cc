@@ -0,0 +1,318 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "perf_lint.h"
+
+#include <cctype>
+#include <sstream>
+#include <unordered_map>
+
+#include "version.h"
+
+namespace epoxy {
+
+static constexpr LintRuleTraits kLintRuleTraits[] = {
+    {"struct-padding",
+     "The padding in the struct exceeds the threshold on some ABI."},
+    {"hot-struct-cache-lines",
+     "The hot struct does not fit in a cache line or consecutive instances "
+     "straddle cache lines."},
+    {"wide-enum-field",
+     "The field stores an enum in more bits than its values need."},
+    {"pointer-to-primitive-argument",
+     "The argument is a pointer to a primitive that could be passed by "
+     "value."},
+    {"getter-function",
+     "The function only reads a field of the struct it is passed. Each call "
+     "costs a transition across the FFI boundary."},
+};
+
+static constexpr LintRule kLintRules[] = {
+    LintRule::kStructPadding,         LintRule::kHotStructCacheLines,
+    LintRule::kWideEnumField,         LintRule::kPointerToPrimitiveArgument,
+    LintRule::kGetterFunction,
+};
+
+const LintRuleTraits& GetLintRuleTraits(LintRule rule) {
+  return kLintRuleTraits[static_cast<size_t>(rule)];
+}
+
+static void Warn(std::vector<LintWarning>& warnings,
+                 LintRule rule,
+                 const location& location,
+                 const std::stringstream& message) {
+  LintWarning warning;
+  warning.rule = rule;
+  warning.diagnostic.location = location;
+  warning.diagnostic.message = message.str();
+  warning.diagnostic.severity = Diagnostic::Severity::kWarning;
+  warnings.emplace_back(std::move(warning));
+}
+
+static size_t GetPadding(const StructLayout& layout) {
+  size_t padding = layout.tail_padding;
+  for (const auto& field : layout.fields) {
+    padding += field.padding;
+  }
+  return padding;
+}
+
+static void LintStructLayout(const Struct& strut,
+                             const PerfLintOptions& options,
+                             std::vector<LintWarning>& warnings) {
+  // Only the ABI with the most padding is reported.
+  std::optional<StructLayout> padded;
+  std::optional<StructLayout> straddling;
+  for (const auto abi : options.abis) {
+    auto layout = strut.ComputeLayout(abi);
+    if (GetPadding(layout) > options.max_padding &&
+        (!padded.has_value() ||
+         GetPadding(layout) > GetPadding(padded.value()))) {
+      padded = layout;
+    }
+    if (!straddling.has_value() && strut.HasAttribute("hot") &&
+        options.cache_line_size % layout.size != 0u) {
+      straddling = std::move(layout);
+    }
+  }
+
+  if (padded.has_value()) {
+    std::stringstream message;
+    message << "Struct " << strut.GetName() << " has "
+            << GetPadding(padded.value()) << " bytes of padding on "
+            << GetABITraits(padded->abi).name
+            << ". Order the fields by decreasing alignment or use the reorder "
+               "attribute.";
+    Warn(warnings, LintRule::kStructPadding, strut.GetLocation(), message);
+  }
+
+  if (straddling.has_value()) {
+    std::stringstream message;
+    message << "Hot struct " << strut.GetName() << " is " << straddling->size
+            << " bytes on " << GetABITraits(straddling->abi).name << ". ";
+    if (straddling->size > options.cache_line_size) {
+      message << "It does not fit in a " << options.cache_line_size
+              << " byte cache line.";
+    } else {
+      message << "Consecutive instances straddle " << options.cache_line_size
+              << " byte cache lines.";
+    }
+    Warn(warnings, LintRule::kHotStructCacheLines, strut.GetLocation(),
+         message);
+  }
+}
+
+static void LintEnumFields(
+    const Struct& strut,
+    const std::unordered_map<std::string, const Enum*>& enums,
+    std::vector<LintWarning>& warnings) {
+  for (const auto& variable : strut.GetVariables()) {
+    const auto stored_type = variable.GetEnumUnderlyingType();
+    if (!stored_type.has_value()) {
+      continue;
+    }
+    const auto type = variable.GetUserDefinedType().value();
+    const auto found = enums.find(type);
+    if (found == enums.end()) {
+      continue;
+    }
+    const auto stored_size = GetPrimitiveTraits(stored_type.value()).size;
+    const auto needed_size =
+        GetPrimitiveTraits(found->second->GetSmallestUnderlyingType()).size;
+    if (stored_size <= needed_size) {
+      continue;
+    }
+    std::stringstream message;
+    message << "Field " << variable.GetIdentifier() << " of struct "
+            << strut.GetName() << " stores enum " << type << " in "
+            << stored_size * 8u << " bits but its values fit in "
+            << needed_size * 8u << " bits.";
+    Warn(warnings, LintRule::kWideEnumField, variable.GetLocation(), message);
+  }
+}
+
+// Names are compared ignoring case and underscores. So "GetWidth",
+// "get_width" and "width" all name the field "width".
+static std::string NormalizeName(const std::string& name) {
+  std::string normalized;
+  normalized.reserve(name.size());
+  for (const auto c : name) {
+    if (c != '_') {
+      normalized.push_back(
+          static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+  }
+  return normalized;
+}
+
+// Returns the field of the struct argument the function reads if it looks
+// like a getter.
+static const Variable* FindGetterField(
+    const Function& function,
+    const std::unordered_map<std::string, const Struct*>& structs) {
+  const auto& arguments = function.GetArguments();
+  if (arguments.size() != 1u || !arguments[0].IsPointer()) {
+    return nullptr;
+  }
+  const auto type = arguments[0].GetUserDefinedType();
+  if (!type.has_value()) {
+    return nullptr;
+  }
+  const auto found = structs.find(type.value());
+  if (found == structs.end()) {
+    return nullptr;
+  }
+
+  const auto name = NormalizeName(function.GetName());
+  const auto return_type = function.GetReturnType();
+  for (const auto& field : found->second->GetVariables()) {
+    const auto field_name = NormalizeName(field.GetIdentifier());
+    if (name != field_name && name != "get" + field_name) {
+      continue;
+    }
+    const auto field_type = field.GetPrimitive().has_value()
+                                ? Function::ReturnType{field.GetPrimitive()
+                                                           .value()}
+                                : Function::ReturnType{
+                                      field.GetUserDefinedType().value()};
+    if (field_type == return_type && !field.IsArray() &&
+        field.IsPointer() == function.ReturnsPointer()) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+static void LintFunction(
+    const Function& function,
+    const std::unordered_map<std::string, const Struct*>& structs,
+    std::vector<LintWarning>& warnings) {
+  for (const auto& argument : function.GetArguments()) {
+    const auto primitive = argument.GetPrimitive();
+    // Void pointers are opaque handles.
+    if (!argument.IsPointer() || !primitive.has_value() ||
+        primitive.value() == Primitive::kVoid) {
+      continue;
+    }
+    std::stringstream message;
+    message << "Argument " << argument.GetIdentifier() << " of function "
+            << function.GetName() << " is a pointer to "
+            << GetPrimitiveTraits(primitive.value()).type
+            << ". Pass it by value unless the function writes to it.";
+    Warn(warnings, LintRule::kPointerToPrimitiveArgument,
+         argument.GetLocation(), message);
+  }
+
+  if (auto field = FindGetterField(function, structs)) {
+    std::stringstream message;
+    message << "Function " << function.GetName() << " only reads field "
+            << field->GetIdentifier() << " of struct "
+            << function.GetArguments()[0].GetUserDefinedType().value()
+            << ". Each call costs an FFI transition. Read the field from the "
+               "struct instead.";
+    Warn(warnings, LintRule::kGetterFunction, function.GetLocation(),
+         message);
+  }
+}
+
+void PerfLint(const Namespace& ns,
+              const PerfLintOptions& options,
+              std::vector<LintWarning>& warnings) {
+  std::unordered_map<std::string, const Struct*> structs;
+  structs.reserve(ns.GetStructs().size());
+  for (const auto& strut : ns.GetStructs()) {
+    structs[strut.GetName()] = &strut;
+  }
+  std::unordered_map<std::string, const Enum*> enums;
+  enums.reserve(ns.GetEnums().size());
+  for (const auto& enumm : ns.GetEnums()) {
+    enums[enumm.GetName()] = &enumm;
+  }
+
+  const auto& all_structs = ns.GetStructs();
+  for (size_t i = ns.GetCheckedStructCount(); i < all_structs.size(); i++) {
+    LintStructLayout(all_structs[i], options, warnings);
+    LintEnumFields(all_structs[i], enums, warnings);
+  }
+  const auto& functions = ns.GetFunctions();
+  for (size_t i = ns.GetCheckedFunctionCount(); i < functions.size(); i++) {
+    LintFunction(functions[i], structs, warnings);
+  }
+}
+
+void PrettyPrintLintWarnings(std::ostream& stream,
+                             const std::vector<LintWarning>& warnings,
+                             const std::string& original_text) {
+  std::vector<Diagnostic> diagnostics;
+  diagnostics.reserve(warnings.size());
+  for (const auto& warning : warnings) {
+    diagnostics.push_back(warning.diagnostic);
+    diagnostics.back().message +=
+        std::string{" ["} + GetLintRuleTraits(warning.rule).id + "]";
+  }
+  PrettyPrintDiagnostics(stream, diagnostics, original_text);
+}
+
+static nlohmann::json GetSARIFLocation(const location& location) {
+  nlohmann::json region;
+  region["startLine"] = location.begin.line;
+  region["startColumn"] = location.begin.column;
+  region["endLine"] = location.end.line;
+  region["endColumn"] = location.end.column;
+
+  nlohmann::json physical_location;
+  if (location.begin.filename != nullptr) {
+    physical_location["artifactLocation"]["uri"] = *location.begin.filename;
+  }
+  physical_location["region"] = std::move(region);
+
+  nlohmann::json sarif_location;
+  sarif_location["physicalLocation"] = std::move(physical_location);
+  return sarif_location;
+}
+
+std::string GetLintWarningsSARIF(const std::vector<LintWarning>& warnings) {
+  auto rules = nlohmann::json::array();
+  for (const auto rule : kLintRules) {
+    const auto& traits = GetLintRuleTraits(rule);
+    nlohmann::json sarif_rule;
+    sarif_rule["id"] = traits.id;
+    sarif_rule["shortDescription"]["text"] = traits.description;
+    sarif_rule["defaultConfiguration"]["level"] = "warning";
+    rules.emplace_back(std::move(sarif_rule));
+  }
+
+  auto results = nlohmann::json::array();
+  for (const auto& warning : warnings) {
+    nlohmann::json result;
+    result["ruleId"] = GetLintRuleTraits(warning.rule).id;
+    result["ruleIndex"] = static_cast<size_t>(warning.rule);
+    result["level"] = "warning";
+    result["message"]["text"] = warning.diagnostic.message;
+    result["locations"] = nlohmann::json::array(
+        {GetSARIFLocation(warning.diagnostic.location)});
+    results.emplace_back(std::move(result));
+  }
+
+  std::stringstream version;
+  version << EPOXY_VERSION_MAJOR << "." << EPOXY_VERSION_MINOR << "."
+          << EPOXY_VERSION_PATCH;
+
+  nlohmann::json driver;
+  driver["name"] = "epoxy";
+  driver["version"] = version.str();
+  driver["informationUri"] = "https://github.com/chinmaygarde/epoxy";
+  driver["rules"] = std::move(rules);
+
+  nlohmann::json run;
+  run["tool"]["driver"] = std::move(driver);
+  run["results"] = std::move(results);
+
+  nlohmann::json log;
+  log["$schema"] = "https://json.schemastore.org/sarif-2.1.0.json";
+  log["version"] = "2.1.0";
+  log["runs"] = nlohmann::json::array({std::move(run)});
+  return log.dump(2);
+}
+
+}  // namespace epoxy
@@ -0,0 +1,72 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "diagnostic.h"
+#include "types.h"
+
+namespace epoxy {
+
+// The performance lint pass looks for declarations that are valid but make
+// the generated bindings slower than they need to be. Lints are warnings and
+// never fail the compilation.
+enum class LintRule {
+  // The padding in a struct exceeds the threshold on some ABI.
+  kStructPadding,
+  // A struct marked [[hot]] does not fit in a cache line or consecutive
+  // instances straddle cache lines.
+  kHotStructCacheLines,
+  // A struct field stores an enum in more bits than its values need.
+  kWideEnumField,
+  // An argument is a pointer to a primitive that could be passed by value.
+  kPointerToPrimitiveArgument,
+  // A function only reads a field of the struct it is passed. Each call costs
+  // a transition across the FFI boundary.
+  kGetterFunction,
+};
+
+struct LintRuleTraits {
+  // The identifier of the rule in SARIF logs.
+  const char* id;
+  const char* description;
+};
+
+const LintRuleTraits& GetLintRuleTraits(LintRule rule);
+
+struct LintWarning {
+  LintRule rule = LintRule::kStructPadding;
+  Diagnostic diagnostic;
+};
+
+struct PerfLintOptions {
+  // The ABIs struct layouts are checked on.
+  std::vector<ABI> abis = {ABI::kX86_64, ABI::kAArch64, ABI::kARM32,
+                           ABI::kIA32};
+  // Structs with more padding than this on any ABI are reported.
+  size_t max_padding = 8u;
+  size_t cache_line_size = 64u;
+};
+
+// Appends the warnings for the namespace. The namespace must have passed Sema.
+// Items that had already been checked (like those of imported files) are
+// linted along with the file they are declared in instead.
+void PerfLint(const Namespace& ns,
+              const PerfLintOptions& options,
+              std::vector<LintWarning>& warnings);
+
+// Prints the warnings like PrettyPrintDiagnostics prints errors. The message
+// of each warning is followed by the identifier of its rule.
+void PrettyPrintLintWarnings(std::ostream& stream,
+                             const std::vector<LintWarning>& warnings,
+                             const std::string& original_text = "");
+
+// A SARIF 2.1.0 log with a single run that lists every rule and the warnings
+// as results.
+std::string GetLintWarningsSARIF(const std::vector<LintWarning>& warnings);
+
+}  // namespace epoxy
@@ -0,0 +1,144 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "driver.h"
+#include "perf_lint.h"
+#include "sema.h"
+
+namespace epoxy {
+namespace testing {
+
+// The locations of the warnings refer to the file name owned by the driver.
+static std::vector<LintWarning> Lint(Driver& driver, const std::string& idl) {
+  EXPECT_EQ(driver.Parse(idl), Driver::ParserResult::kSuccess);
+  driver.PrettyPrintErrors(std::cerr);
+  Sema sema;
+  sema.SetPerfLint({});
+  EXPECT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  sema.PrettyPrintErrors(std::cerr);
+  return sema.GetLintWarnings();
+}
+
+constexpr const char* kSlowIDL = R"~(
+  namespace foo {
+    enum Kind : uint64_t { A, B }
+    struct Padded {
+      int8_t a;
+      double b;
+      int8_t c;
+    }
+    [[hot]]
+    struct Hot {
+      double a;
+      double b;
+      double c;
+    }
+    struct Tagged {
+      Kind kind;
+    }
+    struct Size {
+      uint32_t width;
+      uint32_t height;
+    }
+    function GetWidth(Size* size) -> uint32_t
+    function Scale(float* factor, void* handle)
+  }
+)~";
+
+TEST(PerfLintTest, ReportsEachRule) {
+  Driver driver("lint.epoxy");
+  const auto warnings = Lint(driver, kSlowIDL);
+  ASSERT_EQ(warnings.size(), 5u);
+  ASSERT_EQ(warnings[0].rule, LintRule::kStructPadding);
+  ASSERT_EQ(warnings[0].diagnostic.message,
+            "Struct Padded has 14 bytes of padding on x86_64. Order the "
+            "fields by decreasing alignment or use the reorder attribute.");
+  ASSERT_EQ(warnings[1].rule, LintRule::kHotStructCacheLines);
+  ASSERT_EQ(warnings[1].diagnostic.message,
+            "Hot struct Hot is 24 bytes on x86_64. Consecutive instances "
+            "straddle 64 byte cache lines.");
+  ASSERT_EQ(warnings[2].rule, LintRule::kWideEnumField);
+  ASSERT_EQ(warnings[2].diagnostic.message,
+            "Field kind of struct Tagged stores enum Kind in 64 bits but its "
+            "values fit in 8 bits.");
+  ASSERT_EQ(warnings[3].rule, LintRule::kGetterFunction);
+  ASSERT_EQ(warnings[3].diagnostic.location.begin.line, 22u);
+  ASSERT_EQ(warnings[4].rule, LintRule::kPointerToPrimitiveArgument);
+  ASSERT_EQ(warnings[4].diagnostic.message,
+            "Argument factor of function Scale is a pointer to float. Pass it "
+            "by value unless the function writes to it.");
+  for (const auto& warning : warnings) {
+    ASSERT_EQ(warning.diagnostic.severity, Diagnostic::Severity::kWarning);
+  }
+
+  std::stringstream stream;
+  PrettyPrintLintWarnings(stream, warnings, kSlowIDL);
+  ASSERT_NE(stream.str().find("lint.epoxy:4:12: warning: Struct Padded has 14 "
+                              "bytes"),
+            std::string::npos);
+  ASSERT_NE(stream.str().find("reorder attribute. [struct-padding]"),
+            std::string::npos);
+}
+
+TEST(PerfLintTest, FastDeclarationsHaveNoWarnings) {
+  Driver driver;
+  ASSERT_TRUE(Lint(driver, R"~(
+    namespace foo {
+      [[reorder]]
+      struct Padded {
+        int8_t a;
+        double b;
+        int8_t c;
+      }
+      [[hot]]
+      struct Hot {
+        double a;
+        double b;
+      }
+      struct Size {
+        uint32_t width;
+      }
+      function GetHeight(Size* size) -> uint32_t
+      function GetWidth(Size* size, uint32_t scale) -> uint32_t
+      function Release(void* handle)
+    }
+  )~")
+                  .empty());
+}
+
+TEST(PerfLintTest, LintsAreOffByDefault) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(kSlowIDL), Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  ASSERT_TRUE(sema.GetLintWarnings().empty());
+}
+
+TEST(PerfLintTest, WritesSARIFLogs) {
+  Driver driver("lint.epoxy");
+  const auto warnings = Lint(driver, kSlowIDL);
+  const auto log = nlohmann::json::parse(GetLintWarningsSARIF(warnings));
+  ASSERT_EQ(log["version"], "2.1.0");
+  ASSERT_EQ(log["runs"].size(), 1u);
+  const auto& run = log["runs"][0];
+  ASSERT_EQ(run["tool"]["driver"]["name"], "epoxy");
+  ASSERT_EQ(run["tool"]["driver"]["rules"].size(), 5u);
+  ASSERT_EQ(run["results"].size(), warnings.size());
+
+  const auto& result = run["results"][2];
+  ASSERT_EQ(result["ruleId"], "wide-enum-field");
+  ASSERT_EQ(run["tool"]["driver"]["rules"][result["ruleIndex"].get<size_t>()]
+               ["id"],
+            "wide-enum-field");
+  ASSERT_EQ(result["level"], "warning");
+  const auto& location = result["locations"][0]["physicalLocation"];
+  ASSERT_EQ(location["artifactLocation"]["uri"], "lint.epoxy");
+  ASSERT_EQ(location["region"]["startLine"], 16u);
+}
+
+}  // namespace testing
+}  // namespace epoxy
@@ -5,25 +5,38 @@
 
 namespace epoxy {
 
-Scanner::Scanner(const std::string& text)
+Scanner::Scanner(const std::string& text,
+                 Driver::LexerType type,
+                 const location& start_location)
     : scanner_(nullptr), buffer_(nullptr), is_valid_(false) {
-  if (epoxy_lex_init(&scanner_) != 0) {
-    return;
+  switch (type) {
+    case Driver::LexerType::kFlex:
+      if (epoxy_lex_init(&scanner_) != 0) {
+        return;
+      }
+      buffer_ = epoxy__scan_string(text.data(), scanner_);
+      is_valid_ = true;
+      break;
+    case Driver::LexerType::kFast:
+      fast_lexer_ = std::make_unique<FastLexer>(text, start_location);
+      is_valid_ = true;
+      break;
   }
-  buffer_ = epoxy__scan_string(text.data(), scanner_);
-  is_valid_ = true;
 }
 
 bool Scanner::IsValid() const {
   return is_valid_;
 }
 
-yyscan_t Scanner::GetHandle() {
-  return scanner_;
+Parser::symbol_type Scanner::Lex(Driver& driver) {
+  if (fast_lexer_) {
+    return fast_lexer_->Lex();
+  }
+  return epoxy_flex_lex(driver, scanner_);
 }
 
 Scanner::~Scanner() {
-  if (!is_valid_) {
+  if (!is_valid_ || fast_lexer_) {
     return;
   }
 
@@ -32,3 +45,7 @@ Scanner::~Scanner() {
 }
 
 }  // namespace epoxy
+
+epoxy::Parser::symbol_type epoxy_lex(epoxy::Driver& driver, void* scanner) {
+  return static_cast<epoxy::Scanner*>(scanner)->Lex(driver);
+}
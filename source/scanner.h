@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <memory>
+
 #include "decls.h"
+#include "fast_lexer.h"
 #include "lexer.h"
 #include "macros.h"
 
@@ -11,17 +14,20 @@ namespace epoxy {
 
 class Scanner {
  public:
-  Scanner(const std::string& text);
+  Scanner(const std::string& text,
+          Driver::LexerType type = Driver::LexerType::kFlex,
+          const location& start_location = location());
 
   ~Scanner();
 
   bool IsValid() const;
 
-  yyscan_t GetHandle();
+  Parser::symbol_type Lex(Driver& driver);
 
  private:
   yyscan_t scanner_ = {};
   YY_BUFFER_STATE buffer_ = {};
+  std::unique_ptr<FastLexer> fast_lexer_;
   bool is_valid_ = false;
 
   EPOXY_DISALLOW_COPY_AND_ASSIGN(Scanner);
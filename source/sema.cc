@@ -5,6 +5,8 @@
 
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace epoxy {
 
@@ -12,31 +14,245 @@ Sema::Sema() = default;
 
 Sema::~Sema() = default;
 
-Sema::Result Sema::Perform(std::vector<Namespace> namespaces_vector) {
+void Sema::SetSelectors(std::vector<std::string> selectors) {
+  selectors_ = std::move(selectors);
+}
+
+void Sema::SetABIs(std::vector<ABI> abis) {
+  abis_ = std::move(abis);
+}
+
+void Sema::SetPerfLint(PerfLintOptions options) {
+  perf_lint_ = std::move(options);
+}
+
+// Diagnostics for selectors are not caused by the IDL.
+static Diagnostic CreateSelectorDiagnostic(std::string message) {
+  Diagnostic diagnostic;
+  diagnostic.location.begin.line = 0;
+  diagnostic.location.end.line = 0;
+  diagnostic.message = std::move(message);
+  return diagnostic;
+}
+
+static bool HasSymbolNamed(const Namespace& ns, const std::string& name) {
+  if (ns.HasStructNamed(name) || ns.HasEnumNamed(name) ||
+      ns.HasConstantNamed(name)) {
+    return true;
+  }
+  for (const auto& function : ns.GetFunctions()) {
+    if (function.GetName() == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns a namespace with the functions, structs, enums and constants named
+// by the symbols along with the structs and enums they reference. Array
+// lengths and enum values have already been evaluated. So constants are only
+// selected by name.
+static Namespace SelectFromNamespace(
+    const Namespace& ns,
+    const std::unordered_set<std::string>& symbols) {
+  std::unordered_map<std::string, const Struct*> structs;
+  structs.reserve(ns.GetStructs().size());
+  for (const auto& strut : ns.GetStructs()) {
+    structs[strut.GetName()] = &strut;
+  }
+
+  std::unordered_set<std::string> types(symbols.begin(), symbols.end());
+  std::vector<std::string> pending(symbols.begin(), symbols.end());
+  auto reference = [&](const std::optional<std::string>& type) {
+    if (type.has_value() && types.insert(type.value()).second) {
+      pending.push_back(type.value());
+    }
+  };
+
+  for (const auto& function : ns.GetFunctions()) {
+    if (symbols.count(function.GetName()) == 0u) {
+      continue;
+    }
+    for (const auto& argument : function.GetArguments()) {
+      reference(argument.GetUserDefinedType());
+    }
+    const auto return_type = function.GetReturnType();
+    if (auto type = std::get_if<std::string>(&return_type)) {
+      reference(*type);
+    }
+  }
+
+  while (!pending.empty()) {
+    const auto found = structs.find(pending.back());
+    pending.pop_back();
+    if (found == structs.end()) {
+      continue;
+    }
+    for (const auto& variable : found->second->GetVariables()) {
+      reference(variable.GetUserDefinedType());
+    }
+  }
+
+  Namespace selected;
+  selected.SetName(ns.GetName());
+  for (const auto& function : ns.GetFunctions()) {
+    if (symbols.count(function.GetName()) != 0u) {
+      selected.AddFunction(function);
+    }
+  }
+  for (const auto& strut : ns.GetStructs()) {
+    if (types.count(strut.GetName()) != 0u) {
+      selected.AddStruct(strut);
+    }
+  }
+  for (const auto& enumm : ns.GetEnums()) {
+    if (types.count(enumm.GetName()) != 0u) {
+      selected.AddEnum(enumm);
+    }
+  }
+  for (const auto& constant : ns.GetConstants()) {
+    if (symbols.count(constant.GetName()) != 0u) {
+      selected.AddConstant(constant);
+    }
+  }
+  return selected;
+}
+
+bool Sema::ApplySelectors(std::map<std::string, Namespace>& namespaces) {
+  if (selectors_.empty()) {
+    return true;
+  }
+
+  bool passes = true;
+  std::set<std::string> whole_namespaces;
+  std::map<std::string, std::unordered_set<std::string>> symbols;
+  for (const auto& selector : selectors_) {
+    const auto separator = selector.find("::");
+    if (separator == std::string::npos || separator == 0u ||
+        separator + 2u == selector.size()) {
+      diagnostics_.push_back(CreateSelectorDiagnostic(
+          "Invalid selector '" + selector +
+          "'. Selectors must be either namespace::Symbol or namespace::*."));
+      passes = false;
+      continue;
+    }
+    const auto ns_name = selector.substr(0u, separator);
+    const auto symbol = selector.substr(separator + 2u);
+    const auto found = namespaces.find(ns_name);
+    if (found == namespaces.end()) {
+      diagnostics_.push_back(CreateSelectorDiagnostic(
+          "No namespace named " + ns_name + " for selector '" + selector +
+          "'."));
+      passes = false;
+      continue;
+    }
+    if (symbol == "*") {
+      whole_namespaces.insert(ns_name);
+      continue;
+    }
+    if (!HasSymbolNamed(found->second, symbol)) {
+      diagnostics_.push_back(CreateSelectorDiagnostic(
+          "No function, struct, enum or constant named " + symbol +
+          " in namespace " + ns_name + " for selector '" + selector + "'."));
+      passes = false;
+      continue;
+    }
+    symbols[ns_name].insert(symbol);
+  }
+
+  if (!passes) {
+    return false;
+  }
+
+  for (auto ns = namespaces.begin(); ns != namespaces.end();) {
+    if (whole_namespaces.count(ns->first) != 0u) {
+      ++ns;
+      continue;
+    }
+    const auto found = symbols.find(ns->first);
+    if (found == symbols.end()) {
+      ns = namespaces.erase(ns);
+      continue;
+    }
+    ns->second = SelectFromNamespace(ns->second, found->second);
+    ++ns;
+  }
+  return true;
+}
+
+Sema::Result Sema::Perform(
+    std::vector<Namespace> namespaces_vector,
+    const std::vector<const Namespace*>& imported_namespaces) {
   std::map<std::string, Namespace> namespaces;
 
-  for (const auto& ns : namespaces_vector) {
-    namespaces[ns.GetName()].SetName(ns.GetName());
-    namespaces[ns.GetName()].AddFunctions(ns.GetFunctions());
-    namespaces[ns.GetName()].AddStructs(ns.GetStructs());
-    namespaces[ns.GetName()].AddEnums(ns.GetEnums());
+  // The checked items of imported namespaces must come first.
+  for (const auto* ns : imported_namespaces) {
+    auto& merged = namespaces[ns->GetName()];
+    merged.SetName(ns->GetName());
+    merged.Append(Namespace(*ns));
+  }
+  for (auto& ns : namespaces_vector) {
+    auto& merged = namespaces[ns.GetName()];
+    merged.SetName(ns.GetName());
+    merged.Append(std::move(ns));
+  }
+
+  // Array lengths and enum values may refer to constants. So those are
+  // evaluated before the items are checked. Items are still checked if some
+  // could not be evaluated so that all errors are reported at once. The checks
+  // that need those values are skipped.
+  bool passes = true;
+  for (auto& ns : namespaces) {
+    passes = ns.second.EvaluateConstants(diagnostics_) && passes;
+    passes = ns.second.PassesSema(diagnostics_) && passes;
+  }
+
+  if (!passes) {
+    return Result::kError;
   }
 
-  for (const auto& ns : namespaces) {
-    if (!ns.second.PassesSema(errors_)) {
-      return Result::kError;
+  // Selectors make new namespaces that no longer know which items had already
+  // been checked. So fields are split, reordered and linted before selecting.
+  for (auto& ns : namespaces) {
+    ns.second.ResolveEnumTypes();
+    ns.second.SplitColdStructFields();
+    ns.second.ReorderStructFields();
+    if (perf_lint_.has_value()) {
+      PerfLint(ns.second, perf_lint_.value(), lint_warnings_);
     }
   }
 
-  for (const auto& ns : namespaces) {
-    namespaces_.push_back(ns.second);
+  if (!ApplySelectors(namespaces)) {
+    return Result::kError;
+  }
+
+  for (auto& ns : namespaces) {
+    if (!abis_.empty()) {
+      ns.second.ComputeStructLayouts(abis_);
+    }
+    namespaces_.emplace_back(std::move(ns.second));
   }
 
   return Result::kSuccess;
 }
 
-void Sema::PrettyPrintErrors(std::ostream& stream) {
-  stream << errors_.str() << std::endl;
+void Sema::PrettyPrintErrors(std::ostream& stream,
+                             const std::string& original_text) const {
+  PrettyPrintDiagnostics(stream, diagnostics_, original_text);
+}
+
+std::string Sema::GetErrors() const {
+  std::stringstream stream;
+  PrettyPrintErrors(stream);
+  return stream.str();
+}
+
+const std::vector<Diagnostic>& Sema::GetDiagnostics() const {
+  return diagnostics_;
+}
+
+const std::vector<LintWarning>& Sema::GetLintWarnings() const {
+  return lint_warnings_;
 }
 
 const std::vector<Namespace>& Sema::GetNamespaces() const {
@@ -3,10 +3,15 @@
 
 #pragma once
 
+#include <map>
+#include <optional>
 #include <sstream>
+#include <string>
 #include <vector>
 
+#include "diagnostic.h"
 #include "macros.h"
+#include "perf_lint.h"
 #include "types.h"
 
 namespace epoxy {
@@ -22,16 +27,51 @@ class Sema {
 
   ~Sema();
 
-  Result Perform(std::vector<Namespace> namespaces);
+  // Restricts the namespaces returned by |GetNamespaces| to the selected
+  // items and the structs and enums they reference, directly or through other
+  // structs. Each selector is either "namespace::Symbol" or "namespace::*".
+  // Everything is selected if there are no selectors. Must be called before
+  // |Perform|.
+  void SetSelectors(std::vector<std::string> selectors);
 
-  void PrettyPrintErrors(std::ostream& stream);
+  // The ABIs to compute the layouts of structs for. No layouts are computed
+  // by default. Must be called before |Perform|.
+  void SetABIs(std::vector<ABI> abis);
+
+  // Enables the performance lint pass. Warnings are collected for the items
+  // that are checked. The lints do not affect the result. Must be called
+  // before |Perform|.
+  void SetPerfLint(PerfLintOptions options);
+
+  // All items in all namespaces are checked. Items that have already been
+  // checked (like those of imported files) are only checked for name
+  // collisions. The imported namespaces are only read and are merged before
+  // the others. Diagnostics are collected for every error found instead of
+  // just the first one.
+  Result Perform(std::vector<Namespace> namespaces,
+                 const std::vector<const Namespace*>& imported_namespaces = {});
+
+  void PrettyPrintErrors(std::ostream& stream,
+                         const std::string& original_text = "") const;
+
+  std::string GetErrors() const;
+
+  const std::vector<Diagnostic>& GetDiagnostics() const;
+
+  const std::vector<LintWarning>& GetLintWarnings() const;
 
   const std::vector<Namespace>& GetNamespaces() const;
 
  private:
-  std::stringstream errors_;
+  std::vector<std::string> selectors_;
+  std::vector<ABI> abis_;
+  std::optional<PerfLintOptions> perf_lint_;
+  std::vector<Diagnostic> diagnostics_;
+  std::vector<LintWarning> lint_warnings_;
   std::vector<Namespace> namespaces_;
 
+  bool ApplySelectors(std::map<std::string, Namespace>& namespaces);
+
   EPOXY_DISALLOW_COPY_AND_ASSIGN(Sema);
 };
 
@@ -3,6 +3,11 @@
 
 #include <gtest/gtest.h>
 
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+
 #include "driver.h"
 #include "sema.h"
 
@@ -190,5 +195,1025 @@ TEST(SemaTest, CannotReturnUnknownEnum) {
   ASSERT_EQ(result, Sema::Result::kError);
 }
 
+TEST(SemaTest, ReportsAllErrorsWithLocations) {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(namespace foo {
+  struct Foo {
+    void a;
+    Absent* b;
+  }
+  function Foo() -> Absent
+  function Foo() -> void
+}
+namespace bar {
+  enum Foo {
+    A,
+    A,
+  }
+})~");
+  driver.PrettyPrintErrors(std::cerr);
+  ASSERT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  auto result = sema.Perform(driver.GetNamespaces());
+  sema.PrettyPrintErrors(std::cerr);
+  ASSERT_EQ(result, Sema::Result::kError);
+  const auto& diagnostics = sema.GetDiagnostics();
+  ASSERT_EQ(diagnostics.size(), 5u);
+  // Namespaces are checked in the order of their names. The duplicate member
+  // is reported where it is declared again.
+  ASSERT_EQ(diagnostics[0].location.begin.line, 12u);
+  ASSERT_EQ(diagnostics[0].location.begin.column, 5u);
+  ASSERT_EQ(diagnostics[1].location.begin.line, 7u);
+  ASSERT_EQ(diagnostics[2].location.begin.line, 3u);
+  ASSERT_EQ(diagnostics[2].location.begin.column, 5u);
+  ASSERT_EQ(diagnostics[3].location.begin.line, 4u);
+  ASSERT_EQ(diagnostics[4].location.begin.line, 6u);
+  ASSERT_EQ(diagnostics[4].location.begin.column, 12u);
+}
+
+static constexpr const char* kSelectionIDL = R"~(
+    namespace foo {
+      enum Color {
+        Red,
+      }
+      enum Unused {
+        Nothing,
+      }
+      struct Point {
+        Color color;
+        Line* line;
+      }
+      struct Line {
+        Point* start;
+        int32_t width;
+      }
+      struct Other {
+        int32_t a;
+      }
+      function GetPoint(Color color) -> Point*
+      function GetOther() -> Other*
+      const uint32_t kWidth = 2;
+    }
+    namespace bar {
+      function Baz() -> void
+    }
+  )~";
+
+static std::vector<std::string> GetNames(const Namespace& ns) {
+  std::vector<std::string> names;
+  for (const auto& function : ns.GetFunctions()) {
+    names.push_back(function.GetName());
+  }
+  for (const auto& strut : ns.GetStructs()) {
+    names.push_back(strut.GetName());
+  }
+  for (const auto& enumm : ns.GetEnums()) {
+    names.push_back(enumm.GetName());
+  }
+  for (const auto& constant : ns.GetConstants()) {
+    names.push_back(constant.GetName());
+  }
+  return names;
+}
+
+TEST(SemaTest, SelectsReferencedTypes) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(kSelectionIDL), Driver::ParserResult::kSuccess);
+  Sema sema;
+  sema.SetSelectors({"foo::GetPoint"});
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  const auto& namespaces = sema.GetNamespaces();
+  ASSERT_EQ(namespaces.size(), 1u);
+  ASSERT_EQ(namespaces[0].GetName(), "foo");
+  ASSERT_EQ(GetNames(namespaces[0]),
+            (std::vector<std::string>{"GetPoint", "Point", "Line", "Color"}));
+}
+
+TEST(SemaTest, SelectsWholeNamespaces) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(kSelectionIDL), Driver::ParserResult::kSuccess);
+  Sema sema;
+  sema.SetSelectors({"bar::*", "foo::Other", "foo::kWidth"});
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  const auto& namespaces = sema.GetNamespaces();
+  ASSERT_EQ(namespaces.size(), 2u);
+  ASSERT_EQ(GetNames(namespaces[0]), (std::vector<std::string>{"Baz"}));
+  ASSERT_EQ(GetNames(namespaces[1]),
+            (std::vector<std::string>{"Other", "kWidth"}));
+}
+
+TEST(SemaTest, InvalidSelectorsAreErrors) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(kSelectionIDL), Driver::ParserResult::kSuccess);
+  Sema sema;
+  sema.SetSelectors({"foo", "baz::*", "foo::Absent", "foo::Color"});
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  const auto& diagnostics = sema.GetDiagnostics();
+  ASSERT_EQ(diagnostics.size(), 3u);
+  ASSERT_EQ(diagnostics[0].location.begin.line, 0u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("error: Invalid selector 'foo'"), std::string::npos);
+  ASSERT_NE(errors.find("No namespace named baz"), std::string::npos);
+  ASSERT_NE(errors.find("named Absent in namespace foo"), std::string::npos);
+}
+
+TEST(SemaTest, CheckedItemsAreOnlyCheckedForCollisions) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      struct Foo {
+        Unknown* unknown;
+      }
+    }
+    namespace foo {
+      struct Foo {
+        int32_t a;
+      }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  auto namespaces = driver.GetNamespaces();
+  namespaces[0].MarkChecked();
+
+  Sema sema;
+  ASSERT_EQ(sema.Perform({namespaces[0]}), Sema::Result::kSuccess);
+  ASSERT_EQ(sema.Perform(namespaces), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 1u);
+  ASSERT_NE(sema.GetErrors().find("Foo"), std::string::npos);
+}
+
+static std::vector<size_t> GetOffsets(const StructLayout& layout) {
+  std::vector<size_t> offsets;
+  for (const auto& field : layout.fields) {
+    offsets.push_back(field.offset);
+  }
+  return offsets;
+}
+
+TEST(SemaTest, ComputesStructLayoutsForABIs) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      enum Color : uint64_t { Red }
+      struct Foo {
+        int8_t a;
+        double b;
+        int8_t* c;
+        Color d;
+        int16_t e;
+      }
+      struct Empty {}
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  sema.SetABIs({ABI::kX86_64, ABI::kAArch64, ABI::kARM32, ABI::kIA32});
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  const auto& structs = sema.GetNamespaces()[0].GetStructs();
+  ASSERT_EQ(structs.size(), 2u);
+  const auto& layouts = structs[0].GetLayouts();
+  ASSERT_EQ(layouts.size(), 4u);
+
+  for (const auto& layout : {layouts[0], layouts[1]}) {
+    ASSERT_EQ(GetOffsets(layout), (std::vector<size_t>{0, 8, 16, 24, 32}));
+    ASSERT_EQ(layout.size, 40u);
+    ASSERT_EQ(layout.alignment, 8u);
+    ASSERT_EQ(layout.fields[1].padding, 7u);
+    ASSERT_EQ(layout.tail_padding, 6u);
+  }
+
+  ASSERT_EQ(layouts[2].abi, ABI::kARM32);
+  ASSERT_EQ(GetOffsets(layouts[2]), (std::vector<size_t>{0, 8, 16, 24, 32}));
+  ASSERT_EQ(layouts[2].size, 40u);
+  ASSERT_EQ(layouts[2].fields[3].padding, 4u);
+
+  ASSERT_EQ(layouts[3].abi, ABI::kIA32);
+  ASSERT_EQ(GetOffsets(layouts[3]), (std::vector<size_t>{0, 4, 12, 16, 24}));
+  ASSERT_EQ(layouts[3].size, 28u);
+  ASSERT_EQ(layouts[3].alignment, 4u);
+  ASSERT_EQ(layouts[3].tail_padding, 2u);
+
+  for (const auto& layout : structs[1].GetLayouts()) {
+    ASSERT_EQ(layout.size, 1u);
+    ASSERT_EQ(layout.alignment, 1u);
+  }
+
+  const auto json = sema.GetNamespaces()[0].GetJSONObject();
+  const auto& json_layout = json.at("structs")[0]["layouts"][3];
+  ASSERT_EQ(json_layout["abi"], "ia32");
+  ASSERT_EQ(json_layout["fields"][1]["identifier"], "b");
+  ASSERT_EQ(json_layout["fields"][1]["offset"], 4u);
+}
+
+TEST(SemaTest, NoLayoutsAreComputedByDefault) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse("namespace foo { struct Foo { int8_t a; } }"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  ASSERT_TRUE(sema.GetNamespaces()[0].GetStructs()[0].GetLayouts().empty());
+}
+
+#if defined(__x86_64__) || defined(__aarch64__) || defined(__arm__) || \
+    (defined(__i386__) && !defined(_WIN32))
+TEST(SemaTest, LayoutsMatchTheHostCompiler) {
+#if defined(__x86_64__)
+  const auto abi = ABI::kX86_64;
+#elif defined(__aarch64__)
+  const auto abi = ABI::kAArch64;
+#elif defined(__arm__)
+  const auto abi = ABI::kARM32;
+#else
+  const auto abi = ABI::kIA32;
+#endif
+  struct Host {
+    int8_t a;
+    double b;
+    int8_t* c;
+    uint64_t d;
+    int16_t e;
+    float f;
+    int64_t g;
+  };
+  Struct strut("Host", {
+                           Variable(Primitive::kInt8, "a", false),
+                           Variable(Primitive::kDouble, "b", false),
+                           Variable(Primitive::kInt8, "c", true),
+                           Variable("Color", "d", false),
+                           Variable(Primitive::kInt16, "e", false),
+                           Variable(Primitive::kFloat, "f", false),
+                           Variable(Primitive::kInt64, "g", false),
+                       });
+  const auto layout = strut.ComputeLayout(abi);
+  ASSERT_EQ(layout.size, sizeof(Host));
+  ASSERT_EQ(layout.alignment, alignof(Host));
+  ASSERT_EQ(GetOffsets(layout),
+            (std::vector<size_t>{offsetof(Host, a), offsetof(Host, b),
+                                 offsetof(Host, c), offsetof(Host, d),
+                                 offsetof(Host, e), offsetof(Host, f),
+                                 offsetof(Host, g)}));
+}
+#endif
+
+TEST(SemaTest, ReordersFieldsToMinimizePadding) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(R"~(
+      namespace foo {
+        [[reorder]]
+        struct Foo {
+          int8_t a;
+          double b;
+          int16_t c;
+          int8_t* d;
+          int32_t e;
+        }
+        struct Bar {
+          int8_t a;
+          double b;
+        }
+      }
+    )~"),
+              Driver::ParserResult::kSuccess);
+    Sema sema;
+    sema.SetABIs({ABI::kX86_64, ABI::kAArch64, ABI::kARM32, ABI::kIA32});
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    const auto& structs = sema.GetNamespaces()[0].GetStructs();
+    ASSERT_EQ(structs[0].GetName(), "Foo");
+
+    std::vector<std::string> names;
+    for (const auto& variable : structs[0].GetVariables()) {
+      names.push_back(variable.GetIdentifier());
+    }
+    ASSERT_EQ(names, (std::vector<std::string>{"b", "d", "e", "c", "a"}));
+    ASSERT_EQ(structs[0].GetOriginalIndices(),
+              (std::vector<std::optional<size_t>>{1, 3, 4, 2, 0}));
+    for (const auto& layout : structs[0].GetLayouts()) {
+      size_t padding = 0u;
+      for (const auto& field : layout.fields) {
+        padding += field.padding;
+      }
+      ASSERT_EQ(padding, 0u) << GetABITraits(layout.abi).name;
+    }
+    ASSERT_EQ(structs[0].GetLayouts()[0].size, 24u);
+    ASSERT_EQ(structs[0].GetLayouts()[3].size, 20u);
+
+    // Structs without the attribute keep their order.
+    ASSERT_TRUE(structs[1].GetOriginalIndices().empty());
+    ASSERT_EQ(structs[1].GetVariables()[0].GetIdentifier(), "a");
+
+    const auto json = sema.GetNamespaces()[0].GetJSONObject();
+    const auto& foo = json.at("structs")[0];
+    ASSERT_EQ(foo["is_reordered"], true);
+    ASSERT_EQ(foo["variables"][0]["original_index"], 1u);
+    ASSERT_EQ(json.at("structs")[1]["is_reordered"], false);
+  }
+}
+
+TEST(SemaTest, UnknownAttributesAreErrors) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      [[reorder, reorder]]
+      struct Foo {
+        [[reorder]] int8_t a;
+      }
+      [[reorder]]
+      enum Bar { A }
+      [[unknown]]
+      function Baz()
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 4u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("Attribute 'reorder' specified more than once on "
+                        "struct Foo."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Unknown attribute 'reorder' on field a."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Unknown attribute 'reorder' on enum Bar."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Unknown attribute 'unknown' on function Baz."),
+            std::string::npos);
+}
+
+TEST(SemaTest, SplitsColdFieldsIntoTheirOwnStruct) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      enum Kind { A, B }
+      struct Particle {
+        float x;
+        [[cold]] double created_at;
+        float y;
+        [[cold]] Kind kind;
+      }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  sema.SetABIs({ABI::kX86_64});
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  const auto& structs = sema.GetNamespaces()[0].GetStructs();
+  ASSERT_EQ(structs.size(), 2u);
+
+  // The cold struct is declared first so that the accessors of the hot struct
+  // may use it.
+  const auto& cold = structs[0];
+  ASSERT_EQ(cold.GetName(), "ParticleCold");
+  ASSERT_EQ(cold.GetVariables().size(), 2u);
+  ASSERT_EQ(cold.GetVariables()[0].GetIdentifier(), "created_at");
+  ASSERT_FALSE(cold.GetVariables()[0].HasAttribute("cold"));
+  ASSERT_TRUE(cold.GetColdVariables().empty());
+
+  const auto& hot = structs[1];
+  std::vector<std::string> names;
+  for (const auto& variable : hot.GetVariables()) {
+    names.push_back(variable.GetIdentifier());
+  }
+  ASSERT_EQ(names, (std::vector<std::string>{"x", "y", "cold"}));
+  ASSERT_TRUE(hot.GetVariables()[2].IsPointer());
+  ASSERT_EQ(hot.GetVariables()[2].GetUserDefinedType(), "ParticleCold");
+  ASSERT_EQ(hot.GetColdVariables().size(), 2u);
+  ASSERT_EQ(hot.GetLayouts()[0].size, 16u);
+
+  const auto json = sema.GetNamespaces()[0].GetJSONObject();
+  const auto& cold_variables = json.at("structs")[1]["cold_variables"];
+  ASSERT_EQ(cold_variables.size(), 2u);
+  ASSERT_EQ(cold_variables[1]["identifier"], "kind");
+  ASSERT_EQ(cold_variables[1]["is_enum"], true);
+  ASSERT_TRUE(json.at("structs")[0]["cold_variables"].empty());
+}
+
+TEST(SemaTest, ReorderedStructsWithColdFieldsKeepDeclarationIndices) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      const uint32_t kN = 4;
+      enum Color { Red }
+      enum Opt { On }
+      [[reorder]]
+      struct S {
+        uint8_t a;
+        double b;
+        [[cold]] Color c;
+        [[cold]] float m[kN];
+        Opt o;
+      }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  const auto& structs = sema.GetNamespaces()[0].GetStructs();
+  ASSERT_EQ(structs[1].GetName(), "S");
+  ASSERT_TRUE(structs[1].IsReordered());
+  ASSERT_EQ(structs[1].GetColdOriginalIndices(),
+            (std::vector<size_t>{2, 3}));
+
+  const auto json = sema.GetNamespaces()[0].GetJSONObject();
+  const auto& strut = json.at("structs")[1];
+  ASSERT_EQ(strut["is_reordered"], true);
+  std::map<std::string, nlohmann::json> indices;
+  for (const auto& var : strut["variables"]) {
+    indices[var["identifier"]] = var.value("original_index", nlohmann::json{});
+  }
+  for (const auto& var : strut["cold_variables"]) {
+    indices[var["identifier"]] = var["original_index"];
+  }
+  ASSERT_EQ(indices.size(), 6u);
+  ASSERT_EQ(indices["a"], 0u);
+  ASSERT_EQ(indices["b"], 1u);
+  ASSERT_EQ(indices["c"], 2u);
+  ASSERT_EQ(indices["m"], 3u);
+  ASSERT_EQ(indices["o"], 4u);
+  // The pointer to the cold struct was not declared.
+  ASSERT_TRUE(indices["cold"].is_null());
+}
+
+TEST(SemaTest, ColdFieldsNeedFreeNames) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      struct Foo {
+        [[cold]] int32_t a;
+      }
+      struct FooCold {
+      }
+      struct Bar {
+        [[cold]] int32_t a;
+        int32_t cold;
+      }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 2u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("the name FooCold of the struct they are moved to is "
+                        "taken."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Struct Bar has cold fields but also a field named "
+                        "cold."),
+            std::string::npos);
+}
+
+TEST(SemaTest, EnumsUseTheSmallestUnderlyingType) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    std::string idl = "namespace foo { enum Small { A, B } enum Wide : int32_t "
+                      "{ A } enum Large { ";
+    for (size_t i = 0; i < 257u; i++) {
+      idl += "M" + std::to_string(i) + ", ";
+    }
+    idl += R"~(}
+      struct Foo {
+        Small small;
+        Large large;
+        Wide wide;
+      }
+      function Convert(Small small) -> Wide
+    })~";
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(idl), Driver::ParserResult::kSuccess);
+    Sema sema;
+    sema.SetABIs({ABI::kX86_64});
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    const auto& ns = sema.GetNamespaces()[0];
+    ASSERT_EQ(ns.GetEnums()[0].GetUnderlyingType(), Primitive::kUnsignedInt8);
+    ASSERT_EQ(ns.GetEnums()[1].GetUnderlyingType(), Primitive::kInt32);
+    ASSERT_EQ(ns.GetEnums()[2].GetUnderlyingType(),
+              Primitive::kUnsignedInt16);
+
+    const auto& layout = ns.GetStructs()[0].GetLayouts()[0];
+    ASSERT_EQ(layout.size, 8u);
+    ASSERT_EQ(layout.fields[1].offset, 2u);
+    ASSERT_EQ(layout.fields[2].offset, 4u);
+
+    const auto json = ns.GetJSONObject();
+    ASSERT_EQ(json.at("enums")[1]["underlying_type"]["c_type"], "int32_t");
+    const auto& variables = json.at("structs")[0]["variables"];
+    ASSERT_EQ(variables[0]["primitive"]["dart_ffi_type"], "Uint8");
+    ASSERT_EQ(variables[1]["primitive"]["c_type"], "uint16_t");
+    const auto& function = json.at("functions")[0];
+    ASSERT_EQ(function["return_primitive"]["c_type"], "int32_t");
+    ASSERT_EQ(function["arguments"][0]["primitive"]["c_type"], "uint8_t");
+  }
+}
+
+TEST(SemaTest, UnderlyingTypesMustHoldTheMembers) {
+  std::string idl =
+      "namespace foo { enum Foo : double { A } enum Bar : int8_t { A } "
+      "enum Qux : uint8_t { A = 256 } enum Baz : int8_t { ";
+  for (size_t i = 0; i < 129u; i++) {
+    idl += "M" + std::to_string(i) + " ";
+  }
+  idl += "} }";
+  Driver driver;
+  ASSERT_EQ(driver.Parse(idl), Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 3u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("The underlying type of enum Foo must be an integer "
+                        "type instead of double."),
+            std::string::npos);
+  ASSERT_NE(errors.find("The value 256 of member A of enum Qux does not fit "
+                        "in uint8_t."),
+            std::string::npos);
+  ASSERT_NE(errors.find("The value 128 of member M128 of enum Baz does not "
+                        "fit in int8_t."),
+            std::string::npos);
+}
+
+TEST(SemaTest, StructsMayHaveInlineArrays) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(R"~(
+      namespace foo {
+        struct Bar {}
+        struct Foo {
+          uint8_t tag;
+          float matrix[16];
+          Bar* bars[0x2];
+        }
+      }
+    )~"),
+              Driver::ParserResult::kSuccess);
+    Sema sema;
+    sema.SetABIs({ABI::kX86_64, ABI::kIA32});
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    const auto& strut = sema.GetNamespaces()[0].GetStructs()[1];
+    ASSERT_EQ(strut.GetVariables()[1].GetArrayLength(), 16u);
+    ASSERT_FALSE(strut.GetVariables()[0].GetArrayLength().has_value());
+
+    const auto& x86_64 = strut.GetLayouts()[0];
+    ASSERT_EQ(x86_64.fields[1].offset, 4u);
+    ASSERT_EQ(x86_64.fields[1].size, 64u);
+    ASSERT_EQ(x86_64.fields[1].alignment, 4u);
+    ASSERT_EQ(x86_64.fields[2].offset, 72u);
+    ASSERT_EQ(x86_64.fields[2].size, 16u);
+    ASSERT_EQ(x86_64.size, 88u);
+    ASSERT_EQ(strut.GetLayouts()[1].size, 76u);
+
+    const auto json =
+        strut.GetJSONObject(sema.GetNamespaces()[0]).at("variables");
+    ASSERT_EQ(json[0]["is_array"], false);
+    ASSERT_EQ(json[1]["is_array"], true);
+    ASSERT_EQ(json[1]["array_length"], 16u);
+    ASSERT_EQ(json[2]["array_length"], 2u);
+  }
+}
+
+TEST(SemaTest, ArraysMustHoldPrimitivesOrPointers) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      enum Kind { A }
+      struct Foo {
+        uint8_t empty[0];
+        Kind kinds[2];
+        double huge[300000000];
+        uint8_t bytes[4];
+      }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 3u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("Array 'empty' must have between 1 and 268435455 "
+                        "elements."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Array 'kinds' may not hold enums."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Array 'huge' must have between 1 and 268435455 "
+                        "elements."),
+            std::string::npos);
+}
+
+TEST(SemaTest, SlicesMustHoldValues) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      function A(void[] a, float[] b) -> double
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 1u);
+  ASSERT_NE(sema.GetErrors().find("Slice 'a' cannot hold void."),
+            std::string::npos);
+}
+
+TEST(SemaTest, StringsMayOnlyBePassedAndReturned) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      struct A {
+        string name;
+        string names[2];
+      }
+      function B(string a, string* b, string[] c) -> string
+      function C() -> string*
+      const string D = 1;
+      enum E : string { F }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 7u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("Field 'name' of struct A cannot be a string."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Field 'names' of struct A cannot be a string."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Variable 'b' cannot be a pointer to a string."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Slice 'c' cannot hold string."), std::string::npos);
+  ASSERT_NE(errors.find("Function C in namespace foo cannot return a pointer "
+                        "to a string."),
+            std::string::npos);
+  ASSERT_NE(errors.find("must be an integer type instead of string."),
+            std::string::npos);
+}
+
+TEST(SemaTest, StructsOfValuesMayBePassedByValue) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      enum Kind { A, B }
+      struct Point {
+        double x;
+        double y;
+        Kind kind;
+        uint8_t tags[4];
+      }
+      function Move(Point point, Point* other) -> Point
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  auto result = sema.Perform(driver.GetNamespaces());
+  sema.PrettyPrintErrors(std::cerr);
+  ASSERT_EQ(result, Sema::Result::kSuccess);
+}
+
+TEST(SemaTest, StructsPassedByValueMustOnlyHoldValues) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      struct Empty {
+      }
+      struct Node {
+        int32_t value;
+        Node* next;
+      }
+      struct Record {
+        int32_t id;
+        [[cold]]
+        double created;
+      }
+      struct Holder {
+        Record record;
+      }
+      function A(Empty a, Node b) -> Record
+      function B() -> Node
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 5u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("Struct Empty cannot be passed by value because it has "
+                        "no fields."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Struct Node cannot be passed by value because its "
+                        "field 'next' is a pointer."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Struct Node cannot be returned by value because its "
+                        "field 'next' is a pointer."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Struct Record cannot be returned by value because "
+                        "its field 'created' is cold."),
+            std::string::npos);
+  ASSERT_NE(errors.find("struct fields may not hold structs by value."),
+            std::string::npos);
+}
+
+TEST(SemaTest, BatchFunctionsTakeAndReturnNumbers) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      enum Kind { A, B }
+      [[batch]]
+      function Scale(double value, float factor, uint8_t shift) -> int64_t
+      [[batch]]
+      function A(int32_t* a, float[] b, string c, Kind d) -> double
+      [[batch]]
+      function B(double count, double out)
+      [[batch]]
+      function C(double a) -> double*
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 8u);
+  const auto errors = sema.GetErrors();
+  ASSERT_EQ(errors.find("function Scale"), std::string::npos);
+  for (const auto& arg : {"a", "b", "c", "d"}) {
+    ASSERT_NE(errors.find("Argument '" + std::string(arg) +
+                          "' of batch function A must be a number passed by "
+                          "value."),
+              std::string::npos);
+  }
+  ASSERT_NE(errors.find("Batch function B cannot have an argument named "
+                        "count."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Batch function B cannot have an argument named out."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Batch function B must return a number by value."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Batch function C must return a number by value."),
+            std::string::npos);
+}
+
+TEST(SemaTest, AsyncFunctionsTakeAndReturnNumbers) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      struct Point { double x; }
+      async function Count(uint32_t limit, double scale) -> uint64_t
+      async function Wait(int32_t milliseconds)
+      async function A(int32_t* a, float[] b, string c, Point d) -> float
+      async function B() -> string
+      async function C() -> Point
+      async function D() -> uint8_t*
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 7u);
+  const auto errors = sema.GetErrors();
+  ASSERT_EQ(errors.find("function Count"), std::string::npos);
+  ASSERT_EQ(errors.find("function Wait"), std::string::npos);
+  for (const auto& arg : {"a", "b", "c", "d"}) {
+    ASSERT_NE(errors.find("Argument '" + std::string(arg) +
+                          "' of async function A must be a number passed by "
+                          "value."),
+              std::string::npos);
+  }
+  for (const auto& function : {"B", "C", "D"}) {
+    ASSERT_NE(errors.find("Async function " + std::string(function) +
+                          " must return a number by value or nothing."),
+              std::string::npos);
+  }
+}
+
+TEST(SemaTest, EnumMembersMayHaveValues) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(R"~(
+      namespace foo {
+        enum Code { A = 4, B, C = 0x1000 }
+        [[flags]]
+        enum Options { Bold, Italic = 8, Underline, }
+        [[flags]]
+        enum Wide : uint64_t { High = 0x8000000000000000 }
+      }
+    )~"),
+              Driver::ParserResult::kSuccess);
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    const auto& enums = sema.GetNamespaces()[0].GetEnums();
+    ASSERT_EQ(enums[0].GetMemberValues(),
+              (std::vector<uint64_t>{4u, 5u, 0x1000u}));
+    ASSERT_EQ(enums[0].GetUnderlyingType(), Primitive::kUnsignedInt16);
+    ASSERT_FALSE(enums[0].IsFlags());
+    ASSERT_EQ(enums[1].GetMemberValues(),
+              (std::vector<uint64_t>{1u, 8u, 16u}));
+    ASSERT_EQ(enums[1].GetUnderlyingType(), Primitive::kUnsignedInt8);
+    ASSERT_TRUE(enums[1].IsFlags());
+    ASSERT_EQ(enums[2].GetMemberValues(),
+              (std::vector<uint64_t>{0x8000000000000000u}));
+
+    const auto json = enums[1].GetJSONObject();
+    ASSERT_EQ(json.at("is_flags"), true);
+    ASSERT_EQ(json.at("members")[2]["name"], "Underline");
+    ASSERT_EQ(json.at("members")[2]["value"], 16u);
+  }
+}
+
+TEST(SemaTest, FlagsAreSingleBitsWithUniqueValues) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      [[flags]]
+      enum Options { Bold, Italic = 6 }
+      enum Code { A = 1, B = 0, C }
+      [[flags]]
+      enum Wide { High = 0x8000000000000000, Higher }
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 3u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("Member Italic of flags enum Options must be a single "
+                        "bit instead of 6."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Members A and C of enum Code have the same value 1."),
+            std::string::npos);
+  ASSERT_NE(errors.find("The value of member Higher of enum Wide does not fit "
+                        "in uint64_t."),
+            std::string::npos);
+}
+
+TEST(SemaTest, EnumMemberErrorsAreReportedAtTheMember) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(R"~(namespace foo {
+  enum Code : uint8_t {
+    A = 1,
+    B = 300,
+    C = 1,
+    A,
+  }
+})~"),
+              Driver::ParserResult::kSuccess);
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+    const auto& diagnostics = sema.GetDiagnostics();
+    ASSERT_EQ(diagnostics.size(), 3u);
+    ASSERT_NE(diagnostics[0].message.find("The value 300 of member B"),
+              std::string::npos);
+    ASSERT_EQ(diagnostics[0].location.begin.line, 4u);
+    ASSERT_NE(diagnostics[1].message.find("Members A and C"),
+              std::string::npos);
+    ASSERT_EQ(diagnostics[1].location.begin.line, 5u);
+    ASSERT_EQ(diagnostics[2].message, "Enum Code has duplicate member A");
+    ASSERT_EQ(diagnostics[2].location.begin.line, 6u);
+    for (const auto& diagnostic : diagnostics) {
+      ASSERT_EQ(diagnostic.location.begin.column, 5u);
+    }
+  }
+}
+
+TEST(SemaTest, ConstantsAreEvaluated) {
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(R"~(
+      namespace foo {
+        const uint32_t kLights = kBase * 2 + 1 << 1;
+        const uint8_t kBase = (3 - 1) * 4 % 5;
+        const int64_t kMask = 0xF0 & 0x3C | 1 >> 1;
+        enum Channel { Red = kBase, Green = kBase + 1 }
+        struct Scene {
+          float intensities[kLights];
+          float colors[kLights * 4 / 2];
+        }
+      }
+    )~"),
+              Driver::ParserResult::kSuccess);
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+    const auto& ns = sema.GetNamespaces()[0];
+    ASSERT_EQ(ns.GetConstants().size(), 3u);
+    ASSERT_EQ(ns.GetConstants()[0].GetValue(), 14u);
+    ASSERT_EQ(ns.GetConstants()[1].GetValue(), 3u);
+    ASSERT_EQ(ns.GetConstants()[2].GetValue(), 0x30u);
+    ASSERT_EQ(ns.GetEnums()[0].GetMemberValues(),
+              (std::vector<uint64_t>{3u, 4u}));
+    ASSERT_EQ(ns.GetStructs()[0].GetVariables()[0].GetArrayLength(), 14u);
+    ASSERT_EQ(ns.GetStructs()[0].GetVariables()[1].GetArrayLength(), 28u);
+
+    const auto json = ns.GetJSONObject().at("constants");
+    ASSERT_EQ(json[0]["name"], "kLights");
+    ASSERT_EQ(json[0]["value"], 14u);
+    ASSERT_EQ(json[1]["type"]["c_type"], "uint8_t");
+  }
+}
+
+TEST(SemaTest, ConstantsMustBeWellDefined) {
+  std::vector<std::string> errors_by_parser;
+  for (auto type : {Driver::ParserType::kBison, Driver::ParserType::kDescent}) {
+    Driver driver;
+    driver.SetParserType(type);
+    ASSERT_EQ(driver.Parse(R"~(
+      namespace foo {
+        const uint32_t A = B + 1;
+        const uint32_t B = A;
+        const uint32_t C = Missing;
+        const uint32_t D = (1) - 2;
+        const uint32_t E = 1 / (2 - 2);
+        const uint64_t F = 0xFFFFFFFFFFFFFFFF + 1;
+        const uint64_t G = 1 << 64;
+        const uint64_t H = 3 << 63;
+        const uint32_t I = C + 1;
+        struct J { float m[K]; }
+        enum L { M = N }
+      }
+    )~"),
+              Driver::ParserResult::kSuccess);
+    Sema sema;
+    ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+    ASSERT_EQ(sema.GetDiagnostics().size(), 9u);
+    const auto errors = sema.GetErrors();
+    ASSERT_NE(errors.find("Constant A depends on its own value."),
+              std::string::npos);
+    ASSERT_NE(errors.find("No constant named Missing in namespace foo."),
+              std::string::npos);
+    ASSERT_NE(errors.find("The expression is negative."), std::string::npos);
+    ASSERT_NE(errors.find("The expression divides by zero."),
+              std::string::npos);
+    ASSERT_NE(errors.find("The expression does not fit in uint64_t."),
+              std::string::npos);
+    ASSERT_NE(errors.find("The expression shifts by 64 bits or more."),
+              std::string::npos);
+    ASSERT_NE(errors.find("No constant named K in namespace foo."),
+              std::string::npos);
+    ASSERT_NE(errors.find("No constant named N in namespace foo."),
+              std::string::npos);
+    errors_by_parser.push_back(errors);
+  }
+  // Both parsers give expressions the same locations.
+  ASSERT_EQ(errors_by_parser[0], errors_by_parser[1]);
+}
+
+TEST(SemaTest, OtherErrorsAreReportedWithConstantErrors) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      const uint32_t kBad = kMissing + 1;
+      struct S {
+        Nope field;
+        float values[kBad];
+      }
+      enum E { A = kBad, B, C = 1, D = 1 }
+      function F(Unknown value) -> void
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("No constant named kMissing in namespace foo."),
+            std::string::npos);
+  ASSERT_NE(errors.find("No enum named Nope in namespace foo."),
+            std::string::npos);
+  ASSERT_NE(errors.find("No enum named Unknown in namespace foo."),
+            std::string::npos);
+  // Enum values that follow a known value are still checked.
+  ASSERT_NE(errors.find("Members C and D of enum E have the same value 1."),
+            std::string::npos);
+  // Nothing is reported about the values that depend on the constant.
+  ASSERT_EQ(sema.GetDiagnostics().size(), 4u) << errors;
+}
+
+TEST(SemaTest, ConstantsMustFitTheirTypes) {
+  Driver driver;
+  ASSERT_EQ(driver.Parse(R"~(
+    namespace foo {
+      const uint8_t A = 255 + 1;
+      const int8_t B = 128;
+      const float C = 1;
+      const int16_t D = 1;
+      struct D {}
+    }
+  )~"),
+            Driver::ParserResult::kSuccess);
+  Sema sema;
+  ASSERT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kError);
+  ASSERT_EQ(sema.GetDiagnostics().size(), 4u);
+  const auto errors = sema.GetErrors();
+  ASSERT_NE(errors.find("The value 256 of constant A does not fit in "
+                        "uint8_t."),
+            std::string::npos);
+  ASSERT_NE(errors.find("The value 128 of constant B does not fit in int8_t."),
+            std::string::npos);
+  ASSERT_NE(errors.find("The type of constant C must be an integer type "
+                        "instead of float."),
+            std::string::npos);
+  ASSERT_NE(errors.find("Struct, enum or constant named D declared more than "
+                        "once."),
+            std::string::npos);
+}
+
 }  // namespace testing
 }  // namespace epoxy
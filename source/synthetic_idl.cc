@@ -0,0 +1,97 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "synthetic_idl.h"
+
+#include <sstream>
+
+namespace epoxy {
+
+static constexpr const char* kPrimitives[] = {
+    "int8_t",  "int16_t",  "int32_t",  "int64_t", "uint8_t",
+    "uint16_t", "uint32_t", "uint64_t", "double",  "float",
+};
+
+static constexpr size_t kPrimitivesCount =
+    sizeof(kPrimitives) / sizeof(kPrimitives[0]);
+
+// Picks the type of the n-th field or argument. Cycles between primitives,
+// pointers to primitives, enums and pointers to structs when available.
+static void WriteType(std::ostream& stream,
+                      const SyntheticIDLOptions& options,
+                      size_t item,
+                      size_t n) {
+  const auto primitive = kPrimitives[(item + n) % kPrimitivesCount];
+  switch (n % 4u) {
+    case 0u:
+      stream << primitive;
+      return;
+    case 1u:
+      stream << primitive << "*";
+      return;
+    case 2u:
+      if (options.enums_per_namespace > 0u) {
+        stream << "Enum" << (item % options.enums_per_namespace);
+        return;
+      }
+      break;
+    case 3u:
+      if (options.structs_per_namespace > 0u) {
+        stream << "Struct" << (item % options.structs_per_namespace) << "*";
+        return;
+      }
+      break;
+  }
+  stream << primitive;
+}
+
+std::string GenerateSyntheticIDL(const SyntheticIDLOptions& options) {
+  std::stringstream stream;
+  for (size_t ns = 0; ns < options.namespaces; ns++) {
+    if (options.comments) {
+      stream << "// Generated namespace number " << ns << "." << std::endl;
+    }
+    stream << "namespace ns" << ns << " {" << std::endl << std::endl;
+
+    for (size_t i = 0; i < options.enums_per_namespace; i++) {
+      stream << "enum Enum" << i << " {" << std::endl;
+      for (size_t m = 0; m < options.members_per_enum; m++) {
+        stream << "  Member" << m << "," << std::endl;
+      }
+      stream << "}" << std::endl << std::endl;
+    }
+
+    for (size_t i = 0; i < options.structs_per_namespace; i++) {
+      if (options.comments) {
+        stream << "// A struct with " << options.fields_per_struct
+               << " fields." << std::endl;
+      }
+      stream << "struct Struct" << i << " {" << std::endl;
+      for (size_t f = 0; f < options.fields_per_struct; f++) {
+        stream << "  ";
+        WriteType(stream, options, i, f);
+        stream << " field" << f << ";" << std::endl;
+      }
+      stream << "}" << std::endl << std::endl;
+    }
+
+    for (size_t i = 0; i < options.functions_per_namespace; i++) {
+      stream << "function Function" << i << "(";
+      for (size_t a = 0; a < options.arguments_per_function; a++) {
+        if (a != 0u) {
+          stream << ", ";
+        }
+        WriteType(stream, options, i, a);
+        stream << " argument" << a;
+      }
+      stream << ") -> ";
+      WriteType(stream, options, i, i % 2u == 0u ? 0u : 3u);
+      stream << std::endl;
+    }
+
+    stream << std::endl << "} // namespace ns" << ns << std::endl << std::endl;
+  }
+  return stream.str();
+}
+
+}  // namespace epoxy
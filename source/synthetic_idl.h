@@ -0,0 +1,27 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <string>
+
+namespace epoxy {
+
+// Describes the shape of a generated IDL. Used by benchmarks and tests that
+// need large inputs.
+struct SyntheticIDLOptions {
+  size_t namespaces = 1u;
+  size_t enums_per_namespace = 0u;
+  size_t structs_per_namespace = 0u;
+  size_t functions_per_namespace = 0u;
+  size_t members_per_enum = 4u;
+  size_t fields_per_struct = 4u;
+  size_t arguments_per_function = 2u;
+  bool comments = true;
+};
+
+// The generated IDL passes Sema. Functions and struct fields refer to the
+// enums and structs in the same namespace.
+std::string GenerateSyntheticIDL(const SyntheticIDLOptions& options);
+
+}  // namespace epoxy
@@ -0,0 +1,194 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include "template_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "file.h"
+
+namespace epoxy {
+
+TemplateProfiler::TemplateProfiler(std::string template_name)
+    : template_name_(std::move(template_name)), frames_(1u) {}
+
+TemplateProfiler::~TemplateProfiler() = default;
+
+void TemplateProfiler::OnInstruction(size_t index,
+                                     uint32_t line,
+                                     size_t loop_depth) {
+  if (running_) {
+    const auto elapsed = Clock::now() - start_time_;
+    lines_[line_].time += elapsed;
+    frames_[frame_].self_time += elapsed - callback_time_;
+  }
+  callback_time_ = Duration::zero();
+
+  if (line == 0u) {
+    running_ = false;
+    loop_frames_.clear();
+    return;
+  }
+
+  // Loops are entered by the instruction just executed.
+  if (loop_depth > loop_frames_.size()) {
+    loop_frames_.push_back(frame_);
+  }
+  while (loop_depth < loop_frames_.size()) {
+    loop_frames_.pop_back();
+  }
+
+  auto& stats = lines_[line];
+  stats.line = line;
+  // Jumping back to the start of a loop re-enters a line even if the loop is
+  // on a single line.
+  if (!running_ || line != line_ || index <= index_) {
+    stats.hits++;
+  }
+
+  frame_ = GetChildFrame(loop_frames_.empty() ? 0u : loop_frames_.back(),
+                         line);
+  index_ = index;
+  line_ = line;
+  running_ = true;
+  // Read the clock last so that the bookkeeping above is not attributed to the
+  // instruction.
+  start_time_ = Clock::now();
+}
+
+void TemplateProfiler::OnCallback(const std::string& name, Duration time) {
+  auto found = callback_ids_.find(name);
+  if (found == callback_ids_.end()) {
+    found = callback_ids_.emplace(name, callbacks_.size()).first;
+    callbacks_.push_back({name, 0u, Duration::zero()});
+  }
+  auto& stats = callbacks_[found->second];
+  stats.hits++;
+  stats.time += time;
+  callback_time_ += time;
+  const auto key = -static_cast<int64_t>(found->second) - 1;
+  frames_[GetChildFrame(frame_, key)].self_time += time;
+}
+
+size_t TemplateProfiler::GetChildFrame(size_t parent, int64_t key) {
+  auto found = frames_[parent].children.find(key);
+  if (found != frames_[parent].children.end()) {
+    return found->second;
+  }
+  const auto child = frames_.size();
+  frames_[parent].children[key] = child;
+  Frame frame;
+  frame.key = key;
+  frame.parent = parent;
+  frames_.emplace_back(std::move(frame));
+  return child;
+}
+
+std::vector<TemplateProfiler::LineStats> TemplateProfiler::GetLineStats()
+    const {
+  std::vector<LineStats> stats;
+  for (const auto& line : lines_) {
+    stats.push_back(line.second);
+  }
+  std::stable_sort(
+      stats.begin(), stats.end(),
+      [](const auto& a, const auto& b) { return a.time > b.time; });
+  return stats;
+}
+
+std::vector<TemplateProfiler::CallbackStats>
+TemplateProfiler::GetCallbackStats() const {
+  auto stats = callbacks_;
+  std::stable_sort(
+      stats.begin(), stats.end(),
+      [](const auto& a, const auto& b) { return a.time > b.time; });
+  return stats;
+}
+
+static double ToMilliseconds(TemplateProfiler::Duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static double GetPercentage(TemplateProfiler::Duration duration,
+                            TemplateProfiler::Duration total) {
+  return total.count() == 0 ? 0.0 : 100.0 * duration.count() / total.count();
+}
+
+void TemplateProfiler::PrintReport(std::ostream& stream,
+                                   const std::string& template_source) const {
+  const LineIndex line_index(template_source);
+  const auto line_stats = GetLineStats();
+  auto total = Duration::zero();
+  for (const auto& line : line_stats) {
+    total += line.time;
+  }
+
+  stream << "Template profile for " << template_name_ << " (" << std::fixed
+         << std::setprecision(3) << ToMilliseconds(total) << " ms)"
+         << std::endl
+         << std::endl;
+  stream << std::left << std::setw(8) << "Line" << std::right << std::setw(12)
+         << "Hits" << std::setw(14) << "Time (ms)" << std::setw(9) << "%"
+         << "  Source" << std::endl;
+  for (const auto& line : line_stats) {
+    std::string source(line_index.GetLine(line.line).value_or(""));
+    source.erase(0u, source.find_first_not_of(" \t"));
+    if (source.size() > 60u) {
+      source = source.substr(0u, 57u) + "...";
+    }
+    stream << std::left << std::setw(8) << line.line << std::right
+           << std::setw(12) << line.hits << std::setw(14)
+           << std::setprecision(3) << ToMilliseconds(line.time) << std::setw(8)
+           << std::setprecision(1) << GetPercentage(line.time, total) << "%"
+           << "  " << source << std::endl;
+  }
+
+  const auto callback_stats = GetCallbackStats();
+  if (callback_stats.empty()) {
+    return;
+  }
+  stream << std::endl
+         << std::left << std::setw(20) << "Callback" << std::right
+         << std::setw(12) << "Hits" << std::setw(14) << "Time (ms)"
+         << std::setw(9) << "%" << std::endl;
+  for (const auto& callback : callback_stats) {
+    stream << std::left << std::setw(20) << callback.name << std::right
+           << std::setw(12) << callback.hits << std::setw(14)
+           << std::setprecision(3) << ToMilliseconds(callback.time)
+           << std::setw(8) << std::setprecision(1)
+           << GetPercentage(callback.time, total) << "%" << std::endl;
+  }
+}
+
+// Semicolons separate frames in the folded format.
+static std::string GetFoldedName(std::string name) {
+  std::replace(name.begin(), name.end(), ';', '_');
+  return name;
+}
+
+std::string TemplateProfiler::GetFrameName(const Frame& frame) const {
+  if (frame.key < 0) {
+    return GetFoldedName(callbacks_[-(frame.key + 1)].name) + "()";
+  }
+  return GetFoldedName(template_name_) + ":" + std::to_string(frame.key);
+}
+
+void TemplateProfiler::WriteFoldedStacks(std::ostream& stream) const {
+  // Children are always created after their parents. So the names of all
+  // stacks can be built in a single pass.
+  std::vector<std::string> stacks(frames_.size());
+  stacks[0] = GetFoldedName(template_name_);
+  for (size_t i = 1; i < frames_.size(); i++) {
+    const auto& frame = frames_[i];
+    stacks[i] = stacks[frame.parent] + ";" + GetFrameName(frame);
+    const auto nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(frame.self_time)
+            .count();
+    if (nanoseconds > 0) {
+      stream << stacks[i] << " " << nanoseconds << std::endl;
+    }
+  }
+}
+
+}  // namespace epoxy
@@ -0,0 +1,102 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "macros.h"
+
+namespace epoxy {
+
+// Collects the time spent on each line of a template and in each callback
+// while the template is rendered. Pass one to |CodeGen::Render|. The time of a
+// line is the time spent executing the template constructs on that line
+// (including the callbacks they invoke) but not the time spent in the bodies
+// of the loops that start on that line.
+class TemplateProfiler {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  struct LineStats {
+    uint32_t line = 0;
+    // The number of times rendering entered the line.
+    size_t hits = 0;
+    Duration time = Duration::zero();
+  };
+
+  struct CallbackStats {
+    std::string name;
+    size_t hits = 0;
+    Duration time = Duration::zero();
+  };
+
+  explicit TemplateProfiler(std::string template_name);
+
+  ~TemplateProfiler();
+
+  // Called by the renderer before each bytecode is executed. |line| is zero
+  // when rendering is done.
+  void OnInstruction(size_t index, uint32_t line, size_t loop_depth);
+
+  // Called by the renderer after a callback has been invoked by the current
+  // instruction.
+  void OnCallback(const std::string& name, Duration time);
+
+  // Sorted by time with the most expensive line first.
+  std::vector<LineStats> GetLineStats() const;
+
+  // Sorted by time with the most expensive callback first.
+  std::vector<CallbackStats> GetCallbackStats() const;
+
+  // Prints tables of the lines and callbacks sorted by time. The template
+  // source is used to show the contents of each line.
+  void PrintReport(std::ostream& stream,
+                   const std::string& template_source) const;
+
+  // Writes one line per stack in the folded format understood by flamegraph
+  // tools. Frames are template lines, the loops they are nested in, and
+  // callbacks. Values are in nanoseconds.
+  void WriteFoldedStacks(std::ostream& stream) const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Positive keys are template lines. Negative keys are callbacks.
+  struct Frame {
+    int64_t key = 0;
+    size_t parent = 0;
+    std::map<int64_t, size_t> children;
+    Duration self_time = Duration::zero();
+  };
+
+  const std::string template_name_;
+  std::map<uint32_t, LineStats> lines_;
+  std::vector<CallbackStats> callbacks_;
+  std::map<std::string, size_t> callback_ids_;
+  // The first frame is the root.
+  std::vector<Frame> frames_;
+  // The frames of the lines that started the loops being iterated over.
+  std::vector<size_t> loop_frames_;
+
+  // The state of the instruction being executed.
+  bool running_ = false;
+  Clock::time_point start_time_;
+  size_t index_ = 0;
+  uint32_t line_ = 0;
+  size_t frame_ = 0;
+  Duration callback_time_ = Duration::zero();
+
+  size_t GetChildFrame(size_t parent, int64_t key);
+
+  std::string GetFrameName(const Frame& frame) const;
+
+  EPOXY_DISALLOW_COPY_AND_ASSIGN(TemplateProfiler);
+};
+
+}  // namespace epoxy
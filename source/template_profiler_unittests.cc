@@ -0,0 +1,93 @@
+// This source file is part of Epoxy licensed under the MIT License.
+// See LICENSE.md file for details.
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "code_gen.h"
+#include "driver.h"
+#include "sema.h"
+#include "template_profiler.h"
+
+namespace epoxy {
+namespace testing {
+
+static constexpr const char* kTemplate =
+    R"~({% for namespace in namespaces %}
+{% for function in namespace.functions %}
+{{ function.name }} {{ dart_type(function.return_type) }}
+{% endfor %}
+{% endfor %}
+)~";
+
+static std::vector<Namespace> GetNamespaces() {
+  Driver driver;
+  auto driver_result = driver.Parse(R"~(
+    namespace foo {
+      function one() -> int32_t
+      function two() -> void*
+    }
+    namespace bar {
+      function three() -> double
+    }
+  )~");
+  EXPECT_EQ(driver_result, Driver::ParserResult::kSuccess);
+  Sema sema;
+  EXPECT_EQ(sema.Perform(driver.GetNamespaces()), Sema::Result::kSuccess);
+  return sema.GetNamespaces();
+}
+
+TEST(TemplateProfilerTest, CountsLineAndCallbackHits) {
+  TemplateProfiler profiler("test.epoxy");
+  CodeGen code_gen(kTemplate);
+  auto result = code_gen.Render(GetNamespaces(), &profiler);
+  ASSERT_TRUE(result.result.has_value());
+
+  size_t line_hits[4] = {};
+  for (const auto& line : profiler.GetLineStats()) {
+    ASSERT_GT(line.line, 0u);
+    if (line.line < 4u) {
+      line_hits[line.line] = line.hits;
+    }
+  }
+  ASSERT_EQ(line_hits[1], 1u);
+  ASSERT_EQ(line_hits[2], 2u);
+  ASSERT_EQ(line_hits[3], 3u);
+
+  const auto callbacks = profiler.GetCallbackStats();
+  ASSERT_EQ(callbacks.size(), 1u);
+  ASSERT_EQ(callbacks[0].name, "dart_type");
+  ASSERT_EQ(callbacks[0].hits, 3u);
+}
+
+TEST(TemplateProfilerTest, CanWriteReports) {
+  TemplateProfiler profiler("test.epoxy");
+  CodeGen code_gen(kTemplate);
+  ASSERT_TRUE(code_gen.Render(GetNamespaces(), &profiler).result.has_value());
+
+  std::stringstream folded;
+  profiler.WriteFoldedStacks(folded);
+  ASSERT_NE(folded.str().find("test.epoxy;test.epoxy:1;test.epoxy:2;"
+                              "test.epoxy:3;dart_type() "),
+            std::string::npos);
+
+  std::stringstream report;
+  profiler.PrintReport(report, kTemplate);
+  ASSERT_NE(report.str().find("dart_type"), std::string::npos);
+  ASSERT_NE(report.str().find("{{ function.name }}"), std::string::npos);
+}
+
+TEST(TemplateProfilerTest, RenderingIsUnchanged) {
+  const auto namespaces = GetNamespaces();
+  TemplateProfiler profiler("test.epoxy");
+  CodeGen code_gen(kTemplate);
+  auto profiled = code_gen.Render(namespaces, &profiler);
+  auto unprofiled = code_gen.Render(namespaces);
+  ASSERT_TRUE(profiled.result.has_value());
+  ASSERT_EQ(profiled.result, unprofiled.result);
+}
+
+}  // namespace testing
+}  // namespace epoxy
@@ -4,12 +4,277 @@
 #include "types.h"
 
 #include <algorithm>
-#include <iterator>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <map>
-#include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace epoxy {
 
+// Indexed by the value of the primitive.
+static constexpr PrimitiveTraits kPrimitiveTraits[] = {
+    {"void", "void", "Void", "void", "", 0u, 1u},
+    {"int8_t", "int8_t", "Int8", "int", "Int8List", sizeof(int8_t),
+     alignof(int8_t)},
+    {"int16_t", "int16_t", "Int16", "int", "Int16List", sizeof(int16_t),
+     alignof(int16_t)},
+    {"int32_t", "int32_t", "Int32", "int", "Int32List", sizeof(int32_t),
+     alignof(int32_t)},
+    {"int64_t", "int64_t", "Int64", "int", "Int64List", sizeof(int64_t),
+     alignof(int64_t)},
+    {"uint8_t", "uint8_t", "Uint8", "int", "Uint8List", sizeof(uint8_t),
+     alignof(uint8_t)},
+    {"uint16_t", "uint16_t", "Uint16", "int", "Uint16List", sizeof(uint16_t),
+     alignof(uint16_t)},
+    {"uint32_t", "uint32_t", "Uint32", "int", "Uint32List", sizeof(uint32_t),
+     alignof(uint32_t)},
+    {"uint64_t", "uint64_t", "Uint64", "int", "Uint64List", sizeof(uint64_t),
+     alignof(uint64_t)},
+    {"double", "double", "Double", "double", "Float64List", sizeof(double),
+     alignof(double)},
+    {"float", "float", "Float", "double", "Float32List", sizeof(float),
+     alignof(float)},
+    // Strings are passed as a pointer to the first byte and the number of
+    // bytes. They are never laid out in structs.
+    {"string", "std::string_view", "Uint8", "String", "", 0u, 1u},
+};
+
+static_assert(sizeof(kPrimitiveTraits) / sizeof(kPrimitiveTraits[0]) ==
+                  static_cast<size_t>(Primitive::kString) + 1u,
+              "Each primitive must have traits.");
+
+const PrimitiveTraits& GetPrimitiveTraits(Primitive primitive) {
+  return kPrimitiveTraits[static_cast<size_t>(primitive)];
+}
+
+std::optional<Primitive> GetPrimitiveNamed(const std::string& type) {
+  static const auto primitives = [] {
+    std::unordered_map<std::string, Primitive> primitives;
+    for (size_t i = 0; i <= static_cast<size_t>(Primitive::kString); i++) {
+      primitives.emplace(kPrimitiveTraits[i].type, static_cast<Primitive>(i));
+    }
+    return primitives;
+  }();
+  auto found = primitives.find(type);
+  if (found == primitives.end()) {
+    return std::nullopt;
+  }
+  return found->second;
+}
+
+bool IsIntegerPrimitive(Primitive primitive) {
+  return primitive >= Primitive::kInt8 &&
+         primitive <= Primitive::kUnsignedInt64;
+}
+
+// The largest value of an integer primitive.
+static uint64_t GetMaxValue(Primitive primitive) {
+  const auto bits = GetPrimitiveTraits(primitive).size * 8u;
+  const auto is_signed = primitive <= Primitive::kInt64;
+  return std::numeric_limits<uint64_t>::max() >> (64u - bits + is_signed);
+}
+
+// Dart integers are 64 bit and signed. So values that don't fit are written as
+// the negative number with the same bits, which is also what Dart reads from a
+// native uint64_t.
+static int64_t GetDartValue(uint64_t value) {
+  return static_cast<int64_t>(value);
+}
+
+// Indexed by the value of the ABI.
+static constexpr ABITraits kABITraits[] = {
+    {"x86_64", "defined(__x86_64__) || defined(_M_X64)", 8u, 8u},
+    {"aarch64", "defined(__aarch64__) || defined(_M_ARM64)", 8u, 8u},
+    {"arm32", "defined(__arm__) || defined(_M_ARM)", 4u, 8u},
+    // Unlike the System V ABI, MSVC aligns 64-bit fields to 8 bytes on x86.
+    {"ia32", "defined(__i386__) && !defined(_WIN32)", 4u, 4u},
+};
+
+static_assert(sizeof(kABITraits) / sizeof(kABITraits[0]) ==
+                  static_cast<size_t>(ABI::kIA32) + 1u,
+              "Each ABI must have traits.");
+
+const ABITraits& GetABITraits(ABI abi) {
+  return kABITraits[static_cast<size_t>(abi)];
+}
+
+std::optional<ABI> GetABINamed(const std::string& name) {
+  for (size_t i = 0; i <= static_cast<size_t>(ABI::kIA32); i++) {
+    if (name == kABITraits[i].name) {
+      return static_cast<ABI>(i);
+    }
+  }
+  return std::nullopt;
+}
+
+static size_t AlignTo(size_t value, size_t alignment) {
+  return (value + alignment - 1u) / alignment * alignment;
+}
+
+const std::vector<std::string>& Attributed::GetAttributes() const {
+  return attributes_;
+}
+
+void Attributed::SetAttributes(std::vector<std::string> attributes) {
+  attributes_ = std::move(attributes);
+}
+
+bool Attributed::HasAttribute(const std::string& attribute) const {
+  return std::find(attributes_.begin(), attributes_.end(), attribute) !=
+         attributes_.end();
+}
+
+bool Attributed::CheckAttributes(std::initializer_list<const char*> known,
+                                 const char* kind,
+                                 const std::string& name,
+                                 const location& location,
+                                 std::vector<Diagnostic>& diagnostics) const {
+  bool passes = true;
+  const auto description = [&] { return std::string{kind} + " " + name; };
+  for (size_t i = 0; i < attributes_.size(); i++) {
+    const auto& attribute = attributes_[i];
+    if (std::find(known.begin(), known.end(), attribute) == known.end()) {
+      diagnostics.push_back({location, "Unknown attribute '" + attribute +
+                                           "' on " + description() + "."});
+      passes = false;
+    } else if (std::find(attributes_.begin(), attributes_.begin() + i,
+                         attribute) != attributes_.begin() + i) {
+      diagnostics.push_back({location, "Attribute '" + attribute +
+                                           "' specified more than once on " +
+                                           description() + "."});
+      passes = false;
+    }
+  }
+  return passes;
+}
+
+// Numbers have no node.
+struct Expression::Node {
+  std::string constant;
+  Operator op = Operator::kAdd;
+  // Both operands of binary expressions. Empty for references to constants.
+  std::vector<Expression> operands;
+  class location location;
+};
+
+Expression::Expression() = default;
+
+Expression::Expression(uint64_t number) : value_(number) {}
+
+Expression::Expression(std::string constant, const class location& location) {
+  auto node = std::make_shared<Node>();
+  node->constant = std::move(constant);
+  node->location = location;
+  node_ = std::move(node);
+}
+
+Expression::Expression(Operator op,
+                       Expression lhs,
+                       Expression rhs,
+                       const class location& location) {
+  auto node = std::make_shared<Node>();
+  node->op = op;
+  node->operands.reserve(2u);
+  node->operands.emplace_back(std::move(lhs));
+  node->operands.emplace_back(std::move(rhs));
+  node->location = location;
+  node_ = std::move(node);
+}
+
+Expression::~Expression() = default;
+
+std::optional<uint64_t> Expression::GetValue() const {
+  return value_;
+}
+
+// Returns nothing and sets the error if the result is not an unsigned 64-bit
+// integer.
+static std::optional<uint64_t> ApplyOperator(Expression::Operator op,
+                                             uint64_t lhs,
+                                             uint64_t rhs,
+                                             const char*& error) {
+  constexpr auto kMax = std::numeric_limits<uint64_t>::max();
+  constexpr auto kOverflows = "The expression does not fit in uint64_t.";
+  switch (op) {
+    case Expression::Operator::kAdd:
+      if (lhs > kMax - rhs) {
+        error = kOverflows;
+        return std::nullopt;
+      }
+      return lhs + rhs;
+    case Expression::Operator::kSubtract:
+      if (rhs > lhs) {
+        error = "The expression is negative.";
+        return std::nullopt;
+      }
+      return lhs - rhs;
+    case Expression::Operator::kMultiply:
+      if (lhs != 0u && rhs > kMax / lhs) {
+        error = kOverflows;
+        return std::nullopt;
+      }
+      return lhs * rhs;
+    case Expression::Operator::kDivide:
+    case Expression::Operator::kRemainder:
+      if (rhs == 0u) {
+        error = "The expression divides by zero.";
+        return std::nullopt;
+      }
+      return op == Expression::Operator::kDivide ? lhs / rhs : lhs % rhs;
+    case Expression::Operator::kShiftLeft:
+    case Expression::Operator::kShiftRight:
+      if (rhs >= 64u) {
+        error = "The expression shifts by 64 bits or more.";
+        return std::nullopt;
+      }
+      if (op == Expression::Operator::kShiftRight) {
+        return lhs >> rhs;
+      }
+      if (((lhs << rhs) >> rhs) != lhs) {
+        error = kOverflows;
+        return std::nullopt;
+      }
+      return lhs << rhs;
+    case Expression::Operator::kBitwiseAnd:
+      return lhs & rhs;
+    case Expression::Operator::kBitwiseOr:
+      return lhs | rhs;
+  }
+  return std::nullopt;
+}
+
+std::optional<uint64_t> Expression::ComputeValue(
+    const Expression& expression,
+    const ConstantResolver& resolver,
+    std::vector<Diagnostic>& diagnostics) {
+  if (!expression.node_) {
+    return expression.value_;
+  }
+  const auto& node = *expression.node_;
+  if (node.operands.empty()) {
+    return resolver(node.constant, node.location);
+  }
+  const auto lhs = ComputeValue(node.operands[0], resolver, diagnostics);
+  const auto rhs = ComputeValue(node.operands[1], resolver, diagnostics);
+  if (!lhs.has_value() || !rhs.has_value()) {
+    return std::nullopt;
+  }
+  const char* error = nullptr;
+  const auto value = ApplyOperator(node.op, lhs.value(), rhs.value(), error);
+  if (!value.has_value()) {
+    diagnostics.push_back({node.location, error});
+  }
+  return value;
+}
+
+bool Expression::Evaluate(const ConstantResolver& resolver,
+                          std::vector<Diagnostic>& diagnostics) {
+  value_ = ComputeValue(*this, resolver, diagnostics);
+  return value_.has_value();
+}
+
 Variable::Variable() = default;
 
 Variable::Variable(Primitive primitive, std::string identifier, bool is_pointer)
@@ -32,6 +297,38 @@ bool Variable::IsPointer() const {
   return is_pointer_;
 }
 
+bool Variable::IsArray() const {
+  return array_length_.has_value();
+}
+
+std::optional<uint64_t> Variable::GetArrayLength() const {
+  if (!array_length_.has_value()) {
+    return std::nullopt;
+  }
+  return array_length_->GetValue();
+}
+
+void Variable::SetArrayLength(Expression length) {
+  array_length_ = std::move(length);
+}
+
+bool Variable::IsSlice() const {
+  return is_slice_;
+}
+
+void Variable::SetSlice(bool is_slice) {
+  is_slice_ = is_slice;
+}
+
+bool Variable::EvaluateExpressions(
+    const Expression::ConstantResolver& resolver,
+    std::vector<Diagnostic>& diagnostics) {
+  if (!array_length_.has_value()) {
+    return true;
+  }
+  return array_length_->Evaluate(resolver, diagnostics);
+}
+
 std::optional<std::string> Variable::GetUserDefinedType() const {
   if (auto user_type = std::get_if<std::string>(&type_)) {
     return *user_type;
@@ -48,39 +345,83 @@ std::optional<Primitive> Variable::GetPrimitive() const {
   return std::nullopt;
 }
 
+const location& Variable::GetLocation() const {
+  return location_;
+}
+
+void Variable::SetLocation(const class location& location) {
+  location_ = location;
+}
+
+// Arrays of the widest elements must still fit in 32-bit address spaces.
+static constexpr uint64_t kMaxArrayLength =
+    std::numeric_limits<int32_t>::max() / 8u;
+
 bool Variable::PassesSema(const Namespace& ns,
-                          std::stringstream& stream) const {
+                          std::vector<Diagnostic>& diagnostics) const {
+  const auto array_length = GetArrayLength();
+  if (array_length.has_value() &&
+      (array_length.value() == 0u || array_length.value() > kMaxArrayLength)) {
+    diagnostics.push_back({location_, "Array '" + identifier_ +
+                                          "' must have between 1 and " +
+                                          std::to_string(kMaxArrayLength) +
+                                          " elements."});
+    return false;
+  }
+
   if (auto primitive = GetPrimitive(); primitive.has_value()) {
+    if (is_slice_ && (primitive == Primitive::kVoid ||
+                      primitive == Primitive::kString)) {
+      const auto* type_name = GetPrimitiveTraits(primitive.value()).type;
+      diagnostics.push_back({location_, "Slice '" + identifier_ +
+                                            "' cannot hold " + type_name +
+                                            "."});
+      return false;
+    }
+    if (primitive == Primitive::kString && is_pointer_) {
+      diagnostics.push_back({location_, "Variable '" + identifier_ +
+                                            "' cannot be a pointer to a "
+                                            "string."});
+      return false;
+    }
     if (primitive == Primitive::kVoid && !is_pointer_) {
-      stream << "Variable '" << identifier_ << "' cannot be void." << std::endl;
+      diagnostics.push_back(
+          {location_, "Variable '" + identifier_ + "' cannot be void."});
       return false;
     }
   }
 
   if (auto user_type = GetUserDefinedType(); user_type.has_value()) {
+    std::stringstream stream;
     if (IsPointer()) {
       // If the user defined type is a pointer, it must be a known struct.
       if (!ns.HasStructNamed(user_type.value())) {
         stream << "No struct named " << user_type.value() << " in namespace "
-               << ns.GetName() << "." << std::endl;
+               << ns.GetName() << ".";
         if (ns.HasEnumNamed(user_type.value())) {
-          stream << "There is an enum named " << user_type.value()
-                 << " but enums but may only be specified by value."
-                 << std::endl;
+          stream << " There is an enum named " << user_type.value()
+                 << " but enums but may only be specified by value.";
         }
+        diagnostics.push_back({location_, stream.str()});
         return false;
       }
     } else {
       // If the user defined type is not a pointer, it must be a known enum.
+      // Functions check the structs their arguments hold by value.
       if (!ns.HasEnumNamed(user_type.value())) {
         stream << "No enum named " << user_type.value() << " in namespace "
-               << ns.GetName() << "." << std::endl;
+               << ns.GetName() << ".";
         if (ns.HasStructNamed(user_type.value())) {
-          stream << "There is an struct named " << user_type.value()
-                 << " but structs may not be specified by value. Use a pointer "
-                    "to the struct instead."
-                 << std::endl;
+          stream << " There is an struct named " << user_type.value()
+                 << " but struct fields may not hold structs by value. Use a "
+                    "pointer to the struct instead.";
         }
+        diagnostics.push_back({location_, stream.str()});
+        return false;
+      }
+      if (array_length_.has_value()) {
+        diagnostics.push_back({location_, "Array '" + identifier_ +
+                                              "' may not hold enums."});
         return false;
       }
     }
@@ -89,42 +430,57 @@ bool Variable::PassesSema(const Namespace& ns,
   return true;
 }
 
-static std::string PrimitiveToTypeString(Primitive primitive) {
-  switch (primitive) {
-    case Primitive::kVoid:
-      return "void";
-    case Primitive::kInt8:
-      return "int8_t";
-    case Primitive::kInt16:
-      return "int16_t";
-    case Primitive::kInt32:
-      return "int32_t";
-    case Primitive::kInt64:
-      return "int64_t";
-    case Primitive::kUnsignedInt8:
-      return "uint8_t";
-    case Primitive::kUnsignedInt16:
-      return "uint16_t";
-    case Primitive::kUnsignedInt32:
-      return "uint32_t";
-    case Primitive::kUnsignedInt64:
-      return "uint64_t";
-    case Primitive::kDouble:
-      return "double";
-    case Primitive::kFloat:
-      return "float";
-  };
-  return "unknown";
+std::optional<Primitive> Variable::GetEnumUnderlyingType() const {
+  return enum_underlying_type_;
+}
+
+void Variable::ResolveEnumType(const EnumTypes& enum_types) {
+  auto type = std::get_if<std::string>(&type_);
+  if (type == nullptr || is_pointer_) {
+    return;
+  }
+  if (auto found = enum_types.find(*type); found != enum_types.end()) {
+    enum_underlying_type_ = found->second;
+  }
+}
+
+StructLayout::Field Variable::GetFieldLayout(ABI abi) const {
+  const auto& abi_traits = GetABITraits(abi);
+  StructLayout::Field field;
+  if (is_pointer_) {
+    field.size = abi_traits.pointer_size;
+    field.alignment = abi_traits.pointer_size;
+  } else {
+    const auto primitive = GetPrimitive().value_or(
+        enum_underlying_type_.value_or(Primitive::kUnsignedInt64));
+    field.size = GetPrimitiveTraits(primitive).size;
+    field.alignment =
+        field.size == 8u ? abi_traits.int64_alignment : field.size;
+  }
+  field.size *= GetArrayLength().value_or(1u);
+  return field;
+}
+
+static nlohmann::json::object_t GetPrimitiveJSONObject(Primitive primitive) {
+  const auto& traits = GetPrimitiveTraits(primitive);
+  nlohmann::json::object_t object;
+  object["c_type"] = traits.c_type;
+  object["dart_ffi_type"] = traits.dart_ffi_type;
+  object["dart_type"] = traits.dart_type;
+  object["size"] = traits.size;
+  object["alignment"] = traits.alignment;
+  return object;
 }
 
 nlohmann::json::object_t Variable::GetJSONObject(const Namespace& ns) const {
   nlohmann::json::object_t var;
 
   if (auto primitive = GetPrimitive(); primitive.has_value()) {
-    var["type"] = PrimitiveToTypeString(primitive.value());
+    var["type"] = GetPrimitiveTraits(primitive.value()).type;
     var["is_enum"] = false;
     var["is_struct"] = false;
     var["is_primitive"] = true;
+    var["primitive"] = GetPrimitiveJSONObject(primitive.value());
   }
 
   if (auto user_type = GetUserDefinedType(); user_type.has_value()) {
@@ -132,10 +488,24 @@ nlohmann::json::object_t Variable::GetJSONObject(const Namespace& ns) const {
     var["is_enum"] = ns.HasEnumNamed(user_type.value());
     var["is_struct"] = ns.HasStructNamed(user_type.value());
     var["is_primitive"] = false;
+    if (enum_underlying_type_.has_value()) {
+      var["primitive"] = GetPrimitiveJSONObject(enum_underlying_type_.value());
+    }
   }
 
   var["identifier"] = identifier_;
   var["is_pointer"] = is_pointer_;
+  var["is_array"] = array_length_.has_value();
+  var["is_slice"] = is_slice_;
+  var["is_string"] = GetPrimitive() == Primitive::kString;
+  if (is_slice_) {
+    var["dart_typed_data"] =
+        GetPrimitiveTraits(GetPrimitive().value_or(Primitive::kVoid))
+            .dart_typed_data;
+  }
+  if (array_length_.has_value()) {
+    var["array_length"] = GetArrayLength().value_or(0u);
+  }
   return var;
 }
 
@@ -168,51 +538,190 @@ bool Function::ReturnsPointer() const {
   return pointer_return_;
 }
 
+bool Function::IsAsync() const {
+  return is_async_;
+}
+
+void Function::SetAsync(bool is_async) {
+  is_async_ = is_async;
+}
+
+const location& Function::GetLocation() const {
+  return location_;
+}
+
+void Function::SetLocation(const class location& location) {
+  location_ = location;
+}
+
+// Structs are passed to and returned from functions by value if they only hold
+// data that is copied with them. Those are primitives, enums and inline arrays.
+// Dart does not support empty structs by value.
+static bool CheckPassableByValue(const Struct& strut,
+                                 const char* passed,
+                                 const location& location,
+                                 std::vector<Diagnostic>& diagnostics) {
+  std::string reason;
+  if (strut.GetVariables().empty()) {
+    reason = "it has no fields";
+  }
+  for (const auto& var : strut.GetVariables()) {
+    if (var.IsPointer()) {
+      reason = "its field '" + var.GetIdentifier() + "' is a pointer";
+      break;
+    }
+    if (var.HasAttribute("cold")) {
+      reason = "its field '" + var.GetIdentifier() + "' is cold";
+      break;
+    }
+  }
+  if (reason.empty()) {
+    return true;
+  }
+  diagnostics.push_back({location, "Struct " + strut.GetName() +
+                                       " cannot be " + passed +
+                                       " by value because " + reason +
+                                       ". Use a pointer to the struct "
+                                       "instead."});
+  return false;
+}
+
+// Batch entry points loop over arrays of each argument and of the result. Async
+// functions copy their arguments to run later on another thread. So both may
+// only take and return numbers by value.
+static bool IsNumberByValue(std::optional<Primitive> primitive,
+                            bool is_pointer) {
+  return primitive.has_value() && primitive.value() != Primitive::kVoid &&
+         primitive.value() != Primitive::kString && !is_pointer;
+}
+
+bool Function::CheckBatchable(std::vector<Diagnostic>& diagnostics) const {
+  bool passes = true;
+  for (const auto& arg : arguments_) {
+    const auto& identifier = arg.GetIdentifier();
+    if (!IsNumberByValue(arg.GetPrimitive(), arg.IsPointer()) ||
+        arg.IsSlice()) {
+      diagnostics.push_back(
+          {arg.GetLocation(), "Argument '" + identifier +
+                                  "' of batch function " + name_ +
+                                  " must be a number passed by value."});
+      passes = false;
+    } else if (identifier == "count" || identifier == "out") {
+      diagnostics.push_back(
+          {arg.GetLocation(), "Batch function " + name_ +
+                                  " cannot have an argument named " +
+                                  identifier + ". Batch entry points take the "
+                                  "count and out arguments."});
+      passes = false;
+    }
+  }
+  if (!IsNumberByValue(GetPrimitiveReturn(), pointer_return_)) {
+    diagnostics.push_back({location_, "Batch function " + name_ +
+                                          " must return a number by value."});
+    passes = false;
+  }
+  return passes;
+}
+
+bool Function::CheckAsync(std::vector<Diagnostic>& diagnostics) const {
+  bool passes = true;
+  for (const auto& arg : arguments_) {
+    if (!IsNumberByValue(arg.GetPrimitive(), arg.IsPointer()) ||
+        arg.IsSlice()) {
+      diagnostics.push_back(
+          {arg.GetLocation(), "Argument '" + arg.GetIdentifier() +
+                                  "' of async function " + name_ +
+                                  " must be a number passed by value."});
+      passes = false;
+    }
+  }
+  // Async functions may also return nothing.
+  if (GetPrimitiveReturn() != Primitive::kVoid &&
+      !IsNumberByValue(GetPrimitiveReturn(), pointer_return_)) {
+    diagnostics.push_back({location_, "Async function " + name_ +
+                                          " must return a number by value or "
+                                          "nothing."});
+    passes = false;
+  }
+  return passes;
+}
+
 bool Function::PassesSema(const Namespace& ns,
-                          std::stringstream& stream) const {
+                          std::vector<Diagnostic>& diagnostics) const {
+  bool passes = CheckAttributes({"leaf", "batch"}, "function", name_,
+                                location_, diagnostics);
+  if (HasAttribute("batch")) {
+    passes = CheckBatchable(diagnostics) && passes;
+  }
+  if (is_async_) {
+    passes = CheckAsync(diagnostics) && passes;
+  }
   for (const auto& arg : arguments_) {
-    if (!arg.PassesSema(ns, stream)) {
-      return false;
+    // Unlike struct fields, arguments may hold structs by value.
+    const auto type = arg.GetUserDefinedType();
+    const auto* strut = type.has_value() && !arg.IsPointer()
+                            ? ns.GetStructNamed(type.value())
+                            : nullptr;
+    if (strut != nullptr) {
+      passes = CheckPassableByValue(*strut, "passed", arg.GetLocation(),
+                                    diagnostics) &&
+               passes;
+      continue;
     }
+    passes = arg.PassesSema(ns, diagnostics) && passes;
+  }
+
+  if (GetPrimitiveReturn() == Primitive::kString && ReturnsPointer()) {
+    diagnostics.push_back({location_, "Function " + name_ + " in namespace " +
+                                          ns.GetName() +
+                                          " cannot return a pointer to a "
+                                          "string."});
+    return false;
   }
 
   if (auto ret = GetUserDefinedReturn(); ret.has_value()) {
-    // If the user defined type is a struct, it must be a pointer. Otherwise, it
-    // must be an enum.
+    std::stringstream stream;
+    // Pointers must be to structs. Values may be structs or enums.
     if (ReturnsPointer()) {
       if (!ns.HasStructNamed(ret.value())) {
         stream << "Function " << name_ << " in namespace " << ns.GetName()
-               << " specifies a return type " << ret.value() << "."
-               << std::endl;
-        stream << "However, " << ret.value() << " is not a known struct name."
-               << std::endl;
+               << " specifies a return type " << ret.value() << ". However, "
+               << ret.value() << " is not a known struct name.";
         if (ns.HasEnumNamed(ret.value())) {
-          stream << "There is an enum named " << ret.value()
+          stream << " There is an enum named " << ret.value()
                  << ". But enums may only be returned by value. Drop the "
-                    "return by pointer."
-                 << std::endl;
-        }
-        return false;
-      }
-    } else {
-      if (!ns.HasEnumNamed(ret.value())) {
-        stream << "Function " << name_ << " in namespace " << ns.GetName()
-               << " specifies a return type " << ret.value() << "."
-               << std::endl;
-        stream << "However, " << ret.value() << " is not a known enum name."
-               << std::endl;
-        if (ns.HasStructNamed(ret.value())) {
-          stream << "There is a struct named " << ret.value()
-                 << ". But structs may not be returned by value. Use a pointer "
-                    "return instead."
-                 << std::endl;
+                    "return by pointer.";
         }
+        diagnostics.push_back({location_, stream.str()});
         return false;
       }
+    } else if (const auto* strut = ns.GetStructNamed(ret.value())) {
+      return CheckPassableByValue(*strut, "returned", location_,
+                                  diagnostics) &&
+             passes;
+    } else if (!ns.HasEnumNamed(ret.value())) {
+      stream << "Function " << name_ << " in namespace " << ns.GetName()
+             << " specifies a return type " << ret.value() << ". However, "
+             << ret.value() << " is not a known struct or enum name.";
+      diagnostics.push_back({location_, stream.str()});
+      return false;
     }
   }
 
-  return true;
+  return passes;
+}
+
+void Function::ResolveEnumTypes(const EnumTypes& enum_types) {
+  for (auto& argument : arguments_) {
+    argument.ResolveEnumType(enum_types);
+  }
+  auto type = std::get_if<std::string>(&return_type_);
+  if (type == nullptr || pointer_return_) {
+    return;
+  }
+  if (auto found = enum_types.find(*type); found != enum_types.end()) {
+    enum_return_type_ = found->second;
+  }
 }
 
 std::optional<Primitive> Function::GetPrimitiveReturn() const {
@@ -232,24 +741,53 @@ std::optional<std::string> Function::GetUserDefinedReturn() const {
 nlohmann::json::object_t Function::GetJSONObject(const Namespace& ns) const {
   auto args = nlohmann::json::array_t{};
 
+  bool takes_slices = false;
+  bool takes_strings = false;
+  const auto is_batch = HasAttribute("batch");
   for (const auto& arg : arguments_) {
     args.emplace_back(arg.GetJSONObject(ns));
+    // Batch entry points take typed data lists of each argument in Dart.
+    if (const auto primitive = arg.GetPrimitive(); is_batch && primitive) {
+      args.back()["dart_typed_data"] =
+          GetPrimitiveTraits(primitive.value()).dart_typed_data;
+    }
+    takes_slices = takes_slices || arg.IsSlice();
+    takes_strings = takes_strings || arg.GetPrimitive() == Primitive::kString;
   }
 
   nlohmann::json::object_t fun;
   fun["name"] = name_;
   if (auto ret = GetPrimitiveReturn(); ret.has_value()) {
-    fun["return_type"] = PrimitiveToTypeString(ret.value());
+    fun["return_type"] = GetPrimitiveTraits(ret.value()).type;
     fun["returns_struct"] = false;
     fun["returns_enum"] = false;
     fun["returns_primitive"] = true;
+    fun["return_primitive"] = GetPrimitiveJSONObject(ret.value());
   } else if (auto ret = GetUserDefinedReturn(); ret.has_value()) {
     fun["return_type"] = ret.value();
     fun["returns_struct"] = ns.HasStructNamed(ret.value());
     fun["returns_enum"] = ns.HasEnumNamed(ret.value());
     fun["returns_primitive"] = false;
+    if (enum_return_type_.has_value()) {
+      fun["return_primitive"] =
+          GetPrimitiveJSONObject(enum_return_type_.value());
+    }
   }
   fun["pointer_return"] = pointer_return_;
+  fun["returns_string"] = GetPrimitiveReturn() == Primitive::kString;
+  fun["takes_slices"] = takes_slices;
+  fun["takes_strings"] = takes_strings;
+  // Only functions marked as leaf functions promise to be leaf functions. But
+  // Dart only allows the addresses of typed data in leaf calls. So functions
+  // that take slices or strings are called like leaf functions too.
+  fun["is_leaf"] = HasAttribute("leaf");
+  fun["is_leaf_call"] = HasAttribute("leaf") || takes_slices || takes_strings;
+  fun["is_batch"] = is_batch;
+  fun["is_async"] = is_async_;
+  if (const auto ret = GetPrimitiveReturn(); is_batch && ret) {
+    fun["return_dart_typed_data"] =
+        GetPrimitiveTraits(ret.value()).dart_typed_data;
+  }
   fun["arguments"] = std::move(args);
 
   return fun;
@@ -259,17 +797,21 @@ Namespace::Namespace() = default;
 
 Namespace::Namespace(std::string name, NamespaceItems items)
     : name_(std::move(name)) {
-  for (const auto& item : items) {
+  for (auto& item : items) {
     if (auto function = std::get_if<Function>(&item)) {
-      functions_.push_back(*function);
+      AddFunction(std::move(*function));
     }
 
     if (auto struct_item = std::get_if<Struct>(&item)) {
-      structs_.push_back(*struct_item);
+      AddStruct(std::move(*struct_item));
     }
 
     if (auto enum_item = std::get_if<Enum>(&item)) {
-      enums_.push_back(*enum_item);
+      AddEnum(std::move(*enum_item));
+    }
+
+    if (auto constant = std::get_if<Constant>(&item)) {
+      AddConstant(std::move(*constant));
     }
   }
 }
@@ -296,92 +838,316 @@ const std::vector<Enum>& Namespace::GetEnums() const {
   return enums_;
 }
 
+const std::vector<Constant>& Namespace::GetConstants() const {
+  return constants_;
+}
+
 bool Namespace::HasEnumNamed(const std::string& name) const {
-  return std::find_if(enums_.begin(), enums_.end(), [&](const auto& enumm) {
-           return enumm.GetName() == name;
-         }) != enums_.end();
+  return enum_names_.count(name) != 0u;
 }
 
 bool Namespace::HasStructNamed(const std::string& name) const {
-  return std::find_if(structs_.begin(), structs_.end(), [&](const auto& strut) {
-           return strut.GetName() == name;
-         }) != structs_.end();
+  return struct_indices_.count(name) != 0u;
+}
+
+const Struct* Namespace::GetStructNamed(const std::string& name) const {
+  auto found = struct_indices_.find(name);
+  if (found == struct_indices_.end()) {
+    return nullptr;
+  }
+  return &structs_[found->second];
+}
+
+bool Namespace::HasConstantNamed(const std::string& name) const {
+  return constant_names_.count(name) != 0u;
+}
+
+void Namespace::AddFunctions(std::vector<Function> functions) {
+  for (auto& function : functions) {
+    AddFunction(std::move(function));
+  }
+}
+
+void Namespace::AddStructs(std::vector<Struct> structs) {
+  for (auto& strut : structs) {
+    AddStruct(std::move(strut));
+  }
+}
+
+void Namespace::AddEnums(std::vector<Enum> enums) {
+  for (auto& enumm : enums) {
+    AddEnum(std::move(enumm));
+  }
+}
+
+void Namespace::AddConstants(std::vector<Constant> constants) {
+  for (auto& constant : constants) {
+    AddConstant(std::move(constant));
+  }
+}
+
+void Namespace::Append(Namespace other) {
+  if (functions_.empty() && structs_.empty() && enums_.empty() &&
+      constants_.empty()) {
+    functions_ = std::move(other.functions_);
+    structs_ = std::move(other.structs_);
+    enums_ = std::move(other.enums_);
+    constants_ = std::move(other.constants_);
+    struct_indices_ = std::move(other.struct_indices_);
+    enum_names_ = std::move(other.enum_names_);
+    constant_names_ = std::move(other.constant_names_);
+    checked_functions_ = other.checked_functions_;
+    checked_structs_ = other.checked_structs_;
+    checked_enums_ = other.checked_enums_;
+    checked_constants_ = other.checked_constants_;
+    return;
+  }
+  // The checked items of the other namespace only remain at the start of the
+  // lists if all items in this one have been checked.
+  if (checked_functions_ == functions_.size()) {
+    checked_functions_ += other.checked_functions_;
+  }
+  if (checked_structs_ == structs_.size()) {
+    checked_structs_ += other.checked_structs_;
+  }
+  if (checked_enums_ == enums_.size()) {
+    checked_enums_ += other.checked_enums_;
+  }
+  if (checked_constants_ == constants_.size()) {
+    checked_constants_ += other.checked_constants_;
+  }
+  AddFunctions(std::move(other.functions_));
+  AddStructs(std::move(other.structs_));
+  AddEnums(std::move(other.enums_));
+  AddConstants(std::move(other.constants_));
 }
 
-void Namespace::AddFunctions(const std::vector<Function>& functions) {
-  std::copy(functions.cbegin(), functions.cend(),
-            std::back_inserter(functions_));
+void Namespace::AddFunction(Function function) {
+  functions_.emplace_back(std::move(function));
 }
 
-void Namespace::AddStructs(const std::vector<Struct>& structs) {
-  std::copy(structs.cbegin(), structs.cend(), std::back_inserter(structs_));
+void Namespace::AddStruct(Struct struct_item) {
+  struct_indices_.emplace(struct_item.GetName(), structs_.size());
+  structs_.emplace_back(std::move(struct_item));
 }
 
-void Namespace::AddEnums(const std::vector<Enum>& enums) {
-  std::copy(enums.cbegin(), enums.cend(), std::back_inserter(enums_));
+void Namespace::AddEnum(Enum enum_item) {
+  enum_names_.insert(enum_item.GetName());
+  enums_.emplace_back(std::move(enum_item));
 }
 
-bool Namespace::CheckDuplicateFunctions(std::stringstream& stream) const {
-  std::set<std::string> function_names;
+void Namespace::AddConstant(Constant constant) {
+  constant_names_.insert(constant.GetName());
+  constants_.emplace_back(std::move(constant));
+}
+
+void Namespace::MarkChecked() {
+  checked_functions_ = functions_.size();
+  checked_structs_ = structs_.size();
+  checked_enums_ = enums_.size();
+  checked_constants_ = constants_.size();
+}
+
+size_t Namespace::GetCheckedFunctionCount() const {
+  return checked_functions_;
+}
+
+size_t Namespace::GetCheckedStructCount() const {
+  return checked_structs_;
+}
+
+bool Namespace::CheckDuplicateFunctions(
+    std::vector<Diagnostic>& diagnostics) const {
+  bool passes = true;
+  std::unordered_set<std::string> function_names;
+  function_names.reserve(functions_.size());
   for (const auto& function : functions_) {
     const auto& function_name = function.GetName();
-    auto found = function_names.find(function_name);
-    if (found == function_names.end()) {
-      function_names.insert(function_name);
-    } else {
-      stream << "Duplicate function '" << function_name << "' in namespace '"
-             << name_ << "'" << std::endl;
-      return false;
+    if (!function_names.insert(function_name).second) {
+      diagnostics.push_back({function.GetLocation(),
+                             "Duplicate function '" + function_name +
+                                 "' in namespace '" + name_ + "'"});
+      passes = false;
     }
   }
-  return true;
+  return passes;
 }
 
-bool Namespace::CheckStructEnumNameCollisions(std::stringstream& stream) const {
-  std::map<std::string, size_t> name_counts;
-  auto count_fn = [&](const std::string& name) -> void { name_counts[name]++; };
-  std::for_each(structs_.begin(), structs_.end(),
-                [&](const auto& str) { count_fn(str.GetName()); });
-  std::for_each(enums_.begin(), enums_.end(),
-                [&](const auto& enm) { count_fn(enm.GetName()); });
-  for (const auto& count : name_counts) {
-    if (count.second > 1) {
-      stream << "Struct or enum named " << count.first
-             << " declared more than once." << std::endl;
-      return false;
+bool Namespace::CheckNameCollisions(
+    std::vector<Diagnostic>& diagnostics) const {
+  bool passes = true;
+  std::unordered_set<std::string> names;
+  names.reserve(structs_.size() + enums_.size() + constants_.size());
+  auto check_fn = [&](const std::string& name, const location& location) {
+    if (!names.insert(name).second) {
+      diagnostics.push_back({location, "Struct, enum or constant named " +
+                                           name +
+                                           " declared more than once."});
+      passes = false;
     }
+  };
+  for (const auto& str : structs_) {
+    check_fn(str.GetName(), str.GetLocation());
   }
-  return true;
+  for (const auto& enm : enums_) {
+    check_fn(enm.GetName(), enm.GetLocation());
+  }
+  for (const auto& constant : constants_) {
+    check_fn(constant.GetName(), constant.GetLocation());
+  }
+  return passes;
 }
 
-bool Namespace::PassesSema(std::stringstream& stream) const {
-  if (!CheckDuplicateFunctions(stream)) {
-    return false;
+bool Namespace::EvaluateConstants(std::vector<Diagnostic>& diagnostics) {
+  // Constants are evaluated when they are first referred to. A constant that
+  // is referred to while it is being evaluated depends on itself.
+  enum class State {
+    kPending,
+    kEvaluating,
+    kEvaluated,
+  };
+  std::unordered_map<std::string, size_t> indices;
+  indices.reserve(constants_.size());
+  for (size_t i = 0; i < constants_.size(); i++) {
+    indices.emplace(constants_[i].GetName(), i);
   }
+  std::vector<State> states(constants_.size(), State::kPending);
+
+  Expression::ConstantResolver resolver;
+  auto evaluate = [&](size_t index) {
+    if (states[index] == State::kPending) {
+      states[index] = State::kEvaluating;
+      constants_[index].Evaluate(resolver, diagnostics);
+      states[index] = State::kEvaluated;
+    }
+  };
+  resolver = [&](const std::string& name,
+                 const location& location) -> std::optional<uint64_t> {
+    const auto found = indices.find(name);
+    if (found == indices.end()) {
+      diagnostics.push_back({location, "No constant named " + name +
+                                           " in namespace " + name_ + "."});
+      return std::nullopt;
+    }
+    if (states[found->second] == State::kEvaluating) {
+      diagnostics.push_back(
+          {location, "Constant " + name + " depends on its own value."});
+      return std::nullopt;
+    }
+    evaluate(found->second);
+    // Constants that could not be evaluated have already been reported.
+    return constants_[found->second].GetValue();
+  };
 
-  if (!CheckStructEnumNameCollisions(stream)) {
-    return false;
+  // Modules keep the items of imported files as they were parsed. So checked
+  // items are evaluated too. That cannot fail since they passed Sema before.
+  bool passes = true;
+  for (size_t i = 0; i < constants_.size(); i++) {
+    evaluate(i);
+    passes = constants_[i].GetValue().has_value() && passes;
+  }
+  for (auto& strut : structs_) {
+    passes = strut.EvaluateExpressions(resolver, diagnostics) && passes;
   }
+  for (auto& enumm : enums_) {
+    passes = enumm.EvaluateExpressions(resolver, diagnostics) && passes;
+  }
+  return passes;
+}
 
-  for (const auto& strut : structs_) {
-    if (!strut.PassesSema(*this, stream)) {
-      return false;
+bool Namespace::PassesSema(std::vector<Diagnostic>& diagnostics) const {
+  bool passes = CheckDuplicateFunctions(diagnostics);
+
+  passes = CheckNameCollisions(diagnostics) && passes;
+
+  for (size_t i = checked_structs_; i < structs_.size(); i++) {
+    passes = structs_[i].PassesSema(*this, diagnostics) && passes;
+  }
+
+  for (size_t i = checked_functions_; i < functions_.size(); i++) {
+    passes = functions_[i].PassesSema(*this, diagnostics) && passes;
+  }
+
+  for (size_t i = checked_enums_; i < enums_.size(); i++) {
+    passes = enums_[i].PassesSema(*this, diagnostics) && passes;
+  }
+
+  for (size_t i = checked_constants_; i < constants_.size(); i++) {
+    passes = constants_[i].PassesSema(diagnostics) && passes;
+  }
+
+  return passes;
+}
+
+void Namespace::ResolveEnumTypes() {
+  if (enums_.empty()) {
+    return;
+  }
+  EnumTypes enum_types;
+  enum_types.reserve(enums_.size());
+  for (const auto& enumm : enums_) {
+    enum_types.emplace(enumm.GetName(), enumm.GetUnderlyingType());
+  }
+  for (auto& strut : structs_) {
+    strut.ResolveEnumTypes(enum_types);
+  }
+  for (auto& function : functions_) {
+    function.ResolveEnumTypes(enum_types);
+  }
+}
+
+void Namespace::SplitColdStructFields() {
+  std::vector<std::pair<size_t, Struct>> cold_structs;
+  for (size_t i = 0; i < structs_.size(); i++) {
+    if (auto cold = structs_[i].SplitColdFields(); cold.has_value()) {
+      cold_structs.emplace_back(i, std::move(cold.value()));
     }
   }
+  if (cold_structs.empty()) {
+    return;
+  }
 
-  for (const auto& func : functions_) {
-    if (!func.PassesSema(*this, stream)) {
-      return false;
+  std::vector<Struct> structs;
+  structs.reserve(structs_.size() + cold_structs.size());
+  auto cold = cold_structs.begin();
+  const auto checked_structs = checked_structs_;
+  for (size_t i = 0; i < structs_.size(); i++) {
+    if (cold != cold_structs.end() && cold->first == i) {
+      structs.emplace_back(std::move(cold->second));
+      // The cold structs of checked structs are checked too.
+      if (i < checked_structs) {
+        checked_structs_++;
+      }
+      ++cold;
     }
+    structs.emplace_back(std::move(structs_[i]));
   }
+  structs_ = std::move(structs);
 
-  for (const auto& enumm : enums_) {
-    if (!enumm.PassesSema(*this, stream)) {
-      return false;
+  // The structs after each cold struct have moved.
+  struct_indices_.clear();
+  for (size_t i = 0; i < structs_.size(); i++) {
+    struct_indices_.emplace(structs_[i].GetName(), i);
+  }
+}
+
+void Namespace::ReorderStructFields() {
+  for (auto& strut : structs_) {
+    if (strut.HasAttribute("reorder")) {
+      strut.ReorderFields();
     }
   }
+}
 
-  return true;
+void Namespace::ComputeStructLayouts(const std::vector<ABI>& abis) {
+  for (auto& strut : structs_) {
+    std::vector<StructLayout> layouts;
+    layouts.reserve(abis.size());
+    for (const auto abi : abis) {
+      layouts.emplace_back(strut.ComputeLayout(abi));
+    }
+    strut.SetLayouts(std::move(layouts));
+  }
 }
 
 nlohmann::json::object_t Namespace::GetJSONObject() const {
@@ -390,23 +1156,43 @@ nlohmann::json::object_t Namespace::GetJSONObject() const {
   auto structs = nlohmann::json::array_t{};
   auto funcs = nlohmann::json::array_t{};
   auto enums = nlohmann::json::array_t{};
+  auto constants = nlohmann::json::array_t{};
 
   for (const auto& str : structs_) {
     structs.emplace_back(str.GetJSONObject(*this));
   }
 
+  bool has_async_functions = false;
+  bool has_slices = false;
+  bool has_strings = false;
   for (const auto& fun : functions_) {
-    funcs.emplace_back(fun.GetJSONObject(*this));
+    auto func = fun.GetJSONObject(*this);
+    has_async_functions = has_async_functions || fun.IsAsync();
+    has_slices = has_slices || func["takes_slices"].get<bool>();
+    has_strings = has_strings || func["takes_strings"].get<bool>() ||
+                  func["returns_string"].get<bool>();
+    funcs.emplace_back(std::move(func));
   }
 
   for (const auto& enumm : enums_) {
     enums.emplace_back(enumm.GetJSONObject());
   }
 
+  for (const auto& constant : constants_) {
+    constants.emplace_back(constant.GetJSONObject());
+  }
+
   ns["name"] = name_;
   ns["functions"] = std::move(funcs);
   ns["structs"] = std::move(structs);
   ns["enums"] = std::move(enums);
+  ns["constants"] = std::move(constants);
+  // Async functions need the native thread pool.
+  ns["has_async_functions"] = has_async_functions;
+  // Generated code only includes the headers for slices and strings if they
+  // are used.
+  ns["has_slices"] = has_slices;
+  ns["has_strings"] = has_strings;
 
   return ns;
 }
@@ -426,40 +1212,252 @@ const std::vector<Variable>& Struct::GetVariables() const {
   return variables_;
 }
 
-bool Struct::PassesSema(const Namespace& ns, std::stringstream& stream) const {
-  std::set<std::string> variable_names;
+void Struct::ResolveEnumTypes(const EnumTypes& enum_types) {
+  for (auto& variable : variables_) {
+    variable.ResolveEnumType(enum_types);
+  }
+}
+
+bool Struct::EvaluateExpressions(const Expression::ConstantResolver& resolver,
+                                 std::vector<Diagnostic>& diagnostics) {
+  bool passes = true;
+  for (auto& variable : variables_) {
+    passes = variable.EvaluateExpressions(resolver, diagnostics) && passes;
+  }
+  return passes;
+}
+
+const location& Struct::GetLocation() const {
+  return location_;
+}
+
+void Struct::SetLocation(const class location& location) {
+  location_ = location;
+}
+
+bool Struct::PassesSema(const Namespace& ns,
+                        std::vector<Diagnostic>& diagnostics) const {
+  bool passes = CheckAttributes({"reorder", "hot"}, "struct", name_, location_,
+                                diagnostics);
+  std::unordered_set<std::string> variable_names;
+  variable_names.reserve(variables_.size());
+  bool has_cold_fields = false;
   for (const auto& var : variables_) {
-    if (!var.PassesSema(ns, stream)) {
-      return false;
+    passes = var.PassesSema(ns, diagnostics) && passes;
+    passes = var.CheckAttributes({"cold"}, "field", var.GetIdentifier(),
+                                 var.GetLocation(), diagnostics) &&
+             passes;
+    if (var.GetPrimitive() == Primitive::kString) {
+      diagnostics.push_back({var.GetLocation(),
+                             "Field '" + var.GetIdentifier() + "' of struct " +
+                                 name_ + " cannot be a string. Strings may "
+                                 "only be passed to and returned from "
+                                 "functions."});
+      passes = false;
     }
 
     const auto& variable_name = var.GetIdentifier();
-    auto found = variable_names.find(variable_name);
-    if (found == variable_names.end()) {
-      variable_names.insert(variable_name);
-    } else {
-      stream << "Duplicate variable '" << variable_name << "' in struct named '"
-             << name_ << "'." << std::endl;
-      return false;
+    if (!variable_names.insert(variable_name).second) {
+      diagnostics.push_back({var.GetLocation(),
+                             "Duplicate variable '" + variable_name +
+                                 "' in struct named '" + name_ + "'."});
+      passes = false;
     }
+    has_cold_fields = has_cold_fields || var.HasAttribute("cold");
   }
-  return true;
+
+  if (has_cold_fields) {
+    const auto cold_name = name_ + "Cold";
+    if (ns.HasStructNamed(cold_name) || ns.HasEnumNamed(cold_name)) {
+      diagnostics.push_back(
+          {location_, "Struct " + name_ + " has cold fields but the name " +
+                          cold_name + " of the struct they are moved to is "
+                          "taken."});
+      passes = false;
+    }
+    if (variable_names.count("cold") != 0u) {
+      diagnostics.push_back(
+          {location_, "Struct " + name_ + " has cold fields but also a field "
+                      "named cold. The pointer to the cold fields is named "
+                      "cold."});
+      passes = false;
+    }
+  }
+  return passes;
+}
+
+StructLayout Struct::ComputeLayout(ABI abi) const {
+  StructLayout layout;
+  layout.abi = abi;
+  layout.alignment = 1u;
+  layout.fields.reserve(variables_.size());
+  size_t offset = 0u;
+  for (const auto& variable : variables_) {
+    auto field = variable.GetFieldLayout(abi);
+    field.offset = AlignTo(offset, field.alignment);
+    field.padding = field.offset - offset;
+    offset = field.offset + field.size;
+    layout.alignment = std::max(layout.alignment, field.alignment);
+    layout.fields.push_back(field);
+  }
+  layout.size = std::max<size_t>(AlignTo(offset, layout.alignment), 1u);
+  layout.tail_padding = layout.size - offset;
+  return layout;
+}
+
+void Struct::ReorderFields() {
+  constexpr size_t kABICount = static_cast<size_t>(ABI::kIA32) + 1u;
+  using Alignments = std::array<size_t, kABICount>;
+  std::vector<std::pair<Alignments, size_t>> keys;
+  keys.reserve(variables_.size());
+  for (size_t i = 0; i < variables_.size(); i++) {
+    Alignments alignments;
+    for (size_t abi = 0; abi < kABICount; abi++) {
+      alignments[abi] =
+          variables_[i].GetFieldLayout(static_cast<ABI>(abi)).alignment;
+    }
+    keys.emplace_back(alignments, i);
+  }
+  std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) {
+    return a.first > b.first;
+  });
+
+  std::vector<Variable> variables;
+  std::vector<std::optional<size_t>> original_indices;
+  variables.reserve(variables_.size());
+  original_indices.reserve(variables_.size());
+  for (const auto& key : keys) {
+    variables.emplace_back(std::move(variables_[key.second]));
+    // Fields that were split or reordered before keep the indices they were
+    // declared at.
+    original_indices.push_back(original_indices_.empty()
+                                   ? key.second
+                                   : original_indices_[key.second]);
+  }
+  variables_ = std::move(variables);
+  original_indices_ = std::move(original_indices);
+  is_reordered_ = true;
+}
+
+bool Struct::IsReordered() const {
+  return is_reordered_;
+}
+
+const std::vector<std::optional<size_t>>& Struct::GetOriginalIndices() const {
+  return original_indices_;
+}
+
+std::optional<Struct> Struct::SplitColdFields() {
+  if (std::none_of(variables_.begin(), variables_.end(),
+                   [](const auto& variable) {
+                     return variable.HasAttribute("cold");
+                   })) {
+    return std::nullopt;
+  }
+
+  std::vector<Variable> hot_variables;
+  std::vector<std::optional<size_t>> hot_original_indices;
+  for (size_t i = 0; i < variables_.size(); i++) {
+    auto& variable = variables_[i];
+    const auto original_index =
+        original_indices_.empty() ? i : original_indices_[i].value_or(i);
+    if (!variable.HasAttribute("cold")) {
+      hot_variables.emplace_back(std::move(variable));
+      hot_original_indices.push_back(original_index);
+      continue;
+    }
+    // Fields of the cold struct are not split again.
+    variable.SetAttributes({});
+    cold_variables_.emplace_back(std::move(variable));
+    cold_original_indices_.push_back(original_index);
+  }
+
+  Struct cold(name_ + "Cold", cold_variables_);
+  cold.SetLocation(location_);
+  Variable pointer(cold.GetName(), "cold", true);
+  pointer.SetLocation(location_);
+  hot_variables.emplace_back(std::move(pointer));
+  hot_original_indices.push_back(std::nullopt);
+  variables_ = std::move(hot_variables);
+  original_indices_ = std::move(hot_original_indices);
+  return cold;
+}
+
+const std::vector<Variable>& Struct::GetColdVariables() const {
+  return cold_variables_;
+}
+
+const std::vector<size_t>& Struct::GetColdOriginalIndices() const {
+  return cold_original_indices_;
+}
+
+const std::vector<StructLayout>& Struct::GetLayouts() const {
+  return layouts_;
+}
+
+void Struct::SetLayouts(std::vector<StructLayout> layouts) {
+  layouts_ = std::move(layouts);
+}
+
+static nlohmann::json::object_t GetLayoutJSONObject(
+    const StructLayout& layout,
+    const std::vector<Variable>& variables) {
+  const auto& abi_traits = GetABITraits(layout.abi);
+  auto fields = nlohmann::json::array_t{};
+  fields.reserve(layout.fields.size());
+  for (size_t i = 0; i < layout.fields.size(); i++) {
+    const auto& field = layout.fields[i];
+    nlohmann::json::object_t object;
+    object["identifier"] = variables[i].GetIdentifier();
+    object["offset"] = field.offset;
+    object["size"] = field.size;
+    object["alignment"] = field.alignment;
+    object["padding"] = field.padding;
+    fields.emplace_back(std::move(object));
+  }
+  nlohmann::json::object_t object;
+  object["abi"] = abi_traits.name;
+  object["c_condition"] = abi_traits.c_condition;
+  object["size"] = layout.size;
+  object["alignment"] = layout.alignment;
+  object["tail_padding"] = layout.tail_padding;
+  object["fields"] = std::move(fields);
+  return object;
 }
 
 nlohmann::json::object_t Struct::GetJSONObject(const Namespace& ns) const {
   auto vars = nlohmann::json::array_t{};
-  for (const auto& var : variables_) {
-    vars.emplace_back(var.GetJSONObject(ns));
+  for (size_t i = 0; i < variables_.size(); i++) {
+    auto var = variables_[i].GetJSONObject(ns);
+    if (original_indices_.empty()) {
+      var["original_index"] = i;
+    } else if (original_indices_[i].has_value()) {
+      var["original_index"] = original_indices_[i].value();
+    }
+    vars.emplace_back(std::move(var));
+  }
+  auto layouts = nlohmann::json::array_t{};
+  for (const auto& layout : layouts_) {
+    layouts.emplace_back(GetLayoutJSONObject(layout, variables_));
+  }
+  auto cold_vars = nlohmann::json::array_t{};
+  for (size_t i = 0; i < cold_variables_.size(); i++) {
+    auto var = cold_variables_[i].GetJSONObject(ns);
+    var["original_index"] = cold_original_indices_[i];
+    cold_vars.emplace_back(std::move(var));
   }
   nlohmann::json::object_t strut;
   strut["name"] = name_;
+  strut["is_reordered"] = is_reordered_;
+  strut["cold_variables"] = std::move(cold_vars);
   strut["variables"] = std::move(vars);
+  strut["layouts"] = std::move(layouts);
   return strut;
 }
 
 Enum::Enum() = default;
 
-Enum::Enum(std::string name, std::vector<std::string> members)
+Enum::Enum(std::string name, std::vector<EnumMember> members)
     : name_(std::move(name)), members_(std::move(members)) {}
 
 Enum::~Enum() = default;
@@ -468,35 +1466,254 @@ const std::string& Enum::GetName() const {
   return name_;
 }
 
-const std::vector<std::string>& Enum::GetMembers() const {
+const std::vector<EnumMember>& Enum::GetMembers() const {
   return members_;
 }
 
-bool Enum::PassesSema(const Namespace& ns, std::stringstream& stream) const {
-  std::map<std::string, size_t> member_counts;
+bool Enum::IsFlags() const {
+  return HasAttribute("flags");
+}
+
+// The value of a member declared without one. That is the next integer in
+// plain enums and the next bit in flags enums. Returns nothing if the value
+// does not fit in 64 bits.
+static std::optional<uint64_t> GetNextMemberValue(
+    const std::optional<uint64_t>& previous,
+    bool is_flags) {
+  if (!previous.has_value()) {
+    return is_flags ? 1u : 0u;
+  }
+  const auto value = previous.value();
+  if (!is_flags) {
+    if (value == std::numeric_limits<uint64_t>::max()) {
+      return std::nullopt;
+    }
+    return value + 1u;
+  }
+  if (value == 0u) {
+    return 1u;
+  }
+  uint64_t bit = 1u;
+  while (bit <= value / 2u) {
+    bit <<= 1u;
+  }
+  if (bit == (uint64_t{1} << 63u)) {
+    return std::nullopt;
+  }
+  return bit << 1u;
+}
+
+std::vector<uint64_t> Enum::GetMemberValues() const {
+  const auto is_flags = IsFlags();
+  std::vector<uint64_t> values;
+  values.reserve(members_.size());
+  std::optional<uint64_t> previous;
   for (const auto& member : members_) {
-    member_counts[member]++;
+    previous = member.value.has_value()
+                   ? member.value->GetValue()
+                   : GetNextMemberValue(previous, is_flags);
+    values.push_back(previous.value_or(0u));
   }
+  return values;
+}
+
+const location& Enum::GetLocation() const {
+  return location_;
+}
 
-  for (const auto& count : member_counts) {
-    if (count.second > 1) {
-      stream << "Enum " << name_ << " has duplicate member " << count.first;
+void Enum::SetLocation(const class location& location) {
+  location_ = location;
+}
+
+Primitive Enum::GetUnderlyingType() const {
+  return underlying_type_.value_or(GetSmallestUnderlyingType());
+}
+
+void Enum::SetUnderlyingType(Primitive type) {
+  underlying_type_ = type;
+}
+
+Primitive Enum::GetSmallestUnderlyingType() const {
+  uint64_t max_value = 0u;
+  for (const auto value : GetMemberValues()) {
+    max_value = std::max(max_value, value);
+  }
+  for (const auto type : {Primitive::kUnsignedInt8, Primitive::kUnsignedInt16,
+                          Primitive::kUnsignedInt32}) {
+    if (max_value <= GetMaxValue(type)) {
+      return type;
+    }
+  }
+  return Primitive::kUnsignedInt64;
+}
+
+bool Enum::EvaluateExpressions(const Expression::ConstantResolver& resolver,
+                               std::vector<Diagnostic>& diagnostics) {
+  bool passes = true;
+  for (auto& member : members_) {
+    if (member.value.has_value()) {
+      passes = member.value->Evaluate(resolver, diagnostics) && passes;
+    }
+  }
+  return passes;
+}
+
+bool Enum::PassesSema(const Namespace& ns,
+                      std::vector<Diagnostic>& diagnostics) const {
+  bool passes =
+      CheckAttributes({"flags"}, "enum", name_, location_, diagnostics);
+  const auto type = GetUnderlyingType();
+  const auto* type_name = GetPrimitiveTraits(type).type;
+  const auto is_integer = IsIntegerPrimitive(type);
+  if (!is_integer) {
+    diagnostics.push_back({location_, "The underlying type of enum " + name_ +
+                                          " must be an integer type instead "
+                                          "of " +
+                                          type_name + "."});
+    passes = false;
+  }
+
+  const auto is_flags = IsFlags();
+  std::unordered_set<std::string> member_names;
+  std::unordered_map<uint64_t, const std::string*> members_by_value;
+  std::optional<uint64_t> previous;
+  // Values that could not be evaluated have already been reported. Neither
+  // they nor the values that follow from them are checked.
+  bool is_unknown = false;
+  for (const auto& member : members_) {
+    if (!member_names.insert(member.name).second) {
+      diagnostics.push_back({member.location, "Enum " + name_ +
+                                                  " has duplicate member " +
+                                                  member.name});
+      passes = false;
+    }
+    if (member.value.has_value()) {
+      is_unknown = !member.value->GetValue().has_value();
+    }
+    if (is_unknown) {
+      continue;
+    }
+    const auto value = member.value.has_value()
+                           ? member.value->GetValue()
+                           : GetNextMemberValue(previous, is_flags);
+    if (!value.has_value()) {
+      diagnostics.push_back(
+          {member.location, "The value of member " + member.name +
+                                " of enum " + name_ +
+                                " does not fit in uint64_t."});
       return false;
     }
+    previous = value;
+    const auto value_string = std::to_string(value.value());
+    if (is_integer && value.value() > GetMaxValue(type)) {
+      diagnostics.push_back({member.location, "The value " + value_string +
+                                                  " of member " + member.name +
+                                                  " of enum " + name_ +
+                                                  " does not fit in " +
+                                                  type_name + "."});
+      passes = false;
+    }
+    if (is_flags && (value.value() & (value.value() - 1u)) != 0u) {
+      diagnostics.push_back({member.location, "Member " + member.name +
+                                                  " of flags enum " + name_ +
+                                                  " must be a single bit "
+                                                  "instead of " +
+                                                  value_string + "."});
+      passes = false;
+    }
+    const auto found = members_by_value.emplace(value.value(), &member.name);
+    if (!found.second && *found.first->second != member.name) {
+      diagnostics.push_back({member.location, "Members " +
+                                                  *found.first->second +
+                                                  " and " + member.name +
+                                                  " of enum " + name_ +
+                                                  " have the same value " +
+                                                  value_string + "."});
+      passes = false;
+    }
   }
-  return true;
+
+  return passes;
 }
 
 nlohmann::json::object_t Enum::GetJSONObject() const {
+  const auto values = GetMemberValues();
   auto members = nlohmann::json::array_t{};
-  for (const auto& member : members_) {
-    members.push_back(member);
+  for (size_t i = 0; i < members_.size(); i++) {
+    nlohmann::json::object_t member;
+    member["name"] = members_[i].name;
+    member["value"] = values[i];
+    member["dart_value"] = GetDartValue(values[i]);
+    members.emplace_back(std::move(member));
   }
 
   nlohmann::json::object_t enumm;
   enumm["name"] = name_;
+  enumm["is_flags"] = IsFlags();
   enumm["members"] = std::move(members);
+  enumm["underlying_type"] = GetPrimitiveJSONObject(GetUnderlyingType());
   return enumm;
 }
 
+Constant::Constant() = default;
+
+Constant::Constant(Primitive type, std::string name, Expression expression)
+    : type_(type), name_(std::move(name)), expression_(std::move(expression)) {}
+
+Constant::~Constant() = default;
+
+const std::string& Constant::GetName() const {
+  return name_;
+}
+
+Primitive Constant::GetType() const {
+  return type_;
+}
+
+std::optional<uint64_t> Constant::GetValue() const {
+  return expression_.GetValue();
+}
+
+bool Constant::Evaluate(const Expression::ConstantResolver& resolver,
+                        std::vector<Diagnostic>& diagnostics) {
+  return expression_.Evaluate(resolver, diagnostics);
+}
+
+const location& Constant::GetLocation() const {
+  return location_;
+}
+
+void Constant::SetLocation(const class location& location) {
+  location_ = location;
+}
+
+bool Constant::PassesSema(std::vector<Diagnostic>& diagnostics) const {
+  const auto* type_name = GetPrimitiveTraits(type_).type;
+  if (!IsIntegerPrimitive(type_)) {
+    diagnostics.push_back({location_, "The type of constant " + name_ +
+                                          " must be an integer type instead "
+                                          "of " +
+                                          type_name + "."});
+    return false;
+  }
+  const auto value = GetValue().value_or(0u);
+  if (value > GetMaxValue(type_)) {
+    diagnostics.push_back({location_, "The value " + std::to_string(value) +
+                                          " of constant " + name_ +
+                                          " does not fit in " + type_name +
+                                          "."});
+    return false;
+  }
+  return true;
+}
+
+nlohmann::json::object_t Constant::GetJSONObject() const {
+  nlohmann::json::object_t constant;
+  constant["name"] = name_;
+  constant["type"] = GetPrimitiveJSONObject(type_);
+  constant["value"] = GetValue().value_or(0u);
+  constant["dart_value"] = GetDartValue(GetValue().value_or(0u));
+  return constant;
+}
+
 }  // namespace epoxy
@@ -3,13 +3,22 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
+#include "diagnostic.h"
+#include "location.hh"
 #include "macros.h"
 
 namespace epoxy {
@@ -28,9 +37,161 @@ enum class Primitive {
   kUnsignedInt64,
   kDouble,
   kFloat,
+  // A view of UTF-8 encoded characters and their number. Strings may only be
+  // passed to and returned from functions.
+  kString,
 };
 
-class Variable {
+// The attributes of a primitive in the languages code is generated for.
+struct PrimitiveTraits {
+  // The name of the primitive in the IDL.
+  const char* type;
+  const char* c_type;
+  const char* dart_ffi_type;
+  const char* dart_type;
+  // The Dart typed data list that holds the primitive. Empty for void.
+  const char* dart_typed_data;
+  // The size and alignment of the C type in bytes.
+  size_t size;
+  size_t alignment;
+};
+
+const PrimitiveTraits& GetPrimitiveTraits(Primitive primitive);
+
+// Returns the primitive named |type| in the IDL if there is one.
+std::optional<Primitive> GetPrimitiveNamed(const std::string& type);
+
+// Whether the primitive is one of the integer types enums may be stored as.
+bool IsIntegerPrimitive(Primitive primitive);
+
+// The underlying types of the enums in a namespace keyed by enum name.
+using EnumTypes = std::unordered_map<std::string, Primitive>;
+
+// The target ABIs struct layouts may be computed for.
+enum class ABI {
+  kX86_64,
+  kAArch64,
+  kARM32,
+  kIA32,
+};
+
+struct ABITraits {
+  // The name of the ABI on the command line and in the template data.
+  const char* name;
+  // A preprocessor condition that only holds when compiling for the ABI.
+  const char* c_condition;
+  size_t pointer_size;
+  // The alignment of 64-bit integers and doubles in structs.
+  size_t int64_alignment;
+};
+
+const ABITraits& GetABITraits(ABI abi);
+
+// Returns the ABI named |name| if there is one.
+std::optional<ABI> GetABINamed(const std::string& name);
+
+// The layout of a struct in memory for a target ABI. Fields are in the order
+// of the variables of the struct.
+struct StructLayout {
+  struct Field {
+    size_t offset = 0u;
+    size_t size = 0u;
+    size_t alignment = 0u;
+    // The padding before the field.
+    size_t padding = 0u;
+  };
+
+  ABI abi = ABI::kX86_64;
+  size_t size = 0u;
+  size_t alignment = 0u;
+  std::vector<Field> fields;
+  // The padding after the last field.
+  size_t tail_padding = 0u;
+};
+
+// Items and struct fields may be annotated with attributes written like C++
+// attributes. For example, "[[reorder]] struct Foo { ... }".
+class Attributed {
+ public:
+  const std::vector<std::string>& GetAttributes() const;
+
+  void SetAttributes(std::vector<std::string> attributes);
+
+  bool HasAttribute(const std::string& attribute) const;
+
+  // Reports attributes that are not in |known| or specified more than once.
+  // The kind (like "struct") and name identify the item in diagnostics.
+  bool CheckAttributes(std::initializer_list<const char*> known,
+                       const char* kind,
+                       const std::string& name,
+                       const location& location,
+                       std::vector<Diagnostic>& diagnostics) const;
+
+ private:
+  std::vector<std::string> attributes_;
+};
+
+// An unsigned 64-bit integer expression over numbers and constants. Numbers
+// have a value as soon as they are parsed. Other expressions are evaluated by
+// Sema. Expressions are stored in every array field and enum member with a
+// value. So numbers take no allocations and the operands and references of
+// other expressions are in a node that copies share.
+class Expression {
+ public:
+  enum class Operator {
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivide,
+    kRemainder,
+    kShiftLeft,
+    kShiftRight,
+    kBitwiseAnd,
+    kBitwiseOr,
+  };
+
+  // Returns the value of the named constant. Reports a diagnostic at the
+  // location of the reference and returns nothing if it has no value.
+  using ConstantResolver = std::function<std::optional<uint64_t>(
+      const std::string& name,
+      const location& location)>;
+
+  Expression();
+
+  explicit Expression(uint64_t number);
+
+  // A reference to a constant.
+  Expression(std::string constant, const class location& location);
+
+  // The location of binary expressions spans both operands. Diagnostics for
+  // the result of the operator are reported there.
+  Expression(Operator op,
+             Expression lhs,
+             Expression rhs,
+             const class location& location);
+
+  ~Expression();
+
+  std::optional<uint64_t> GetValue() const;
+
+  // Computes the value of the expression. Results that are negative or do not
+  // fit in 64 bits are errors.
+  bool Evaluate(const ConstantResolver& resolver,
+                std::vector<Diagnostic>& diagnostics);
+
+ private:
+  struct Node;
+
+  std::shared_ptr<const Node> node_;
+  std::optional<uint64_t> value_;
+
+  static std::optional<uint64_t> ComputeValue(
+      const Expression& expression,
+      const ConstantResolver& resolver,
+      std::vector<Diagnostic>& diagnostics);
+};
+
+class Variable : public Attributed {
  public:
   Variable();
 
@@ -48,7 +209,41 @@ class Variable {
 
   bool IsPointer() const;
 
-  bool PassesSema(const Namespace& ns, std::stringstream& stream) const;
+  // Struct fields may be arrays with a fixed number of elements that are
+  // stored inline in the struct.
+  bool IsArray() const;
+
+  // The number of elements of arrays. Known once Sema has evaluated the
+  // length.
+  std::optional<uint64_t> GetArrayLength() const;
+
+  void SetArrayLength(Expression length);
+
+  // Function arguments may be slices of primitives. Slices are passed as a
+  // pointer to the first element and the number of elements.
+  bool IsSlice() const;
+
+  void SetSlice(bool is_slice);
+
+  bool EvaluateExpressions(const Expression::ConstantResolver& resolver,
+                           std::vector<Diagnostic>& diagnostics);
+
+  const location& GetLocation() const;
+
+  void SetLocation(const class location& location);
+
+  bool PassesSema(const Namespace& ns,
+                  std::vector<Diagnostic>& diagnostics) const;
+
+  // The underlying type of the enum the variable holds. Set by Sema.
+  std::optional<Primitive> GetEnumUnderlyingType() const;
+
+  // Records the underlying type if the variable holds an enum by value.
+  void ResolveEnumType(const EnumTypes& enum_types);
+
+  // The size and alignment of the variable as a struct field. Enums are laid
+  // out as their underlying type and arrays as consecutive elements.
+  StructLayout::Field GetFieldLayout(ABI abi) const;
 
   nlohmann::json::object_t GetJSONObject(const Namespace& ns) const;
 
@@ -57,9 +252,13 @@ class Variable {
   Type type_;
   std::string identifier_;
   bool is_pointer_ = false;
+  bool is_slice_ = false;
+  std::optional<Expression> array_length_;
+  std::optional<Primitive> enum_underlying_type_;
+  class location location_;
 };
 
-class Function {
+class Function : public Attributed {
  public:
   using ReturnType = std::variant<Primitive, std::string>;
 
@@ -80,7 +279,21 @@ class Function {
 
   bool ReturnsPointer() const;
 
-  bool PassesSema(const Namespace& ns, std::stringstream& stream) const;
+  // Async functions run on a native thread pool. Their results are passed
+  // back to the caller when they are done.
+  bool IsAsync() const;
+
+  void SetAsync(bool is_async);
+
+  // Records the underlying types of the enums the function takes and returns.
+  void ResolveEnumTypes(const EnumTypes& enum_types);
+
+  const location& GetLocation() const;
+
+  void SetLocation(const class location& location);
+
+  bool PassesSema(const Namespace& ns,
+                  std::vector<Diagnostic>& diagnostics) const;
 
   nlohmann::json::object_t GetJSONObject(const Namespace& ns) const;
 
@@ -89,13 +302,20 @@ class Function {
   std::vector<Variable> arguments_;
   ReturnType return_type_;
   bool pointer_return_ = false;
+  bool is_async_ = false;
+  std::optional<Primitive> enum_return_type_;
+  class location location_;
 
   std::optional<Primitive> GetPrimitiveReturn() const;
 
   std::optional<std::string> GetUserDefinedReturn() const;
+
+  bool CheckBatchable(std::vector<Diagnostic>& diagnostics) const;
+
+  bool CheckAsync(std::vector<Diagnostic>& diagnostics) const;
 };
 
-class Struct {
+class Struct : public Attributed {
  public:
   Struct();
 
@@ -107,37 +327,160 @@ class Struct {
 
   const std::vector<Variable>& GetVariables() const;
 
-  bool PassesSema(const Namespace& ns, std::stringstream& stream) const;
+  // Records the underlying types of the enums held by the fields.
+  void ResolveEnumTypes(const EnumTypes& enum_types);
+
+  // Evaluates the lengths of array fields.
+  bool EvaluateExpressions(const Expression::ConstantResolver& resolver,
+                           std::vector<Diagnostic>& diagnostics);
+
+  const location& GetLocation() const;
+
+  void SetLocation(const class location& location);
+
+  bool PassesSema(const Namespace& ns,
+                  std::vector<Diagnostic>& diagnostics) const;
+
+  // Lays out the fields in order with the padding required by the ABI. Like
+  // in C++, empty structs take a byte.
+  StructLayout ComputeLayout(ABI abi) const;
+
+  // Sorts the fields by decreasing alignment so that no ABI needs padding
+  // between them. Fields with the same alignment on all ABIs keep their
+  // order.
+  void ReorderFields();
+
+  // Whether |ReorderFields| has been called.
+  bool IsReordered() const;
+
+  // The index each field was declared at, counting the cold fields too. The
+  // pointer to the cold struct was not declared and has no index. Empty if
+  // the fields are still the ones declared and in the same order.
+  const std::vector<std::optional<size_t>>& GetOriginalIndices() const;
+
+  // Moves the fields with the cold attribute to a struct of their own named
+  // after this one with a "Cold" suffix. A pointer to the cold struct named
+  // "cold" is appended to the remaining fields. Returns the cold struct if
+  // there were cold fields.
+  std::optional<Struct> SplitColdFields();
+
+  // The fields moved to the cold struct. The generated code has accessors for
+  // them that follow the pointer to the cold struct.
+  const std::vector<Variable>& GetColdVariables() const;
+
+  // The index each cold field was declared at.
+  const std::vector<size_t>& GetColdOriginalIndices() const;
+
+  // The layouts computed by Sema for the selected ABIs.
+  const std::vector<StructLayout>& GetLayouts() const;
+
+  void SetLayouts(std::vector<StructLayout> layouts);
 
   nlohmann::json::object_t GetJSONObject(const Namespace& ns) const;
 
  private:
   std::string name_;
   std::vector<Variable> variables_;
+  std::vector<std::optional<size_t>> original_indices_;
+  bool is_reordered_ = false;
+  std::vector<Variable> cold_variables_;
+  std::vector<size_t> cold_original_indices_;
+  std::vector<StructLayout> layouts_;
+  class location location_;
+};
+
+// A member of an enum. Members without a value follow the previous member.
+struct EnumMember {
+  std::string name;
+  std::optional<Expression> value;
+  // The location of the name. Diagnostics about the member are reported here.
+  class location location;
 };
 
-class Enum {
+// Enums with the "flags" attribute are sets of flags packed in a single
+// integer. Each member is a bit and members without a value take the bit after
+// the previous member.
+class Enum : public Attributed {
  public:
   Enum();
 
-  Enum(std::string name, std::vector<std::string> members);
+  Enum(std::string name, std::vector<EnumMember> members);
 
   ~Enum();
 
   const std::string& GetName() const;
 
-  const std::vector<std::string>& GetMembers() const;
+  const std::vector<EnumMember>& GetMembers() const;
+
+  bool IsFlags() const;
+
+  // The values of the members in order. Only valid for enums that pass Sema.
+  std::vector<uint64_t> GetMemberValues() const;
+
+  // The integer type the enum is stored as. If none was declared, this is the
+  // smallest unsigned integer type that holds the values of all the members.
+  Primitive GetUnderlyingType() const;
+
+  void SetUnderlyingType(Primitive type);
+
+  Primitive GetSmallestUnderlyingType() const;
+
+  // Evaluates the values of the members that have one.
+  bool EvaluateExpressions(const Expression::ConstantResolver& resolver,
+                           std::vector<Diagnostic>& diagnostics);
+
+  const location& GetLocation() const;
+
+  void SetLocation(const class location& location);
+
+  bool PassesSema(const Namespace& ns,
+                  std::vector<Diagnostic>& diagnostics) const;
+
+  nlohmann::json::object_t GetJSONObject() const;
+
+ private:
+  std::string name_;
+  std::vector<EnumMember> members_;
+  std::optional<Primitive> underlying_type_;
+  class location location_;
+};
+
+// A named integer known when generating code. Constants may be used in the
+// expressions for array lengths, enum member values and other constants.
+class Constant {
+ public:
+  Constant();
+
+  Constant(Primitive type, std::string name, Expression expression);
+
+  ~Constant();
+
+  const std::string& GetName() const;
+
+  Primitive GetType() const;
+
+  // Known once Sema has evaluated the constant.
+  std::optional<uint64_t> GetValue() const;
+
+  bool Evaluate(const Expression::ConstantResolver& resolver,
+                std::vector<Diagnostic>& diagnostics);
+
+  const location& GetLocation() const;
+
+  void SetLocation(const class location& location);
 
-  bool PassesSema(const Namespace& ns, std::stringstream& stream) const;
+  bool PassesSema(std::vector<Diagnostic>& diagnostics) const;
 
   nlohmann::json::object_t GetJSONObject() const;
 
  private:
+  Primitive type_ = Primitive::kInt32;
   std::string name_;
-  std::vector<std::string> members_;
+  Expression expression_;
+  class location location_;
 };
 
-using NamespaceItem = std::variant<Function, Struct, Enum>;
+using NamespaceItem = std::variant<Function, Struct, Enum, Constant>;
 using NamespaceItems = std::vector<NamespaceItem>;
 
 class Namespace {
@@ -158,17 +501,66 @@ class Namespace {
 
   const std::vector<Enum>& GetEnums() const;
 
+  const std::vector<Constant>& GetConstants() const;
+
   bool HasEnumNamed(const std::string& name) const;
 
   bool HasStructNamed(const std::string& name) const;
 
-  void AddFunctions(const std::vector<Function>& functions);
+  // Returns the first struct with the name if there is one.
+  const Struct* GetStructNamed(const std::string& name) const;
+
+  bool HasConstantNamed(const std::string& name) const;
+
+  void AddFunctions(std::vector<Function> functions);
+
+  void AddStructs(std::vector<Struct> structs);
+
+  void AddEnums(std::vector<Enum> enums);
+
+  void AddConstants(std::vector<Constant> constants);
 
-  void AddStructs(const std::vector<Struct>& structs);
+  // Moves all the items of the other namespace into this one. The name of
+  // this namespace is unchanged.
+  void Append(Namespace other);
 
-  void AddEnums(const std::vector<Enum>& enums);
+  void AddFunction(Function function);
 
-  bool PassesSema(std::stringstream& stream) const;
+  void AddStruct(Struct struct_item);
+
+  void AddEnum(Enum enum_item);
+
+  void AddConstant(Constant constant);
+
+  // Items that have already been checked by Sema (like those in imported
+  // files) are not checked again. Adding items only adds names. So checked
+  // items remain valid but are still checked for collisions with new names.
+  void MarkChecked();
+
+  // The number of functions and structs at the start of their lists that had
+  // already been checked.
+  size_t GetCheckedFunctionCount() const;
+
+  size_t GetCheckedStructCount() const;
+
+  // Evaluates the constants along with the array lengths and enum member
+  // values that may refer to them. Must be done before checking the items.
+  bool EvaluateConstants(std::vector<Diagnostic>& diagnostics);
+
+  bool PassesSema(std::vector<Diagnostic>& diagnostics) const;
+
+  // Records the underlying type of each enum in the variables and functions
+  // that use it. Struct layouts and the template data depend on it.
+  void ResolveEnumTypes();
+
+  // Splits the cold fields of structs into structs of their own. Each cold
+  // struct is placed before the struct it was split from.
+  void SplitColdStructFields();
+
+  // Reorders the fields of structs with the reorder attribute.
+  void ReorderStructFields();
+
+  void ComputeStructLayouts(const std::vector<ABI>& abis);
 
   nlohmann::json::object_t GetJSONObject() const;
 
@@ -177,10 +569,22 @@ class Namespace {
   std::vector<Function> functions_;
   std::vector<Struct> structs_;
   std::vector<Enum> enums_;
-
-  bool CheckDuplicateFunctions(std::stringstream& stream) const;
-
-  bool CheckStructEnumNameCollisions(std::stringstream& stream) const;
+  std::vector<Constant> constants_;
+  // Indexes the names of structs and enums for the lookups made for every
+  // variable and return type. Structs are indexed by their position in the
+  // list.
+  std::unordered_map<std::string, size_t> struct_indices_;
+  std::unordered_set<std::string> enum_names_;
+  std::unordered_set<std::string> constant_names_;
+  // The number of items at the start of each list that have been checked.
+  size_t checked_functions_ = 0u;
+  size_t checked_structs_ = 0u;
+  size_t checked_enums_ = 0u;
+  size_t checked_constants_ = 0u;
+
+  bool CheckDuplicateFunctions(std::vector<Diagnostic>& diagnostics) const;
+
+  bool CheckNameCollisions(std::vector<Diagnostic>& diagnostics) const;
 };
 
 }  // namespace epoxy
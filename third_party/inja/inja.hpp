@@ -1735,6 +1735,10 @@ struct Bytecode {
   json value;
   std::string str;
 
+  // Epoxy: The line in the template source of the construct the bytecode was
+  // generated for. Starts at 1.
+  uint32_t line {0};
+
   Bytecode(): args(0), flags(0) {}
   explicit Bytecode(Op op, unsigned int args = 0): op(op), args(args), flags(0) {}
   explicit Bytecode(Op op, nonstd::string_view str, unsigned int flags): op(op), args(0), flags(flags), str(str) {}
@@ -1756,6 +1760,12 @@ using json = nlohmann::json;
 using Arguments = std::vector<const json*>;
 using CallbackFunction = std::function<json(Arguments& args)>;
 
+// Epoxy: Called before each bytecode is executed with the index of the
+// bytecode, its line in the template source and the number of loops being
+// iterated over. Called once more with line 0 when rendering is done. Used for
+// profiling.
+using InstructionObserver = std::function<void(size_t index, uint32_t line, size_t loop_depth)>;
+
 /*!
  * \brief Class for builtin functions and user-defined callbacks.
  */
@@ -2735,8 +2745,18 @@ class Parser {
   void parse_into(Template& tmpl, nonstd::string_view path) {
     m_lexer.start(tmpl.content);
 
+    // Epoxy: Track the line of each top-level construct to annotate bytecodes.
+    uint32_t line = 1;
+    size_t line_offset = 0;
+
     for (;;) {
       get_next_token();
+      const size_t first_bytecode = tmpl.bytecodes.size();
+      const size_t token_offset = static_cast<size_t>(m_tok.text.data() - tmpl.content.data());
+      if (token_offset <= tmpl.content.size()) {
+        line += static_cast<uint32_t>(std::count(tmpl.content.begin() + line_offset, tmpl.content.begin() + token_offset, '\n'));
+        line_offset = token_offset;
+      }
       switch (m_tok.kind) {
         case Token::Kind::Eof:
           if (!m_if_stack.empty()) inja_throw("parser_error", "unmatched if");
@@ -2782,6 +2802,9 @@ class Parser {
           inja_throw("parser_error", "unexpected token '" + m_tok.describe() + "'");
           break;
       }
+      for (size_t i = first_bytecode; i < tmpl.bytecodes.size(); ++i) {
+        tmpl.bytecodes[i].line = line;
+      }
     }
   }
 
@@ -3002,7 +3025,7 @@ class Renderer {
         break;
     }
     try {
-      return &m_data->at(json::json_pointer(ptr.data()));
+      return &lookup(ptr);
     } catch (std::exception&) {
       // try to evaluate as a no-argument callback
       if (auto callback = m_callbacks.find_callback(bc.str, 0)) {
@@ -3015,6 +3038,39 @@ class Renderer {
     }
   }
 
+  // Epoxy: Loop levels only hold the loop variables instead of a copy of all
+  // the data. Lookups check the loop levels from the innermost outwards before
+  // the data passed to the renderer. This keeps nested loops linear in the size
+  // of the data.
+  const json& lookup(nonstd::string_view ptr) const {
+    auto name_end = ptr.find('/', 1);
+    std::string name(ptr.substr(1, name_end == nonstd::string_view::npos ? nonstd::string_view::npos : name_end - 1));
+    for (size_t pos = 0; (pos = name.find("~1", pos)) != std::string::npos; ++pos) {
+      name.replace(pos, 2, "/");
+    }
+    for (size_t pos = 0; (pos = name.find("~0", pos)) != std::string::npos; ++pos) {
+      name.replace(pos, 2, "~");
+    }
+    for (auto level = m_loop_stack.rbegin(); level != m_loop_stack.rend(); ++level) {
+      if (level->data.find(name) != level->data.end()) {
+        return level->data.at(json::json_pointer(std::string(ptr.data(), ptr.size())));
+      }
+    }
+    return m_data->at(json::json_pointer(std::string(ptr.data(), ptr.size())));
+  }
+
+  // Epoxy: The data as seen from within the current loop. Only used to render
+  // included templates.
+  json current_data() const {
+    json data = *m_data;
+    for (const auto& level : m_loop_stack) {
+      for (auto it = level.data.begin(); it != level.data.end(); ++it) {
+        data[it.key()] = it.value();
+      }
+    }
+    return data;
+  }
+
   bool truthy(const json& var) const {
     if (var.empty()) {
       return false;
@@ -3077,13 +3133,14 @@ class Renderer {
 
   std::vector<LoopLevel> m_loop_stack;
   const json* m_data;
+  InstructionObserver m_observer;
 
   std::vector<const json*> m_tmp_args;
   json m_tmp_val;
 
 
  public:
-  Renderer(const TemplateStorage& included_templates, const FunctionStorage& callbacks): m_included_templates(included_templates), m_callbacks(callbacks) {
+  Renderer(const TemplateStorage& included_templates, const FunctionStorage& callbacks, InstructionObserver observer = nullptr): m_included_templates(included_templates), m_callbacks(callbacks), m_observer(std::move(observer)) {
     m_stack.reserve(16);
     m_tmp_args.reserve(4);
     m_loop_stack.reserve(16);
@@ -3095,6 +3152,10 @@ class Renderer {
     for (size_t i = 0; i < tmpl.bytecodes.size(); ++i) {
       const auto& bc = tmpl.bytecodes[i];
 
+      if (m_observer) {
+        m_observer(i, bc.line, m_loop_stack.size());
+      }
+
       switch (bc.op) {
         case Bytecode::Op::Nop: {
           break;
@@ -3376,7 +3437,7 @@ class Renderer {
           break;
         }
         case Bytecode::Op::Include:
-          Renderer(m_included_templates, m_callbacks).render_to(os, m_included_templates.find(get_imm(bc)->get_ref<const std::string&>())->second, *m_data);
+          Renderer(m_included_templates, m_callbacks).render_to(os, m_included_templates.find(get_imm(bc)->get_ref<const std::string&>())->second, m_loop_stack.empty() ? *m_data : current_data());
           break;
         case Bytecode::Op::Callback: {
           auto callback = m_callbacks.find_callback(bc.str, bc.args);
@@ -3411,7 +3472,16 @@ class Renderer {
           LoopLevel& level = m_loop_stack.back();
           level.value_name = bc.str;
           level.values = std::move(m_stack.back());
-          level.data = (*m_data);
+          level.data = json::object();
+          if (m_loop_stack.size() > 1) {
+            // Epoxy: Only the loop data of the enclosing loop is needed to
+            // provide parent access.
+            const auto& parent = m_loop_stack[m_loop_stack.size() - 2].data;
+            auto parent_loop = parent.find("loop");
+            if (parent_loop != parent.end()) {
+              level.data["loop"] = *parent_loop;
+            }
+          }
           m_stack.pop_back();
 
           if (bc.value.is_string()) {
@@ -3449,8 +3519,6 @@ class Renderer {
             (*parent_loop_it)["parent"] = std::move(loop_copy);
           }
 
-          // set "current" data to loop data
-          m_data = &level.data;
           update_loop_data();
           break;
         }
@@ -3471,12 +3539,6 @@ class Renderer {
 
           if (done) {
             m_loop_stack.pop_back();
-            // set "current" data to outer loop data or main data as appropriate
-            if (!m_loop_stack.empty()) {
-              m_data = &m_loop_stack.back().data;
-            } else {
-              m_data = &data;
-            }
             break;
           }
 
@@ -3491,6 +3553,10 @@ class Renderer {
         }
       }
     }
+
+    if (m_observer) {
+      m_observer(tmpl.bytecodes.size(), 0, 0);
+    }
   }
 };
 
@@ -3616,10 +3682,15 @@ class Environment {
   }
 
   std::ostream& render_to(std::ostream& os, const Template& tmpl, const json& data) {
-    Renderer(m_included_templates, m_callbacks).render_to(os, tmpl, data);
+    Renderer(m_included_templates, m_callbacks, m_observer).render_to(os, tmpl, data);
     return os;
   }
 
+  // Epoxy: Sets the observer of the bytecodes executed while rendering.
+  void set_instruction_observer(const InstructionObserver& observer) {
+    m_observer = observer;
+  }
+
   std::string load_file(const std::string& filename) {
     Parser parser(m_parser_config, m_lexer_config, m_included_templates);
     return parser.load_file(m_input_path + filename);
@@ -3653,6 +3724,7 @@ class Environment {
 
   FunctionStorage m_callbacks;
   TemplateStorage m_included_templates;
+  InstructionObserver m_observer;
 };
 
 /*!